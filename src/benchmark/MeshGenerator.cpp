@@ -0,0 +1,186 @@
+#include "MeshGenerator.hpp"
+#include "gprs-data/BufferedWriter.hpp"
+
+#include <cmath>      // std::cbrt
+#include <stdexcept>  // std::invalid_argument
+#include <unordered_map>
+
+namespace benchmark
+{
+
+namespace
+{
+// vtk cell types
+const int vtk_triangle = 5;
+const int vtk_quad = 9;
+const int vtk_tetra = 10;
+const int vtk_hexahedron = 12;
+const int vtk_wedge = 13;
+
+// vtk id -> gmsh element type
+const std::unordered_map<int,int> map_vtk_gmsh = {
+  {vtk_tetra, 4},
+  {vtk_hexahedron, 5},
+  {vtk_wedge, 6},
+  {vtk_triangle, 2},
+  {vtk_quad, 3},
+};
+}  // end anonymous namespace
+
+
+std::size_t MeshGenerator::boxes_per_direction(const std::size_t n_cells, const CellType type)
+{
+  std::size_t cells_per_box = 1;
+  if (type == CellType::prism) cells_per_box = 2;
+  else if (type == CellType::tet) cells_per_box = 6;
+  const double n_boxes = static_cast<double>(n_cells) / cells_per_box;
+  return std::max(std::size_t(1), static_cast<std::size_t>(std::round(std::cbrt(n_boxes))));
+}
+
+
+void MeshGenerator::generate(const BoxMeshConfig & config, mesh::Mesh & grid)
+{
+  if (!grid.empty())
+    throw std::invalid_argument("grid must be empty");
+  if (config.dfm_planes.size() != config.dfm_markers.size())
+    throw std::invalid_argument("each dfm plane needs a marker");
+  for (const std::size_t plane : config.dfm_planes)
+    if (plane == 0 || plane >= config.nx)
+      throw std::invalid_argument("dfm planes must be internal");
+
+  const std::size_t nx = config.nx, ny = config.ny, nz = config.nz;
+  const double dx = config.lx / nx, dy = config.ly / ny, dz = config.lz / nz;
+
+  // vertices
+  grid.vertices.points.reserve((nx + 1) * (ny + 1) * (nz + 1));
+  for (std::size_t k = 0; k <= nz; ++k)
+    for (std::size_t j = 0; j <= ny; ++j)
+      for (std::size_t i = 0; i <= nx; ++i)
+        grid.vertices.insert({i * dx, j * dy, k * dz});
+
+  const auto vertex = [nx, ny](const std::size_t i, const std::size_t j, const std::size_t k)
+  {
+    return i + (nx + 1) * (j + (ny + 1) * k);
+  };
+  // box corners (same order as vtk hexahedron)
+  const auto box = [&vertex](const std::size_t i, const std::size_t j, const std::size_t k)
+  {
+    return std::vector<std::size_t>{vertex(i, j, k),   vertex(i+1, j, k),
+                                    vertex(i+1, j+1, k), vertex(i, j+1, k),
+                                    vertex(i, j, k+1),   vertex(i+1, j, k+1),
+                                    vertex(i+1, j+1, k+1), vertex(i, j+1, k+1)};
+  };
+
+  // cells
+  std::size_t cells_per_box = 1;
+  if (config.type == CellType::prism) cells_per_box = 2;
+  else if (config.type == CellType::tet) cells_per_box = 6;
+  grid.cells.reserve(nx * ny * nz * cells_per_box);
+  grid.shape_ids.reserve(nx * ny * nz * cells_per_box);
+  grid.cell_markers.reserve(nx * ny * nz * cells_per_box);
+
+  for (std::size_t k = 0; k < nz; ++k)
+    for (std::size_t j = 0; j < ny; ++j)
+      for (std::size_t i = 0; i < nx; ++i)
+      {
+        const std::vector<std::size_t> v = box(i, j, k);
+        switch (config.type)
+        {
+          case CellType::hex:
+            grid.insert_cell(v, vtk_hexahedron, config.cell_marker);
+            break;
+          case CellType::prism:
+            // split the box along the 0-2 diagonal of the base
+            grid.insert_cell({v[0], v[1], v[2], v[4], v[5], v[6]}, vtk_wedge, config.cell_marker);
+            grid.insert_cell({v[0], v[2], v[3], v[4], v[6], v[7]}, vtk_wedge, config.cell_marker);
+            break;
+          case CellType::tet:
+            // Kuhn subdivision around the 0-6 diagonal (conforming between boxes)
+            insert_tet({v[0], v[1], v[2], v[6]}, config.cell_marker, grid);
+            insert_tet({v[0], v[2], v[3], v[6]}, config.cell_marker, grid);
+            insert_tet({v[0], v[3], v[7], v[6]}, config.cell_marker, grid);
+            insert_tet({v[0], v[7], v[4], v[6]}, config.cell_marker, grid);
+            insert_tet({v[0], v[4], v[5], v[6]}, config.cell_marker, grid);
+            insert_tet({v[0], v[5], v[1], v[6]}, config.cell_marker, grid);
+            break;
+        }
+      }
+
+  // dfm faces on x = const planes
+  for (std::size_t p = 0; p < config.dfm_planes.size(); ++p)
+  {
+    const std::size_t i = config.dfm_planes[p];
+    for (std::size_t k = 0; k < nz; ++k)
+      for (std::size_t j = 0; j < ny; ++j)
+      {
+        const std::vector<std::size_t> v = box(i, j, k);
+        if (config.type == CellType::tet)
+        {
+          grid.insert_face({v[0], v[3], v[7]}, vtk_triangle, config.dfm_markers[p]);
+          grid.insert_face({v[0], v[7], v[4]}, vtk_triangle, config.dfm_markers[p]);
+        }
+        else
+          grid.insert_face({v[0], v[3], v[7], v[4]}, vtk_quad, config.dfm_markers[p]);
+      }
+  }
+}
+
+
+void MeshGenerator::insert_tet(std::vector<std::size_t> ivertices, const int marker,
+                               mesh::Mesh & grid)
+{
+  const auto & p = grid.get_vertices();
+  const mesh::Point a = p[ivertices[1]] - p[ivertices[0]];
+  const mesh::Point b = p[ivertices[2]] - p[ivertices[0]];
+  const mesh::Point c = p[ivertices[3]] - p[ivertices[0]];
+  if (a.dot(b.cross(c)) < 0)
+    std::swap(ivertices[1], ivertices[2]);
+  grid.insert_cell(ivertices, vtk_tetra, marker);
+}
+
+
+void MeshGenerator::write_gmsh(const mesh::Mesh & grid, const std::string & fname)
+{
+  IO::BufferedWriter out(fname);
+  out.precision(12);
+
+  out << "$MeshFormat\n2.2 0 8\n$EndMeshFormat\n";
+
+  out << "$Nodes\n" << grid.n_vertices() << "\n";
+  const auto & vertices = grid.get_vertices();
+  out.write_parallel(vertices.size(), [&vertices](IO::BufferedWriter & chunk, const std::size_t i)
+  {
+    chunk << i + 1 << " " << vertices[i][0] << " " << vertices[i][1] << " " << vertices[i][2] << "\n";
+  });
+  out << "$EndNodes\n";
+
+  // marked faces first (as gmsh does)
+  std::vector<const mesh::Face*> faces;
+  for (const auto & face : grid.faces)
+    if (face.marker != 0 && face.marker != mesh::default_face_marker)
+      faces.push_back(&face);
+
+  out << "$Elements\n" << faces.size() + grid.n_cells() << "\n";
+  std::size_t element = 1;
+  for (const mesh::Face * face : faces)
+  {
+    out << element++ << " " << map_vtk_gmsh.at(face->vtk_id) << " 2 "
+        << face->marker << " " << face->marker;
+    for (const std::size_t v : face->ordered_indices)
+      out << " " << v + 1;
+    out << "\n";
+  }
+
+  const std::size_t shift = element;
+  out.write_parallel(grid.n_cells(), [&grid, shift](IO::BufferedWriter & chunk, const std::size_t i)
+  {
+    chunk << shift + i << " " << map_vtk_gmsh.at(grid.shape_ids[i]) << " 2 "
+          << grid.cell_markers[i] << " " << grid.cell_markers[i];
+    for (const std::size_t v : grid.cells[i])
+      chunk << " " << v + 1;
+    chunk << "\n";
+  });
+  out << "$EndElements\n";
+}
+
+}  // end namespace benchmark
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <mesh/Mesh.hpp>
+
+#include <string>
+#include <vector>
+
+namespace benchmark
+{
+
+enum class CellType
+{
+  hex,    // one hexahedron per box
+  prism,  // two wedges per box
+  tet     // six tetrahedra per box
+};
+
+struct BoxMeshConfig
+{
+  std::size_t nx = 10, ny = 10, nz = 10;  // number of boxes in each direction
+  double lx = 100, ly = 100, lz = 100;    // domain dimensions
+  CellType type = CellType::hex;
+  int cell_marker = 9999;
+  // indices of x = const planes (0 < i < nx) marked as dfm faces;
+  // plane j gets marker dfm_markers[j]
+  std::vector<std::size_t> dfm_planes;
+  std::vector<int> dfm_markers;
+};
+
+
+/* Generates structured meshes of a box in memory (no gmsh needed).
+ * The meshes are used to benchmark the preprocessor on
+ * models of arbitrary size. */
+class MeshGenerator
+{
+ public:
+  // fill an empty grid
+  static void generate(const BoxMeshConfig & config, mesh::Mesh & grid);
+  // number of boxes per direction so that the mesh has about n_cells cells
+  static std::size_t boxes_per_direction(const std::size_t n_cells, const CellType type);
+  // save cells and marked faces into a gmsh 2.2 ascii file
+  static void write_gmsh(const mesh::Mesh & grid, const std::string & fname);
+
+ private:
+  MeshGenerator();
+  // insert cell with a positive volume (swaps vertices if necessary)
+  static void insert_tet(std::vector<std::size_t> ivertices, const int marker,
+                         mesh::Mesh & grid);
+};
+
+}  // end namespace benchmark
@@ -0,0 +1,316 @@
+/* Benchmark of the preprocessing pipeline on synthetic meshes.
+ * Structured hex/prism/tet meshes of a box are generated in memory,
+ * saved to gmsh format and read back with GmshReader, then
+ * processed by all engine::Engine stages (same order and timers as
+ * msh2gprs) and written in gprs and vtu formats.
+ * Each stage is timed with the profiler and the throughput
+ * (cells/s and faces/s) is reported for every mesh size.
+ *
+ * usage: msh2gprs_benchmark [options]
+ *   --cells N1,N2,...     approximate numbers of cells (default 10000,100000,1000000)
+ *   --type hex|prism|tet  cell type (default hex)
+ *   --efracs n            number of embedded fractures (default 0)
+ *   --dfm n               number of dfm planes (default 0)
+ *   --wells n             number of vertical wells (default 0)
+ *   --output dir          scratch directory (default benchmark-output)
+ *   --profile file.json   save the profiler report
+ *   --threads n           number of threads (default: all hardware threads)
+ */
+#include "MeshGenerator.hpp"
+#include <engine/Engine.hpp>
+#include <parsers/GmshReader.hpp>
+#include <profiling/Profiler.hpp>
+#include <parallel/ThreadPool.hpp>
+#include <angem/Rectangle.hpp>
+
+#include <cmath>
+#include <experimental/filesystem>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+namespace filesystem = std::experimental::filesystem;
+
+namespace
+{
+
+struct BenchmarkOptions
+{
+  std::vector<std::size_t> cells = {10000, 100000, 1000000};
+  benchmark::CellType type = benchmark::CellType::hex;
+  std::size_t n_efracs = 0;
+  std::size_t n_dfm = 0;
+  std::size_t n_wells = 0;
+  std::string output_dir = "benchmark-output";
+  std::string profile_file;
+  std::size_t n_threads = 0;
+};
+
+
+BenchmarkOptions parse_options(int argc, char *argv[])
+{
+  BenchmarkOptions options;
+  for (int i = 1; i < argc; i += 2)
+  {
+    const std::string key = argv[i];
+    if (i + 1 >= argc)
+      throw std::invalid_argument("missing value for " + key);
+    const std::string value = argv[i + 1];
+
+    if (key == "--cells")
+    {
+      options.cells.clear();
+      std::istringstream iss(value);
+      std::string token;
+      while (std::getline(iss, token, ','))
+        options.cells.push_back(std::stoul(token));
+    }
+    else if (key == "--type")
+    {
+      if (value == "hex") options.type = benchmark::CellType::hex;
+      else if (value == "prism") options.type = benchmark::CellType::prism;
+      else if (value == "tet") options.type = benchmark::CellType::tet;
+      else throw std::invalid_argument("unknown cell type " + value);
+    }
+    else if (key == "--efracs") options.n_efracs = std::stoul(value);
+    else if (key == "--dfm") options.n_dfm = std::stoul(value);
+    else if (key == "--wells") options.n_wells = std::stoul(value);
+    else if (key == "--output") options.output_dir = value;
+    else if (key == "--profile") options.profile_file = value;
+    else if (key == "--threads") options.n_threads = std::stoul(value);
+    else throw std::invalid_argument("unknown option " + key);
+  }
+  return options;
+}
+
+
+std::string type_name(const benchmark::CellType type)
+{
+  switch (type)
+  {
+    case benchmark::CellType::hex: return "hex";
+    case benchmark::CellType::prism: return "prism";
+    case benchmark::CellType::tet: return "tet";
+  }
+  return "";
+}
+
+
+// add a flow property to a domain (same bookkeeping as the config parsers)
+void add_property(SimdataConfig & config, DomainConfig & domain,
+                  const std::string & name, const std::string & expression)
+{
+  const std::size_t local = domain.expressions.size();
+  domain.variables.push_back(name);
+  domain.expressions.push_back(expression);
+  const std::size_t ind = find(name, config.all_vars);
+  if (ind == config.all_vars.size())
+  {
+    config.all_vars.push_back(name);
+    if (find(name, config.special_keywords) < config.special_keywords.size())
+      config.expression_type.push_back(-1);
+    else
+      config.expression_type.push_back(0);
+  }
+  domain.local_to_global_vars[local] = ind;
+  domain.global_to_local_vars[ind] = local;
+}
+
+
+// mesh with dfm planes evenly spaced along x
+benchmark::BoxMeshConfig make_mesh_config(const BenchmarkOptions & options,
+                                          const std::size_t n_cells)
+{
+  benchmark::BoxMeshConfig config;
+  config.type = options.type;
+  const std::size_t n = benchmark::MeshGenerator::boxes_per_direction(n_cells, options.type);
+  config.nx = config.ny = config.nz = n;
+  for (std::size_t i = 0; i < options.n_dfm; ++i)
+  {
+    const std::size_t plane = (i + 1) * n / (options.n_dfm + 1);
+    if (plane == 0 || plane >= n ||
+        (!config.dfm_planes.empty() && config.dfm_planes.back() == plane))
+      continue;
+    config.dfm_planes.push_back(plane);
+    config.dfm_markers.push_back(static_cast<int>(i + 1));
+  }
+  return config;
+}
+
+
+// properties, fractures and wells
+SimdataConfig make_config(const BenchmarkOptions & options,
+                          const benchmark::BoxMeshConfig & mesh_config)
+{
+  SimdataConfig config;
+  config.output_formats = {OutputFormat::gprs, OutputFormat::vtu};
+
+  config.domains.emplace_back();
+  DomainConfig & domain = config.domains.back();
+  domain.label = mesh_config.cell_marker;
+  add_property(config, domain, "PORO", "0.2");
+  add_property(config, domain, "PERM", "10 + x / 100");
+  add_property(config, domain, "PRESSURE", "100 + 0.01 * z");
+
+  for (const int marker : mesh_config.dfm_markers)
+  {
+    config.discrete_fractures.emplace_back();
+    config.discrete_fractures.back().label = marker;
+  }
+
+  // shift objects off the grid planes
+  const double sx = 0.37 * mesh_config.lx / mesh_config.nx;
+  const double sy = 0.37 * mesh_config.ly / mesh_config.ny;
+  const double sz = 0.37 * mesh_config.lz / mesh_config.nz;
+
+  // parallel vertical fractures along the diagonal of the box
+  const std::size_t nf = options.n_efracs;
+  for (std::size_t i = 0; i < nf; ++i)
+  {
+    const double t = static_cast<double>(i + 1) / (nf + 1);
+    const angem::Point<3,double> center = {t * mesh_config.lx + sx,
+                                           t * mesh_config.ly + sy,
+                                           0.5 * mesh_config.lz + sz};
+    const double length = 0.8 * std::min(mesh_config.lx, mesh_config.ly) / (nf + 1);
+    config.fractures.emplace_back();
+    config.fractures.back().body = std::make_shared<angem::Rectangle<double>>
+        (center, length, 0.5 * mesh_config.lz, 90, 45);
+  }
+
+  // vertical wells on a square lattice
+  const std::size_t nw = static_cast<std::size_t>(std::ceil(std::sqrt(options.n_wells)));
+  for (std::size_t i = 0; i < options.n_wells; ++i)
+  {
+    const double x = (i % nw + 0.5) / nw * mesh_config.lx + sx;
+    const double y = (i / nw + 0.5) / nw * mesh_config.ly + sy;
+    WellConfig well;
+    well.name = "well" + std::to_string(i);
+    well.radius = 0.1;
+    well.coordinates = {{x, y, mesh_config.lz - sz}, {x, y, sz}};
+    well.perforated = {true};
+    config.wells.push_back(well);
+  }
+  return config;
+}
+
+
+template <typename Func>
+void stage(const std::string & name, Func && f)
+{
+  const profiling::ScopedTimer timer(name);
+  f();
+}
+
+
+// run the whole pipeline on a mesh with about n_cells cells
+// returns the number of faces in the mesh
+std::size_t run(const BenchmarkOptions & options, const std::size_t n_cells,
+                const std::string & output_dir)
+{
+  const benchmark::BoxMeshConfig mesh_config = make_mesh_config(options, n_cells);
+  SimdataConfig config = make_config(options, mesh_config);
+  const std::string msh_file = output_dir + "benchmark.msh";
+
+  {
+    mesh::Mesh generated;
+    stage("generate mesh", [&] {benchmark::MeshGenerator::generate(mesh_config, generated);});
+    stage("write gmsh", [&] {benchmark::MeshGenerator::write_gmsh(generated, msh_file);});
+  }
+
+  mesh::Mesh msh;
+  stage("GmshReader", [&] {Parsers::GmshReader::read_input(msh_file, msh);});
+  const std::size_t n_faces = msh.n_faces();
+
+  // the engine times its stages itself
+  engine::Engine preprocessor(msh, config);
+  preprocessor.run();
+  preprocessor.write_output(output_dir);
+  return n_faces;
+}
+
+
+// throughput of the stages of a benchmark run
+void print_throughput(const std::string & run_name,
+                      const std::size_t n_cells, const std::size_t n_faces)
+{
+  const auto & stages = profiling::Profiler::instance().get_stages();
+  std::size_t run_id = stages.size();
+  for (std::size_t i = 0; i < stages.size(); ++i)
+    if (stages[i].name == run_name && stages[i].parent == profiling::StageRecord::none)
+      run_id = i;
+  if (run_id == stages.size()) return;
+
+  std::cout << std::endl << run_name << ": "
+            << n_cells << " cells, " << n_faces << " faces" << std::endl;
+  std::cout << std::left << std::setw(32) << "stage" << std::right
+            << std::setw(12) << "time [s]"
+            << std::setw(16) << "cells/s"
+            << std::setw(16) << "faces/s" << std::endl;
+  for (const auto & stage : stages)
+    if (stage.parent == run_id || &stage == &stages[run_id])
+    {
+      const double t = std::max(stage.seconds, 1e-9);
+      std::cout << std::left << std::setw(32) << stage.name << std::right
+                << std::setw(12) << std::fixed << std::setprecision(3) << stage.seconds
+                << std::setw(16) << std::scientific << std::setprecision(3) << n_cells / t
+                << std::setw(16) << n_faces / t
+                << std::defaultfloat << std::endl;
+    }
+}
+
+}  // end anonymous namespace
+
+
+int main(int argc, char *argv[])
+{
+  BenchmarkOptions options;
+  try
+  {
+    options = parse_options(argc, argv);
+  }
+  catch (const std::exception & e)
+  {
+    std::cout << e.what() << std::endl;
+    std::cout << "usage: msh2gprs_benchmark [--cells N1,N2,...] [--type hex|prism|tet]"
+              << " [--efracs n] [--dfm n] [--wells n] [--output dir]"
+              << " [--profile report.json] [--threads n]" << std::endl;
+    return 1;
+  }
+  parallel::ThreadPool::set_n_threads(options.n_threads);
+
+  // ::filesystem: gprs-data headers pull std into the global namespace
+  ::filesystem::create_directories(options.output_dir);
+  const std::string output_dir =
+      std::string(::filesystem::absolute(options.output_dir)) + "/";
+
+  struct RunInfo {std::string name; std::size_t n_cells, n_faces;};
+  std::vector<RunInfo> runs;
+  for (const std::size_t n_cells : options.cells)
+  {
+    const benchmark::BoxMeshConfig mesh_config = make_mesh_config(options, n_cells);
+    const std::size_t n = mesh_config.nx;
+    std::size_t cells_per_box = 1;
+    if (options.type == benchmark::CellType::prism) cells_per_box = 2;
+    else if (options.type == benchmark::CellType::tet) cells_per_box = 6;
+    const std::size_t actual_cells = n * n * n * cells_per_box;
+
+    const std::string run_name = type_name(options.type) + " " + std::to_string(actual_cells);
+    std::cout << "running benchmark " << run_name << std::endl;
+    std::size_t n_faces;
+    {
+      const profiling::ScopedTimer timer(run_name);
+      n_faces = run(options, n_cells, output_dir);
+    }
+    runs.push_back({run_name, actual_cells, n_faces});
+  }
+
+  std::cout << std::endl;
+  profiling::Profiler::instance().print_summary(std::cout);
+  for (const auto & info : runs)
+    print_throughput(info.name, info.n_cells, info.n_faces);
+
+  if (!options.profile_file.empty())
+    profiling::Profiler::instance().write_json(options.profile_file);
+  return 0;
+}
@@ -0,0 +1,165 @@
+#include "Engine.hpp"
+#include "gprs-data/OutputDataGPRS.hpp"
+#include "gprs-data/OutputDataVTK.hpp"
+#include "gprs-data/Renumbering.hpp"
+#include "profiling/Profiler.hpp"
+
+#include <stdexcept>  // std::invalid_argument, std::logic_error
+
+namespace engine
+{
+
+Engine::Engine(mesh::Mesh & grid, const SimdataConfig & config)
+    :
+    data(grid, config)
+{
+  // before any stage, so that all of them work on the reordered grid
+  if (config.renumbering != RenumberingMethod::none)
+  {
+    const profiling::ScopedTimer timer("renumbering");
+    std::cout << "renumbering cells and vertices" << std::endl;
+    data.cell_renumbering = gprs_data::renumber_mesh(grid, config.renumbering);
+  }
+}
+
+
+Engine::Engine(const mesh::Mesh & grid, const SimdataConfig & config)
+    :
+    // no stage writes to the grid unless modifies_grid(config)
+    data(const_cast<mesh::Mesh &>(grid), config),
+    read_only_grid(true)
+{
+  if (modifies_grid(config))
+    throw std::invalid_argument("config modifies the grid (renumbering or dfm faces): "
+                                "the engine needs its own copy of the grid");
+}
+
+
+bool Engine::modifies_grid(const SimdataConfig & config)
+{
+  return config.renumbering != RenumberingMethod::none ||
+      !config.discrete_fractures.empty();
+}
+
+
+void Engine::run(const Stage last)
+{
+  for (; n_done <= static_cast<std::size_t>(last); ++n_done)
+    run_stage(static_cast<Stage>(n_done));
+}
+
+
+bool Engine::done(const Stage stage) const
+{
+  return static_cast<std::size_t>(stage) < n_done;
+}
+
+
+void Engine::run_stage(const Stage stage)
+{
+  switch (stage)
+  {
+    case Stage::rock_properties :
+      {
+        const profiling::ScopedTimer timer("rock properties");
+        std::cout << "Fill 3D rock properties" << std::endl;
+        data.defineRockProperties();
+        break;
+      }
+    case Stage::embedded_fracture_properties :
+      {
+        const profiling::ScopedTimer timer("embedded fracture properties");
+        std::cout << "Make SDA properties" << std::endl;
+        data.defineEmbeddedFractureProperties();
+        break;
+      }
+    case Stage::physical_facets :
+      {
+        const profiling::ScopedTimer timer("physical facets");
+        std::cout << "Create physical facets" << std::endl;
+        data.definePhysicalFacets();
+        break;
+      }
+    case Stage::reservoir_transmissibilities :
+      {
+        const profiling::ScopedTimer timer("reservoir transmissibilities");
+        std::cout << "computing reservoir transes" << std::endl;
+        data.computeReservoirTransmissibilities();
+        break;
+      }
+    case Stage::embedded_fractures :
+      {
+        const profiling::ScopedTimer timer("embedded fractures");
+        std::cout << "Handle flow embedded fractures" << std::endl;
+        data.handleEmbeddedFractures();
+        break;
+      }
+    case Stage::wells :
+      {
+        const profiling::ScopedTimer timer("wells");
+        std::cout << "Setup wells" << std::endl;
+        data.setupWells();
+        break;
+      }
+    case Stage::split_internal_faces :
+      {
+        if (data.dfm_faces.empty()) break;
+        if (read_only_grid)
+          throw std::logic_error("cannot split dfm faces of a shared grid");
+        const profiling::ScopedTimer timer("split internal faces");
+        std::cout << "Split FEM mesh on internal surfaces" << std::endl;
+        data.splitInternalFaces();
+        break;
+      }
+    case Stage::mech_flow_connections :
+      {
+        const profiling::ScopedTimer timer("mech-flow connections");
+        std::cout << "compute connections between mech and flow elements" << std::endl;
+        data.handleConnections();
+        break;
+      }
+    case Stage::multiscale_data :
+      {
+        const profiling::ScopedTimer timer("multiscale data");
+        std::cout << "build multiscale data" << std::endl;
+        data.build_multiscale_data();
+        break;
+      }
+  }
+}
+
+
+void Engine::write_output(const std::string & output_dir)
+{
+  run();
+
+  std::cout << "Write Output data" << std::endl;
+  for (const auto format : data.config.output_formats)
+  {
+    switch (format)
+    {
+      case OutputFormat::gprs :
+        {
+          const profiling::ScopedTimer timer("write gprs output");
+          std::cout << "Output gprs format" << std::endl;
+          gprs_data::OutputDataGPRS output_data(data, data.grid);
+          output_data.write_output(output_dir);
+          break;
+        }
+      case OutputFormat::vtk :
+      case OutputFormat::vtk_binary :
+      case OutputFormat::vtu :
+      case OutputFormat::vtu_compressed :
+      case OutputFormat::pvtu :
+        {
+          const profiling::ScopedTimer timer("write vtk output");
+          std::cout << "Output vtk format" << std::endl;
+          gprs_data::OutputDataVTK output_data(data, data.grid, format);
+          output_data.write_output(output_dir);
+          break;
+        }
+    }
+  }
+}
+
+}  // end namespace engine
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "gprs-data/simdata.hpp"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace engine
+{
+
+// preprocessing stages in the order they run
+enum class Stage : int
+{
+  rock_properties = 0,
+  embedded_fracture_properties,
+  physical_facets,
+  reservoir_transmissibilities,
+  embedded_fractures,
+  wells,
+  split_internal_faces,
+  mech_flow_connections,
+  multiscale_data
+};
+
+
+/* Preprocessing engine for embedding msh2gprs into other programs.
+ * Takes a mesh built in memory (e.g. with Parsers::GmshReader or by hand)
+ * and a config, runs the preprocessing stages and exposes the results
+ * as read-only views, so the caller does not need to write and parse
+ * the text output. Output files can still be written with write_output.
+ *
+ * Usage:
+ *   mesh::Mesh grid = ...;
+ *   engine::Engine engine(grid, config);
+ *   engine.run(engine::Stage::reservoir_transmissibilities);  // flow only
+ *   const flow::FlowData & flow = engine.flow_data();
+ *
+ * Note: the grid must outlive the engine; renumbering and splitting
+ * dfm faces modify it. A grid that is shared (e.g. by the realisations of
+ * a batch run) is passed by const reference: the engine then only reads it
+ * and refuses configs that would modify it (see modifies_grid).
+ * With config.stream_connections the reservoir connections that are
+ * streamed to the output are not in flow_data(). */
+class Engine
+{
+ public:
+  // renumbers the grid if config.renumbering is set
+  Engine(mesh::Mesh & grid, const SimdataConfig & config);
+  // read-only use of a shared grid; several engines may read it concurrently.
+  // throws std::invalid_argument if modifies_grid(config)
+  Engine(const mesh::Mesh & grid, const SimdataConfig & config);
+  // whether the stages may modify the grid (renumbering, dfm faces to split)
+  static bool modifies_grid(const SimdataConfig & config);
+  // run all stages up to and including last; stages that already ran are skipped
+  void run(const Stage last = Stage::multiscale_data);
+  // whether the stage has been run
+  bool done(const Stage stage) const;
+  // run the remaining stages and write files in all config.output_formats
+  void write_output(const std::string & output_dir);
+
+  // results
+  const SimdataConfig & config() const {return data.config;}
+  const mesh::Mesh & grid() const {return data.grid;}
+  // flow control volumes and connections
+  const flow::FlowData & flow_data() const {return data.flow_data;}
+  // user-defined cell properties and their names
+  const std::vector<gprs_data::RockProps> & rock_properties() const {return data.vsCellRockProps;}
+  const std::vector<std::string> & rock_property_names() const {return data.rockPropNames;}
+  const std::vector<gprs_data::EmbeddedFracture> & embedded_fractures() const {return data.vEfrac;}
+  // face index -> dfm face
+  const std::unordered_map<std::size_t, gprs_data::PhysicalFace> &
+  discrete_fractures() const {return data.dfm_faces;}
+  // face index -> face with mechanical boundary conditions
+  const std::unordered_map<std::size_t, gprs_data::PhysicalFace> &
+  boundary_faces() const {return data.boundary_faces;}
+  const std::vector<Well> & wells() const {return data.wells;}
+  // flow control volumes of each mechanics cell
+  const std::vector<std::vector<std::size_t>> &
+  mech_to_flow_cells() const {return data.gm_cell_to_flow_cell;}
+  const multiscale::MultiScaleOutputData & multiscale_flow() const {return data.ms_flow_data;}
+  const multiscale::MultiScaleOutputData & multiscale_mechanics() const {return data.ms_mech_data;}
+  // everything else
+  const gprs_data::SimData & sim_data() const {return data;}
+
+ private:
+  // run a single stage (timed with the profiler)
+  void run_stage(const Stage stage);
+
+  gprs_data::SimData data;
+  const bool read_only_grid = false;  // grid is shared with others
+  std::size_t n_done = 0;  // number of stages that have been run
+};
+
+}  // end namespace engine
@@ -0,0 +1,150 @@
+#include "BufferedWriter.hpp"
+
+#include <algorithm>  // std::max
+#include <cstring>    // std::strlen, std::memcpy
+#include <stdexcept>  // std::runtime_error
+
+namespace IO
+{
+
+BufferedWriter::BufferedWriter(const std::string & file_name,
+                               const std::size_t buffer_size)
+    :
+    out(file_name.c_str()),
+    buffer(std::max(buffer_size, std::size_t(1024)))
+{
+  if (!out)
+    throw std::runtime_error("cannot open file " + file_name);
+}
+
+
+BufferedWriter::BufferedWriter()
+    :
+    in_memory(true),
+    buffer(1 << 16)
+{}
+
+
+BufferedWriter::~BufferedWriter()
+{
+  close();
+}
+
+
+void BufferedWriter::close()
+{
+  if (!out.is_open()) return;
+  flush_buffer();
+  out.close();
+}
+
+
+void BufferedWriter::make_room(const std::size_t n)
+{
+  if (in_memory)
+    buffer.resize(std::max(2 * buffer.size(), pos + n));
+  else
+    flush_buffer();
+}
+
+
+void BufferedWriter::flush_buffer()
+{
+  out.write(buffer.data(), pos);
+  pos = 0;
+}
+
+
+void BufferedWriter::write(const char * str, const std::size_t size)
+{
+  if (size > buffer.size() && !in_memory)
+  {
+    flush_buffer();
+    out.write(str, size);
+    return;
+  }
+  reserve(size);
+  std::memcpy(buffer.data() + pos, str, size);
+  pos += size;
+}
+
+
+BufferedWriter & BufferedWriter::operator<<(const char * str)
+{
+  write(str, std::strlen(str));
+  return *this;
+}
+
+
+BufferedWriter & BufferedWriter::operator<<(const std::string & str)
+{
+  write(str.c_str(), str.size());
+  return *this;
+}
+
+
+BufferedWriter & BufferedWriter::operator<<(const char c)
+{
+  reserve(1);
+  buffer[pos++] = c;
+  return *this;
+}
+
+
+BufferedWriter & BufferedWriter::operator<<(const bool value)
+{
+  return (*this) << (value ? '1' : '0');
+}
+
+
+BufferedWriter & BufferedWriter::operator<<(const double value)
+{
+  const auto floatfield = format.flags() & std::ios_base::floatfield;
+  const int precision = static_cast<int>(format.precision());
+
+  std::chars_format fmt;
+  if (floatfield == std::ios_base::scientific)
+    fmt = std::chars_format::scientific;
+  else if (floatfield == std::ios_base::fixed)
+  {
+    // fixed notation can be arbitrary long
+    fmt = std::chars_format::fixed;
+    reserve(512);
+  }
+  else if (floatfield == 0)
+    fmt = std::chars_format::general;
+  else  // hexfloat and friends
+  {
+    write_stream(value);
+    return *this;
+  }
+
+  // ostream treats zero precision as 1 in general notation
+  reserve(64 + precision);
+  const auto result = std::to_chars(buffer.data() + pos, buffer.data() + buffer.size(),
+                                    value, fmt, (fmt == std::chars_format::general && precision == 0)
+                                    ? 1 : precision);
+  if (result.ec != std::errc())  // does not fit (e.g. fixed 1e300)
+    write_stream(value);
+  else
+    pos = result.ptr - buffer.data();
+  return *this;
+}
+
+
+void BufferedWriter::write_stream(const double value)
+{
+  format.str("");
+  format << value;
+  const std::string str = format.str();
+  write(str.c_str(), str.size());
+}
+
+
+BufferedWriter & BufferedWriter::operator<<(std::ios_base & (*manipulator)(std::ios_base &))
+{
+  manipulator(format);
+  return *this;
+}
+
+}  // end namespace IO
@@ -0,0 +1,146 @@
+#pragma once
+
+#include "parallel/parallel_for.hpp"
+
+#include <charconv>     // std::to_chars
+#include <fstream>
+#include <sstream>      // fallback formatting
+#include <string>
+#include <type_traits>  // std::is_integral
+#include <vector>
+
+namespace IO
+{
+
+/* Text writer for large keyword files.
+ * Numbers are formatted with std::to_chars into a large buffer,
+ * and the buffer is written to disk only when it is full and when
+ * the file is closed (no flushes in between).
+ * Number formatting follows std::ostream rules (default precision 6,
+ * std::scientific / std::fixed / std::defaultfloat manipulators),
+ * so the output is byte-identical to writing into std::ofstream.
+ * Types without a fast path (e.g. angem::Point) go through operator<<
+ * of an internal string stream with the same format flags.
+ * Large arrays can be formatted in parallel with write_parallel. */
+class BufferedWriter
+{
+ public:
+  // open file for writing; throws std::runtime_error on failure
+  explicit BufferedWriter(const std::string & file_name,
+                          const std::size_t buffer_size = 1 << 22);
+  // in-memory writer: the buffer grows instead of being written to a file
+  BufferedWriter();
+  // closes the file
+  ~BufferedWriter();
+  // write the remaining buffer and close the file
+  void close();
+  // set floating point precision (same as std::ostream::precision)
+  void precision(const int value) {format.precision(value);}
+  // append raw characters
+  void write(const char * str, const std::size_t size);
+  // contents of an in-memory writer
+  const char * data() const {return buffer.data();}
+  std::size_t size() const {return pos;}
+  // discard the contents of an in-memory writer
+  void clear() {pos = 0;}
+
+  BufferedWriter & operator<<(const char * str);
+  BufferedWriter & operator<<(const std::string & str);
+  BufferedWriter & operator<<(const char c);
+  BufferedWriter & operator<<(const bool value);
+  BufferedWriter & operator<<(const double value);
+  BufferedWriter & operator<<(const float value) {return (*this) << static_cast<double>(value);}
+  // std::scientific, std::fixed, std::defaultfloat, etc.
+  BufferedWriter & operator<<(std::ios_base & (*manipulator)(std::ios_base &));
+
+  // integers
+  template<typename T>
+  typename std::enable_if<std::is_integral<T>::value, BufferedWriter &>::type
+  operator<<(const T value);
+
+  // everything else: format with an ostream
+  template<typename T>
+  typename std::enable_if<!std::is_arithmetic<T>::value, BufferedWriter &>::type
+  operator<<(const T & value);
+
+  /* Write n items, formatter(chunk, i) writes item i into chunk writer.
+   * Items are split into chunks that are formatted concurrently into
+   * in-memory writers and then appended in order, so the output is
+   * the same as calling formatter(*this, i) for i = 0..n-1.
+   * formatter must be safe to call concurrently for different i. */
+  template<typename Func>
+  void write_parallel(const std::size_t n, Func && formatter);
+
+ private:
+  // make sure there is space for n characters in the buffer
+  inline void reserve(const std::size_t n) {if (pos + n > buffer.size()) make_room(n);}
+  // flush the buffer into the file or grow it if there is no file
+  void make_room(const std::size_t n);
+  // dump buffer into the file
+  void flush_buffer();
+  // format a number with the string stream (no fast path)
+  void write_stream(const double value);
+
+  std::ofstream out;
+  bool in_memory = false;
+  std::vector<char> buffer;
+  std::size_t pos = 0;
+  std::ostringstream format;  // holds format flags and formats fallback types
+};
+
+
+template<typename T>
+typename std::enable_if<std::is_integral<T>::value, BufferedWriter &>::type
+BufferedWriter::operator<<(const T value)
+{
+  reserve(24);
+  const auto result = std::to_chars(buffer.data() + pos, buffer.data() + buffer.size(), value);
+  pos = result.ptr - buffer.data();
+  return *this;
+}
+
+
+template<typename T>
+typename std::enable_if<!std::is_arithmetic<T>::value, BufferedWriter &>::type
+BufferedWriter::operator<<(const T & value)
+{
+  format.str("");
+  format << value;
+  const std::string str = format.str();
+  write(str.c_str(), str.size());
+  return *this;
+}
+
+
+
+template<typename Func>
+void BufferedWriter::write_parallel(const std::size_t n, Func && formatter)
+{
+  // items per chunk; small enough to keep memory bounded
+  const std::size_t chunk_size = 8192;
+  const std::size_t n_chunks = parallel::default_n_threads();
+  std::vector<BufferedWriter> chunks(n_chunks);
+  for (auto & chunk : chunks)
+  {
+    chunk.format.flags(format.flags());
+    chunk.format.precision(format.precision());
+  }
+
+  for (std::size_t first = 0; first < n; first += chunk_size * n_chunks)
+  {
+    parallel::parallel_for(0, n_chunks, [&](const std::size_t ichunk)
+    {
+      auto & chunk = chunks[ichunk];
+      chunk.pos = 0;
+      const std::size_t begin = std::min(n, first + ichunk * chunk_size);
+      const std::size_t end = std::min(n, begin + chunk_size);
+      for (std::size_t i = begin; i < end; ++i)
+        formatter(chunk, i);
+    }, n_chunks, 1);
+
+    for (const auto & chunk : chunks)
+      write(chunk.buffer.data(), chunk.pos);
+  }
+}
+
+}  // end namespace IO
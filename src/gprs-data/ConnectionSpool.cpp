@@ -0,0 +1,86 @@
+#include "ConnectionSpool.hpp"
+#include "transes.hpp"
+
+#include <stdexcept>  // std::runtime_error
+
+namespace flow
+{
+
+namespace
+{
+// flush formatted lines to disk when the buffer exceeds this size
+const std::size_t spool_buffer_size = 1 << 22;
+}
+
+
+ConnectionSpool::ConnectionSpool()
+    :
+    connections_file(std::tmpfile()),
+    geometric_file(std::tmpfile())
+{
+  if (!connections_file || !geometric_file)
+  {
+    if (connections_file) std::fclose(connections_file);
+    if (geometric_file) std::fclose(geometric_file);
+    throw std::runtime_error("cannot create temporary files for flow connections");
+  }
+}
+
+
+ConnectionSpool::~ConnectionSpool()
+{
+  // temporary files are deleted when closed
+  std::fclose(connections_file);
+  std::fclose(geometric_file);
+}
+
+
+void ConnectionSpool::add(const std::size_t ielement, const std::size_t jelement,
+                          const FaceData & face)
+{
+  CalcTranses::write_connection(connections, ielement, jelement, face);
+  n_connections++;
+  if (CalcTranses::write_geometric_data(geometric, n_geometric, face))
+    n_geometric++;
+
+  if (connections.size() > spool_buffer_size)
+    flush(connections, connections_file);
+  if (geometric.size() > spool_buffer_size)
+    flush(geometric, geometric_file);
+}
+
+
+void ConnectionSpool::copy_connections(IO::BufferedWriter & out)
+{
+  copy(connections_file, connections, out);
+}
+
+
+void ConnectionSpool::copy_geometric_data(IO::BufferedWriter & out)
+{
+  copy(geometric_file, geometric, out);
+}
+
+
+void ConnectionSpool::flush(IO::BufferedWriter & buffer, std::FILE * file)
+{
+  if (std::fwrite(buffer.data(), 1, buffer.size(), file) != buffer.size())
+    throw std::runtime_error("failed writing temporary file for flow connections");
+  buffer.clear();
+}
+
+
+void ConnectionSpool::copy(std::FILE * file, IO::BufferedWriter & buffer,
+                           IO::BufferedWriter & out)
+{
+  flush(buffer, file);
+  std::rewind(file);
+  std::vector<char> chunk(spool_buffer_size);
+  std::size_t n_read;
+  while ((n_read = std::fread(chunk.data(), 1, chunk.size(), file)) > 0)
+    out.write(chunk.data(), n_read);
+  // later connections are appended
+  std::fseek(file, 0, SEEK_END);
+}
+
+}  // end namespace flow
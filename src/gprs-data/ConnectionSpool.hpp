@@ -0,0 +1,47 @@
+#pragma once
+
+#include "FlowData.hpp"
+#include "BufferedWriter.hpp"
+
+#include <cstdio>  // std::FILE
+
+namespace flow
+{
+
+/* Flow connections that are written out before the rest of the flow data is ready.
+ * Lines of TPFACONNS and GMUPDATETRANS keywords are formatted when the
+ * connections are added and parked in anonymous temporary files, so the
+ * connections do not stay in memory for the rest of the pipeline.
+ * CalcTranses::save_output writes them ahead of the connections in FlowData. */
+class ConnectionSpool
+{
+ public:
+  // throws std::runtime_error if the temporary files cannot be created
+  ConnectionSpool();
+  ~ConnectionSpool();
+  ConnectionSpool(const ConnectionSpool &) = delete;
+  ConnectionSpool & operator=(const ConnectionSpool &) = delete;
+  // format the connection between two flow elements and drop it from memory
+  void add(const std::size_t ielement, const std::size_t jelement, const FaceData & face);
+  // number of spooled connections
+  std::size_t size() const {return n_connections;}
+  // number of spooled GMUPDATETRANS entries
+  std::size_t n_geometric_entries() const {return n_geometric;}
+  // append spooled TPFACONNS lines to out
+  void copy_connections(IO::BufferedWriter & out);
+  // append spooled GMUPDATETRANS lines to out
+  void copy_geometric_data(IO::BufferedWriter & out);
+
+ private:
+  // move formatted lines from the in-memory buffer into the file
+  static void flush(IO::BufferedWriter & buffer, std::FILE * file);
+  // append the whole file to out
+  static void copy(std::FILE * file, IO::BufferedWriter & buffer, IO::BufferedWriter & out);
+
+  std::FILE * connections_file = nullptr;
+  std::FILE * geometric_file = nullptr;
+  IO::BufferedWriter connections, geometric;  // in-memory
+  std::size_t n_connections = 0, n_geometric = 0;
+};
+
+}  // end namespace flow
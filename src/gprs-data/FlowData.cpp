@@ -2,6 +2,8 @@
 
 #include <algorithm> // std::sort
 #include <iostream>  // debug
+#include <limits>    // std::numeric_limits
+#include <stdexcept> // std::out_of_range
 
 
 namespace flow
@@ -20,6 +22,9 @@ void FlowData::merge_elements(const std::size_t updated_element,
       u = updated_element,
       d = merged_element;
 
+  if (std::max(u, d) >= cells.size())
+    throw std::out_of_range("element does not exist: " + std::to_string(std::max(u, d)));
+
   const double v0 = cells[u].volume;
   const double v1 = cells[d].volume;
   cells[u].volume += v1;
@@ -31,58 +36,54 @@ void FlowData::merge_elements(const std::size_t updated_element,
 
   // update face data
   // connections and transes with other elements
-  if (d > v_neighbors.size())
+  if (d >= v_neighbors.size())
     throw std::runtime_error("connection apparently does not exist");
+  // copy since clear_connection modifies v_neighbors[d]
   const std::vector<std::size_t> neighbors = v_neighbors[d];
 
   for (const std::size_t neighbor : neighbors)
   {
-    // const std::size_t dead_conn = connection_index(d, neighbor);
-    flow::FaceData dead_connection = get_connection(d, neighbor);
-    if (neighbor != u)
+    if (neighbor == u)
+      continue;
+
+    const flow::FaceData & dead_connection = get_connection(d, neighbor);
+    if (!connection_exists(u, neighbor))
     {
-      if (!connection_exists(u, neighbor))
-      {
-        flow::FaceData new_face = insert_connection(d, neighbor);
-        flow::FaceData modified_face = get_connection(u, neighbor);
-        new_face.transmissibility = modified_face.transmissibility;
-        new_face.thermal_conductivity = modified_face.thermal_conductivity;
-        new_face.conType = modified_face.conType;
-        std::size_t new_face_conN = modified_face.conCV.size();
-        new_face.conCV.resize(new_face_conN);
-        new_face.conTr.resize(new_face_conN);
-        new_face.conArea.resize(new_face_conN);
-        new_face.conPerm.resize(new_face_conN);
-        for(std::size_t m=0; m < new_face_conN; m++){
-            new_face.zVolumeFactor.resize(new_face_conN);
-            if(modified_face.conCV[m] == d){
-                new_face.conCV[m] = u;
-            } else{
-                new_face.conCV[m] = modified_face.conCV[m];
-            }
-            new_face.conTr[m] = modified_face.conTr[m];
-            new_face.conArea[m] = modified_face.conArea[m];
-            new_face.conPerm[m] = modified_face.conPerm[m];
-            new_face.zVolumeFactor[m] = modified_face.zVolumeFactor[m];
-        }
-      }
-      else
+      // same connection with d replaced by u
+      flow::FaceData & new_face = insert_connection(u, neighbor);
+      new_face = dead_connection;
+      for (double & cv : new_face.conCV)
+        if (static_cast<std::size_t>(cv) == d)
+          cv = u;
+    }
+    else
+    {
+      flow::FaceData & modified_face = get_connection(u, neighbor);
+      modified_face.transmissibility += dead_connection.transmissibility;
+      modified_face.thermal_conductivity += dead_connection.thermal_conductivity;
+      for (std::size_t m=0; m<modified_face.conCV.size(); m++)
       {
-        flow::FaceData modified_face = get_connection(u, neighbor);
-        std::size_t modified_face_conN = modified_face.conCV.size();
-        modified_face.transmissibility += dead_connection.transmissibility;
-        modified_face.thermal_conductivity += dead_connection.thermal_conductivity;
-        for(std::size_t m=0; m < modified_face_conN; m++){
-            modified_face.conTr[m] += dead_connection.conTr[m];
-            modified_face.conArea[m] += dead_connection.conArea[m];
-            modified_face.zVolumeFactor[m] = (v0*modified_face.zVolumeFactor[m] + v1*dead_connection.zVolumeFactor[m]) / (v0 + v1);
-            modified_face.conPerm[m] = modified_face.conTr[m]*modified_face.zVolumeFactor[m]/modified_face.conArea[m];
-        }
+        // control volume of the dead connection that corresponds to conCV[m]
+        const std::size_t cv = static_cast<std::size_t>(modified_face.conCV[m]);
+        const std::size_t dead_cv = (cv == u) ? d : cv;
+        std::size_t k = 0;
+        while (k < dead_connection.conCV.size() &&
+               static_cast<std::size_t>(dead_connection.conCV[k]) != dead_cv)
+          k++;
+        if (k == dead_connection.conCV.size())
+          continue;
+
+        modified_face.conTr[m] += dead_connection.conTr[k];
+        modified_face.conArea[m] += dead_connection.conArea[k];
+        modified_face.zVolumeFactor[m] = (v0*modified_face.zVolumeFactor[m] +
+                                          v1*dead_connection.zVolumeFactor[k]) / (v0 + v1);
+        modified_face.conPerm[m] = modified_face.conTr[m]*modified_face.zVolumeFactor[m]/modified_face.conArea[m];
       }
     }
   }
 
-  delete_element(d);
+  for (const std::size_t neighbor : neighbors)
+    clear_connection(d, neighbor);
 }
 
 
@@ -136,6 +137,52 @@ void FlowData::delete_element(const std::size_t element)
 }
 
 
+void FlowData::delete_elements(const std::vector<bool> & deleted)
+{
+  // connections already written out refer to the old element indices
+  if (spool)
+    throw std::runtime_error("cannot delete elements of streamed flow data");
+
+  const std::size_t n_elements = std::max(cells.size(), v_neighbors.size());
+  const std::size_t dead = std::numeric_limits<std::size_t>::max();
+  std::vector<std::size_t> new_index(n_elements, dead);
+  std::size_t n_kept = 0;
+  for (std::size_t i=0; i<n_elements; ++i)
+    if (i >= deleted.size() || !deleted[i])
+      new_index[i] = n_kept++;
+
+  std::vector<CellData> new_cells;
+  new_cells.reserve(cells.size());
+  for (std::size_t i=0; i<cells.size(); ++i)
+    if (new_index[i] != dead)
+      new_cells.push_back(std::move(cells[i]));
+  cells = std::move(new_cells);
+
+  std::vector<std::vector<std::size_t>> new_neighbors(n_kept);
+  for (std::size_t i=0; i<v_neighbors.size(); ++i)
+    if (new_index[i] != dead)
+      for (const std::size_t neighbor : v_neighbors[i])
+        if (new_index[neighbor] != dead)
+          new_neighbors[new_index[i]].push_back(new_index[neighbor]);
+  v_neighbors = std::move(new_neighbors);
+
+  std::unordered_map<std::size_t, FaceData> new_connections;
+  new_connections.reserve(map_connection.size());
+  for (auto & conn : map_connection)
+  {
+    const std::size_t i = conn.first / max_connections;
+    const std::size_t j = conn.first % max_connections;
+    if (new_index[i] == dead || new_index[j] == dead)
+      continue;
+    for (double & cv : conn.second.conCV)
+      cv = new_index[static_cast<std::size_t>(cv)];
+    new_connections.insert({hash_value(new_index[i], new_index[j]),
+                            std::move(conn.second)});
+  }
+  map_connection = std::move(new_connections);
+}
+
+
 FaceData & FlowData::get_connection(const std::size_t ielement,
                                     const std::size_t jelement)
 {
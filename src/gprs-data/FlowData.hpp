@@ -3,12 +3,15 @@
 #include <vector>
 #include <string>
 #include <unordered_map>
+#include <memory>  // std::shared_ptr
 #include <iostream>  // debug
 
 
 namespace flow
 {
 
+class ConnectionSpool;
+
 
 struct CellData
 {
@@ -52,11 +55,19 @@ class FlowData
   // get two elements from hash value
   std::pair<std::size_t,std::size_t>
   invert_hash(const std::size_t hash) const;
+  // add merged_element to updated_element: volumes are summed, properties
+  // are volume-averaged, and connections of merged_element are moved to
+  // updated_element. merged_element is left without connections but is not
+  // deleted (no renumbering), so the complexity is linear to the number of its
+  // neighbors; remove merged elements with delete_elements afterwards
   void merge_elements(const std::size_t updated_element,
                       const std::size_t merged_element);
   void clear_connection(const std::size_t ielement,
                         const std::size_t jelement);
   void delete_element(const std::size_t element);
+  // delete all elements with deleted[element] == true and their connections
+  // and renumber the remaining elements in one pass
+  void delete_elements(const std::vector<bool> & deleted);
 
 
  private:
@@ -70,6 +81,9 @@ class FlowData
   std::vector<CellData> cells;
   std::vector<FaceData> faces;
   std::vector<std::string>         custom_names;
+  // connections already formatted for output and removed from map_connection
+  // (streaming mode, see SimdataConfig::stream_connections)
+  std::shared_ptr<ConnectionSpool> spool;
 
  private:
   std::size_t max_connections;
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+namespace gprs_data
+{
+
+/* Lookup table marker -> index of a config entry (e.g. in config.bc_faces).
+ * Built once from the config labels so that face and cell classification
+ * does not scan the config entries for every element.
+ * Markers are gmsh physical tags (small non-negative numbers), so they are
+ * stored in a dense array; markers outside the dense range go into a hash map.
+ * Lookups are read-only and safe to do concurrently. */
+class MarkerTable
+{
+ public:
+  // add marker -> index; the first index of a marker is kept
+  // (same result as searching the config entries in order)
+  void insert(const int marker, const int index = 0)
+  {
+    if (marker >= 0 && marker < max_dense_marker)
+    {
+      if (static_cast<std::size_t>(marker) >= dense.size())
+        dense.resize(marker + 1, -1);
+      if (dense[marker] < 0)
+        dense[marker] = index;
+    }
+    else
+      sparse.insert({marker, index});
+  }
+  // index of the marker or -1 if it is not in the table
+  inline int find(const int marker) const
+  {
+    if (marker >= 0 && static_cast<std::size_t>(marker) < dense.size())
+      return dense[marker];
+    if (sparse.empty())
+      return -1;
+    const auto it = sparse.find(marker);
+    return (it != sparse.end()) ? it->second : -1;
+  }
+  // whether the marker is in the table
+  inline bool contains(const int marker) const {return find(marker) >= 0;}
+
+ private:
+  static constexpr int max_dense_marker = 1 << 20;
+  std::vector<int> dense;
+  std::unordered_map<int, int> sparse;
+};
+
+}  // end namespace gprs_data
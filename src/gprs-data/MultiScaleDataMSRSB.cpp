@@ -4,27 +4,31 @@
 #include "angem/Collisions.hpp"  // point_inside_surface
 #include "mesh/SurfaceMesh.hpp"  // to store support bounding surface
 #include "VTKWriter.hpp" // debug bounding region
+#include "parallel/parallel_for.hpp"
+#include "Renumbering.hpp"  // morton_code
 
 #include <unordered_set>
 #include <chrono>  // for high_resolution_clock debug timing
+#include <numeric>  // std::iota
 
 namespace multiscale {
 
 using Point = angem::Point<3,double>;
 using std::unordered_set;
 
-MultiScaleDataMSRSB::MultiScaleDataMSRSB(mesh::Mesh  & grid,
+MultiScaleDataMSRSB::MultiScaleDataMSRSB(const mesh::Mesh  & grid,
                                          const std::array<size_t,3> &  n_blocks,
                                          const PartitioningMethod method)
     :
     grid(grid),
+    cell_geometry(grid),
     active_layer_index(0),
     n_multiscale_blocks(n_blocks),
     partitioning_method(method)
 {
   auto & layer = layers.emplace_back();
   layer.index = 0;
-  if (method == PartitioningMethod::metis)
+  if (method == PartitioningMethod::metis || method == PartitioningMethod::morton)
     layer.n_blocks = n_blocks[0];
   else if (method == geometric)
     layer.n_blocks = n_blocks[0] * n_blocks[1] * n_blocks[2];
@@ -36,21 +40,28 @@ MultiScaleDataMSRSB::MultiScaleDataMSRSB(mesh::Mesh  & grid,
 
 
 void MultiScaleDataMSRSB::build_data()
+{
+  build_partitioning();
+  build_cells_in_block();
+
+  build_support_regions();
+}
+
+
+
+void MultiScaleDataMSRSB::build_partitioning()
 {
   std::cout << "building partitioning...";
   if (partitioning_method == PartitioningMethod::metis)
     build_metis_partitioning();
   else if (partitioning_method == geometric)
     build_geometric_partitioning();
+  else if (partitioning_method == PartitioningMethod::morton)
+    build_morton_partitioning();
   std::cout << "OK" << std::endl;
-
-  build_cells_in_block();
-
-  build_support_regions();
 }
 
 
-
 void MultiScaleDataMSRSB::build_metis_partitioning()
 {
   auto & layer = active_layer();
@@ -101,10 +112,10 @@ void MultiScaleDataMSRSB::find_centroids()
   layer.block_centroids.resize(layer.n_blocks);
   vector<size_t> n_cells_per_block(layer.n_blocks);
 
-  for (auto cell = grid.begin_cells(); cell != grid.end_cells(); ++cell)
+  for (size_t cell = 0; cell < grid.n_cells(); ++cell)
   {
-    const size_t block = layer.partitioning[cell.index()];
-    layer.block_centroids[block] += cell.center();
+    const size_t block = layer.partitioning[cell];
+    layer.block_centroids[block] += cell_geometry.center(cell);
     n_cells_per_block[block]++;
   }
 
@@ -114,13 +125,13 @@ void MultiScaleDataMSRSB::find_centroids()
   // find closest cell
   layer.coarse_to_fine.resize(layer.n_blocks);
   const auto max = std::numeric_limits<double>::max();
-  for (size_t block = 0; block < layer.n_blocks; ++block )
+  parallel::parallel_for(0, layer.n_blocks, [&](const size_t block)
   {
     double min_dist = max;
     size_t closest = 0;
     for (const size_t cell : layer.cells_in_block[block])
     {
-      const double current_dist = layer.block_centroids[block].distance(grid.get_center(cell));
+      const double current_dist = layer.block_centroids[block].distance(cell_geometry.center(cell));
       if ( current_dist <= min_dist )
       {
         closest = cell;
@@ -128,7 +139,7 @@ void MultiScaleDataMSRSB::find_centroids()
       }
     }
     layer.coarse_to_fine[block] = closest;
-  }
+  }, 0, 16);
 }
 
 
@@ -279,7 +290,7 @@ algorithms::UnionFindWrapper<size_t> MultiScaleDataMSRSB::build_external_face_di
          * (2) their normals don't have a crazy angle between 'em
          * (3) two faces share an edge (two connected vertices) */
         if (cell1 != cell2)                                      // criterion 1
-          if ( abs(dot(face1.normal(), face2.normal())) > 1e-4 ) // criterion 2
+          if ( abs(dot(face1.geometry().normal(), face2.geometry().normal())) > 1e-4 ) // criterion 2
             if ( share_edge(face1, face2) )                      // criterion 3
               face_disjoint.merge(face1.index(), face2.index());
       }
@@ -831,55 +842,73 @@ void MultiScaleDataMSRSB::build_geometric_partitioning()
 {
   auto & layer = active_layer();
 
-  struct dimensions
-  {
-    double x_min = +std::numeric_limits<double>::max(),
-           x_max = -std::numeric_limits<double>::max();
-    double y_min = +std::numeric_limits<double>::max(),
-           y_max = -std::numeric_limits<double>::max();
-    double z_min = +std::numeric_limits<double>::max(),
-           z_max = -std::numeric_limits<double>::max();
-    size_t nx, ny, nz;
-    double hx, hy, hz;
-  }; dimensions d;
-
-  for (const angem::Point<3,double> & v : grid.get_vertices())
-  {
-    if (v.x() < d.x_min) d.x_min = v.x();
-    if (v.x() > d.x_max) d.x_max = v.x();
-    if (v.y() < d.y_min) d.y_min = v.y();
-    if (v.y() > d.y_max) d.y_max = v.y();
-    if (v.z() < d.z_min) d.z_min = v.z();
-    if (v.z() > d.z_max) d.z_max = v.z();
-  }
-
-  const size_t ndir = 4;
-  d.nx = n_multiscale_blocks[0];
-  d.ny = n_multiscale_blocks[1];
-  d.nz = n_multiscale_blocks[2];
-
-  d.hx = 1.0 / d.nx;
-  d.hy = 1.0 / d.ny;
-  d.hz = 1.0 / d.nz;
+  const Point & lower = cell_geometry.domain_min();
+  const Point & upper = cell_geometry.domain_max();
+  const size_t nx = n_multiscale_blocks[0];
+  const size_t ny = n_multiscale_blocks[1];
+  const size_t nz = n_multiscale_blocks[2];
+  const double hx = 1.0 / nx;
+  const double hy = 1.0 / ny;
+  const double hz = 1.0 / nz;
 
   layer.partitioning.resize(grid.n_cells());
-  for (auto cell = grid.begin_cells(); cell != grid.end_cells(); ++cell)
+  parallel::parallel_for(0, grid.n_cells(), [&](const size_t cell)
   {
-    const auto c = cell.center();
+    const Point & c = cell_geometry.center(cell);
 
     // normalized x and y
-    const double xn = (c.x() - d.x_min) / (d.x_max - d.x_min);
-    const double yn = (c.y() - d.y_min) / (d.y_max - d.y_min);
-    const double zn = (c.z() - d.z_min) / (d.z_max - d.z_min);
+    const double xn = (c.x() - lower.x()) / (upper.x() - lower.x());
+    const double yn = (c.y() - lower.y()) / (upper.y() - lower.y());
+    const double zn = (c.z() - lower.z()) / (upper.z() - lower.z());
 
     // pixel numbers
-    const int ix = std::min(std::max((int) (xn / d.hx), 0), (int)d.nx - 1);
-    const int iy = std::min(std::max((int) (yn / d.hy), 0), (int)d.ny - 1);
-    const int iz = std::min(std::max((int) (zn / d.hz), 0), (int)d.nz - 1);
+    const int ix = std::min(std::max((int) (xn / hx), 0), (int)nx - 1);
+    const int iy = std::min(std::max((int) (yn / hy), 0), (int)ny - 1);
+    const int iz = std::min(std::max((int) (zn / hz), 0), (int)nz - 1);
 
-    layer.partitioning[cell.index()] = d.nx*d.ny*iz + d.nx * iy + ix;
-  }
-  // exit(0);
+    layer.partitioning[cell] = nx*ny*iz + nx * iy + ix;
+  });
+}
+
+
+void MultiScaleDataMSRSB::build_morton_partitioning()
+{
+  auto & layer = active_layer();
+  const size_t n_cells = grid.n_cells();
+  if (layer.n_blocks > n_cells)
+    throw std::invalid_argument("number of blocks exceeds number of cells");
+
+  // normalize by the largest extent so that the blocks stay compact
+  // on elongated domains
+  const Point & lower = cell_geometry.domain_min();
+  const Point & upper = cell_geometry.domain_max();
+  double extent = std::max({upper.x() - lower.x(),
+                            upper.y() - lower.y(),
+                            upper.z() - lower.z()});
+  if (extent <= 0)  // single cell or degenerate domain
+    extent = 1;
+
+  vector<uint64_t> codes(n_cells);
+  parallel::parallel_for(0, n_cells, [&](const size_t cell)
+  {
+    const Point & c = cell_geometry.center(cell);
+    codes[cell] = gprs_data::morton_code((c.x() - lower.x()) / extent,
+                                         (c.y() - lower.y()) / extent,
+                                         (c.z() - lower.z()) / extent);
+  });
+
+  vector<size_t> order(n_cells);
+  std::iota(order.begin(), order.end(), 0);
+  // stable so that the result does not depend on the sort implementation
+  std::stable_sort(order.begin(), order.end(),
+                   [&codes](const size_t c1, const size_t c2) {return codes[c1] < codes[c2];});
+
+  // cut the curve into n_blocks pieces with (almost) equal number of cells
+  layer.partitioning.resize(n_cells);
+  parallel::parallel_for(0, n_cells, [&](const size_t i)
+  {
+    layer.partitioning[order[i]] = i * layer.n_blocks / n_cells;
+  });
 }
 
 }  // end namespace
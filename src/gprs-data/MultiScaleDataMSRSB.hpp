@@ -1,6 +1,7 @@
 #pragma once
 
 #include "mesh/Mesh.hpp"
+#include "mesh/CellGeometryCache.hpp"
 #include "LayerDataMSRSB.hpp"
 #include "MultiScaleOutputData.hpp"
 #include "UnionFindWrapper.hpp"
@@ -22,12 +23,17 @@ class MultiScaleDataMSRSB
    * takes n_blocks for only a single layer,
    * since multi-level multiscale is a long way
    * down the road. */
-  MultiScaleDataMSRSB(mesh::Mesh  & grid,
+  MultiScaleDataMSRSB(const mesh::Mesh  & grid,
                       const std::array<size_t,3> &  n_blocks,
                       const PartitioningMethod method = PartitioningMethod::metis);
   // main method. that's when the fun happens
   virtual void build_data();
   virtual void fill_output_model(MultiScaleOutputData & model, const int layer_index = 0) const;
+  // build partitioning with the selected method
+  // (can be used alone to split the grid into blocks)
+  void build_partitioning();
+  // block index of each cell
+  const std::vector<std::size_t> & get_partitioning() const {return active_layer().partitioning;}
 
  protected:
   // get reference to the active layer
@@ -39,6 +45,9 @@ class MultiScaleDataMSRSB
   void build_metis_partitioning();
   // build cubic cartesian-like partitioning
   void build_geometric_partitioning();
+  // split cells sorted along the morton curve into blocks of equal size
+  // gives balanced compact blocks on strongly non-uniform grids
+  void build_morton_partitioning();
   // build inverted partitioning block -> cells
   void build_cells_in_block();
   // main method that identifies regions where shape functions exist
@@ -106,6 +115,7 @@ class MultiScaleDataMSRSB
 
   //  attributes
   const mesh::Mesh & grid;
+  const mesh::CellGeometryCache cell_geometry;  // cell centers and bounding boxes
   vector<LayerDataMSRSB> layers;
   size_t active_layer_index;
   mutable size_t n_ghost;
@@ -10,7 +10,7 @@ using std::unordered_map;
 using std::unordered_set;
 using std::map;
 
-MultiScaleDataMech::MultiScaleDataMech(mesh::Mesh  & grid,
+MultiScaleDataMech::MultiScaleDataMech(const mesh::Mesh  & grid,
                                        const std::array<size_t,3> &  n_blocks,
                                        const PartitioningMethod method,
                                        const size_t elimination_level)
@@ -22,12 +22,7 @@ MultiScaleDataMech::MultiScaleDataMech(mesh::Mesh  & grid,
 
 void MultiScaleDataMech::build_data()
 {
-  std::cout << "building partitioning...";
-  if (partitioning_method == PartitioningMethod::metis)
-    build_metis_partitioning();
-  else if (partitioning_method == geometric)
-    build_geometric_partitioning();
-  std::cout << "OK" << std::endl;
+  build_partitioning();
 
   build_cells_in_block();
   const auto map_boundary_face_ghost_block = build_map_face_to_ghost_cell();
@@ -15,7 +15,7 @@ using std::vector;
 class MultiScaleDataMech : public MultiScaleDataMSRSB
 {
  public:
-  MultiScaleDataMech(mesh::Mesh  & grid,
+  MultiScaleDataMech(const mesh::Mesh  & grid,
                      const std::array<size_t,3> &  n_blocks,
                      const PartitioningMethod method,
                      const size_t elimination_level);
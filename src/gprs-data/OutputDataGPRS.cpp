@@ -1,7 +1,11 @@
 #include "OutputDataGPRS.hpp"
 #include "VTKWriter.hpp"
+#include "BufferedWriter.hpp"
 
 #include <sys/stat.h>
+#include <functional>  // std::function
+#include <future>      // std::async
+#include <stdexcept>   // std::runtime_error
 
 namespace gprs_data
 {
@@ -13,51 +17,67 @@ OutputDataGPRS::OutputDataGPRS(SimData & sim_data,
                        mesh::Mesh & grid)
     :
     data(sim_data),
-    grid(grid),
-    ordered_faces(grid.get_ordered_faces())
+    grid(grid)
 {}
 
 
 void OutputDataGPRS::write_output(const std::string & output_path)
 {
-  std::cout << "save geometry" << std::endl;
-  saveGeometry(output_path);
+  // files are independent: write them concurrently
+  std::vector<std::future<void>> tasks;
+  const auto launch = [&tasks](std::function<void()> task)
+  {
+    tasks.push_back(std::async(std::launch::async, std::move(task)));
+  };
+
+  // progress is printed here: messages from the concurrent writers would interleave
+  std::cout << "save geometry: "
+            << output_path + data.config.mechanics_domain_file << std::endl;
+  launch([this, output_path] {saveGeometry(output_path);});
 
-  std::cout << "save custom keyswords" << std::endl;
-  saveGeomechDataNewKeywords(output_path + data.config.domain_file);
+  std::cout << "save custom keyswords: "
+            << output_path + data.config.domain_file << std::endl;
+  launch([this, output_path] {saveGeomechDataNewKeywords(output_path + data.config.domain_file);});
 
   if (!data.vEfrac.empty())
   {
-    std::cout << "save embedded fractures" << std::endl;
-    saveEmbeddedFractureProperties(output_path + data.config.efrac_file);
+    std::cout << "save embedded fractures: "
+              << output_path + data.config.efrac_file << std::endl;
+    launch([this, output_path] {saveEmbeddedFractureProperties(output_path + data.config.efrac_file);});
   }
 
   std::cout << "save mech boundary conditions: "
             << output_path + data.config.bcond_file
             << std::endl;
-  saveBoundaryConditions(output_path + data.config.bcond_file);
+  launch([this, output_path] {saveBoundaryConditions(output_path + data.config.bcond_file);});
 
   if (data.dfm_faces.size() > 0)
   {
-    std::cout << "save discrete fractures" << std::endl;
-    saveDiscreteFractureProperties(output_path + data.config.discrete_frac_file);
+    std::cout << "save discrete fractures: "
+              << output_path + data.config.discrete_frac_file << std::endl;
+    launch([this, output_path] {saveDiscreteFractureProperties(output_path + data.config.discrete_frac_file);});
   }
 
   if (!data.wells.empty())
   {
-    std::cout << "save wells" << std::endl;
-    saveWells(output_path + data.config.wells_file);
+    std::cout << "save wells: "
+              << output_path + data.config.wells_file << std::endl;
+    launch([this, output_path] {saveWells(output_path + data.config.wells_file);});
   }
 
   // flow discretization
   std::cout << "save flow discretization" << std::endl;
-  flow::CalcTranses::save_output(data.flow_data, output_path);
+  launch([this, output_path] {flow::CalcTranses::save_output(data.flow_data, output_path);});
 
   // multiscale
   if (data.ms_flow_data.partitioning.size() > 0)
-    saveFlowMultiScaleData(output_path + data.config.flow_ms_file);
+    launch([this, output_path] {saveFlowMultiScaleData(output_path + data.config.flow_ms_file);});
   if (data.ms_mech_data.partitioning.size() > 0)
-    saveMechMultiScaleData(output_path + data.config.mech_ms_file);
+    launch([this, output_path] {saveMechMultiScaleData(output_path + data.config.mech_ms_file);});
+
+  // wait for all files; rethrows exceptions from the writers
+  for (auto & task : tasks)
+    task.get();
 }
 
 
@@ -67,192 +87,193 @@ void OutputDataGPRS::saveGeometry(const std::string & output_path)
 
   // GEOMETRY
   const std::string outstring = output_path + data.config.mechanics_domain_file;
-  std::cout << "writing file " << outstring << std::endl;
 
-  std::ofstream geomechfile;
-  geomechfile.open(outstring.c_str());
-  geomechfile << "GMDIMS" << endl;
+  IO::BufferedWriter geomechfile(outstring);
+  geomechfile << "GMDIMS\n";
 
   geomechfile << grid.n_vertices() << "\t"
               << grid.n_cells() << "\t"
               << grid.n_faces() - data.dfm_faces.size();  // not counting the split faces
-  geomechfile << "/" << endl << endl;
+  geomechfile << "/\n\n";
 
   geomechfile.precision(6);
-  cout << "write all coordinates\n";
-  geomechfile << "GMNODE_COORDS" << endl;
-  for (const auto & vertex : grid.vertices)
-      geomechfile << vertex[0] << "\t"
-                  << vertex[1] << "\t"
-                  << vertex[2] << "\n";
-  geomechfile << "/" << std::endl << std::endl;
-
-  cout << "write all elements\n";
-  geomechfile << "GMCELL_NODES" << endl;
-  for (auto cell=grid.begin_cells(); cell!=grid.end_cells(); ++cell)
+  geomechfile << "GMNODE_COORDS\n";
+  const auto & coordinates = grid.get_vertices();
+  geomechfile.write_parallel(coordinates.size(), [&coordinates](IO::BufferedWriter & out, const std::size_t i)
+  {
+    const auto & vertex = coordinates[i];
+    out << vertex[0] << "\t"
+        << vertex[1] << "\t"
+        << vertex[2] << "\n";
+  });
+  geomechfile << "/\n\n";
+
+  geomechfile << "GMCELL_NODES\n";
+  geomechfile.write_parallel(grid.n_cells(), [this](IO::BufferedWriter & out, const std::size_t icell)
   {
-    const auto & vertices = cell.vertices();
-    geomechfile << vertices.size() << "\t";
+    const auto & vertices = grid.cells[icell];
+    out << vertices.size() << "\t";
 
-    switch (cell.shape_id())
+    switch (grid.shape_ids[icell])
     {
       case 25: // super wierd element 25
         {
           for (int j = 0; j < 8; j++)
-            geomechfile << vertices[j] + 1 << "\t";
-          geomechfile << vertices[8] + 1 << "\t";
-          geomechfile << vertices[11] + 1 << "\t";
-          geomechfile << vertices[13] + 1 << "\t";
-          geomechfile << vertices[9] + 1 << "\t";
-
-          geomechfile << vertices[16] + 1 << "\t";
-          geomechfile << vertices[18] + 1 << "\t";
-          geomechfile << vertices[19] + 1 << "\t";
-          geomechfile << vertices[17] + 1 << "\t";
-
-          geomechfile << vertices[10] + 1 << "\t";
-          geomechfile << vertices[12] + 1 << "\t";
-          geomechfile << vertices[14] + 1 << "\t";
-          geomechfile << vertices[15] + 1 << "\t";
+            out << vertices[j] + 1 << "\t";
+          out << vertices[8] + 1 << "\t";
+          out << vertices[11] + 1 << "\t";
+          out << vertices[13] + 1 << "\t";
+          out << vertices[9] + 1 << "\t";
+
+          out << vertices[16] + 1 << "\t";
+          out << vertices[18] + 1 << "\t";
+          out << vertices[19] + 1 << "\t";
+          out << vertices[17] + 1 << "\t";
+
+          out << vertices[10] + 1 << "\t";
+          out << vertices[12] + 1 << "\t";
+          out << vertices[14] + 1 << "\t";
+          out << vertices[15] + 1 << "\t";
           break;
         }
       case 26:
         {
           for (int j = 0; j < 6; j++)
-            geomechfile << vertices[j] + 1 << "\t";
+            out << vertices[j] + 1 << "\t";
 
-          geomechfile << vertices[6] + 1 << "\t";
-          geomechfile << vertices[9] + 1 << "\t";
-          geomechfile << vertices[7] + 1 << "\t";
+          out << vertices[6] + 1 << "\t";
+          out << vertices[9] + 1 << "\t";
+          out << vertices[7] + 1 << "\t";
 
-          geomechfile << vertices[12] + 1 << "\t";
-          geomechfile << vertices[14] + 1 << "\t";
-          geomechfile << vertices[13] + 1 << "\t";
+          out << vertices[12] + 1 << "\t";
+          out << vertices[14] + 1 << "\t";
+          out << vertices[13] + 1 << "\t";
 
-          geomechfile << vertices[8] + 1 << "\t";
-          geomechfile << vertices[10] + 1 << "\t";
-          geomechfile << vertices[11] + 1 << "\t";
+          out << vertices[8] + 1 << "\t";
+          out << vertices[10] + 1 << "\t";
+          out << vertices[11] + 1 << "\t";
           break;
         }
       default:
         {
           for (const auto vertex : vertices)
-            geomechfile << vertex + 1 << "\t";
+            out << vertex + 1 << "\t";
           break;
         }
     }
 
-    geomechfile << std::endl;
-  }
+    out << "\n";
+  });
 
-  geomechfile << "/" << endl << endl;
+  geomechfile << "/\n\n";
 
-  geomechfile << "GMCELL_TYPE" << endl;
-  for (auto cell=grid.begin_cells(); cell!=grid.end_cells(); ++cell)
-    geomechfile <<  cell.shape_id() << std::endl;
-  geomechfile << "/" << std::endl << std::endl;
+  geomechfile << "GMCELL_TYPE\n";
+  geomechfile.write_parallel(grid.n_cells(), [this](IO::BufferedWriter & out, const std::size_t icell)
+  {
+    out << grid.shape_ids[icell] << "\n";
+  });
+  geomechfile << "/\n\n";
 
-  geomechfile << "GMCELL_TO_FLOWCELLS" << endl;
-  for (const auto & flow_cells : data.gm_cell_to_flow_cell)
+  geomechfile << "GMCELL_TO_FLOWCELLS\n";
+  const auto & gm_cell_to_flow_cell = data.gm_cell_to_flow_cell;
+  geomechfile.write_parallel(gm_cell_to_flow_cell.size(),
+                             [&gm_cell_to_flow_cell](IO::BufferedWriter & out, const std::size_t icell)
   {
+    const auto & flow_cells = gm_cell_to_flow_cell[icell];
     const std::size_t n_connected_elements = flow_cells.size();
     if (n_connected_elements == 0)
-      geomechfile << 1 << "\t" << -1 << std::endl;
+      out << 1 << "\t" << -1 << "\n";
     else
     {
-      geomechfile << n_connected_elements << "\t";
+      out << n_connected_elements << "\t";
       for (const std::size_t ielement : flow_cells)
-        geomechfile << ielement + 1 << "\t";
-      geomechfile << std::endl;
+        out << ielement + 1 << "\t";
+      out << "\n";
     }
-  }
+  });
   geomechfile << "/\n\n";
 
-  std::cout << "write all faces\n";
   geomechfile << "GMFACE_NODES\n";
-  for (const auto & face : ordered_faces)
+  geomechfile.write_parallel(grid.n_faces(), [this](IO::BufferedWriter & out, const std::size_t i)
   {
+    const auto face = grid.create_face_iterator(i);
     if (data.is_fracture(face.marker()))  // skip non-master faces
       if (face.index() != face.master_index())
-        continue;
+        return;
 
     const std::vector<std::size_t> ivertices = face.vertex_indices();
-    geomechfile << ivertices.size() << "\t";
+    out << ivertices.size() << "\t";
     for (const std::size_t ivertex : ivertices)
-      geomechfile << ivertex + 1 << "\t";
-    geomechfile << std::endl;
-  }
+      out << ivertex + 1 << "\t";
+    out << "\n";
+  });
 
-  geomechfile << "/" << std::endl << std::endl;
+  geomechfile << "/\n\n";
 
-  geomechfile << "GMFACE_TYPE" << std::endl;
-  for (const auto & face : ordered_faces)
+  geomechfile << "GMFACE_TYPE\n";
+  geomechfile.write_parallel(grid.n_faces(), [this](IO::BufferedWriter & out, const std::size_t i)
   {
+    const auto face = grid.create_face_iterator(i);
     if (data.is_fracture(face.marker()))  // skip non-master faces
       if (face.index() != face.master_index())
-        continue;
-    geomechfile << face.vtk_id() << std::endl;
-  }
-  geomechfile << "/" << std::endl << std::endl;
+        return;
+    out << face.vtk_id() << "\n";
+  });
+  geomechfile << "/\n\n";
+
+  geomechfile << "GMFACE_GMCELLS\n";
+  for (auto face = grid.begin_faces(); face != grid.end_faces(); ++face)  // check before going parallel
+    if (data.is_fracture(face.marker()) && face.index() == face.master_index())
+      if (data.dfm_faces.find(face.master_index()) == data.dfm_faces.end())
+        throw std::runtime_error("bug in dfm connections");
 
-  std::cout << "writing face-cell connection" << std::endl;
-  geomechfile << "GMFACE_GMCELLS" << std::endl;
-  for (const auto & face : ordered_faces)
+  geomechfile.write_parallel(grid.n_faces(), [this](IO::BufferedWriter & out, const std::size_t i)
   {
+    const auto face = grid.create_face_iterator(i);
     if (data.is_fracture(face.marker()))  // timur want to retain neighbors of master frac face
     {
       if (face.index() == face.master_index())
       {
-        const auto it_frac_face = data.dfm_faces.find(face.master_index());
-        if (it_frac_face == data.dfm_faces.end())
-        {
-          std::cout << "bug in dfm connections" << std::endl;
-          exit(0);
-        }
-        const auto & neighbors = it_frac_face->second.neighbor_cells;
-
-        geomechfile << neighbors.size() << "\t";
+        const auto & neighbors = data.dfm_faces.find(face.master_index())->second.neighbor_cells;
+        out << neighbors.size() << "\t";
         for (const auto & neighbor : neighbors)
-          geomechfile << neighbor + 1 << "\t";
-        geomechfile << std::endl;
+          out << neighbor + 1 << "\t";
+        out << "\n";
       }
     }
     else
     {
       assert( face.index() == face.master_index() );
       const auto & neighbors = face.neighbors();
-      geomechfile << neighbors.size() << "\t";
+      out << neighbors.size() << "\t";
       for (const std::size_t neighbor : neighbors)
-        geomechfile << neighbor + 1 << "\t";
-      geomechfile << std::endl;
+        out << neighbor + 1 << "\t";
+      out << "\n";
     }
-  }
-  geomechfile << "/" << std::endl << std::endl;
+  });
+  geomechfile << "/\n\n";
   geomechfile.close();
 }
 
 
 void OutputDataGPRS::saveGeomechDataNewKeywords(const std::string file_name)
 {
-  std::cout << "Writing all domain from user input properties" << std::endl;
   {  // write domain properties
-    std::ofstream geomechfile;
-    geomechfile.open(file_name.c_str());
+    IO::BufferedWriter geomechfile(file_name);
 
     for (std::size_t ivar=0; ivar<data.rockPropNames.size(); ++ivar)
     {
       if ( data.config.expression_type[ivar] != 1 )  // only mechanics kwds
         continue;
 
-      geomechfile << data.rockPropNames[ivar] << std::endl;
-      for (auto cell = grid.begin_cells(); cell != grid.end_cells(); ++cell)
+      geomechfile << data.rockPropNames[ivar] << "\n";
+      geomechfile.write_parallel(grid.n_cells(), [this, ivar](IO::BufferedWriter & out, const std::size_t icell)
       {
-        const std::size_t icell = cell.index();
-        geomechfile << data.vsCellRockProps[icell].v_props[ivar] << "\t";
+        out << data.vsCellRockProps[icell].v_props[ivar] << "\t";
         if ((icell + 1) % n_entries_per_line == 0)
-          geomechfile << std::endl;
-      }
-      geomechfile << std::endl << "/" << std::endl << std::endl;
+          out << "\n";
+      });
+      geomechfile << "\n/\n\n";
     }
 
     geomechfile.close();
@@ -262,64 +283,62 @@ void OutputDataGPRS::saveGeomechDataNewKeywords(const std::string file_name)
 
 void OutputDataGPRS::saveEmbeddedFractureProperties(const std::string file_name)
 {
-  std::cout  << "Writing SDA props" << std::endl;
-  std::ofstream geomechfile;
-  geomechfile.open(file_name.c_str());
+  IO::BufferedWriter geomechfile(file_name);
 
-  geomechfile << "GM_EFRAC_CELLS" << std::endl;
+  geomechfile << "GM_EFRAC_CELLS\n";
   for (const auto & efrac : data.vEfrac)
   {
-    geomechfile << efrac.cells.size() << std::endl << "\t";
+    geomechfile << efrac.cells.size() << "\n\t";
     for (std::size_t i=0; i<efrac.cells.size(); ++i)
     {
       geomechfile << efrac.cells[i] + 1 << "\t";
       if ((i+1) % n_entries_per_line == 0)
-        geomechfile << std::endl;
+        geomechfile << "\n";
       if (i == efrac.cells.size() - 1)
-        geomechfile << std::endl;
+        geomechfile << "\n";
     }
   }
-  geomechfile << "/" << std::endl << std::endl;
+  geomechfile << "/\n\n";
 
-  geomechfile << "GM_EFRAC_POINTS" << std::endl;
+  geomechfile << "GM_EFRAC_POINTS\n";
   for (const auto & efrac : data.vEfrac)
     for (std::size_t i=0; i<efrac.points.size(); ++i)
-      geomechfile << efrac.points[i] << std::endl;
-  geomechfile << "/" << std::endl << std::endl;
+      geomechfile << efrac.points[i] << "\n";
+  geomechfile << "/\n\n";
 
-  geomechfile << "GM_EFRAC_DIP" << std::endl;
+  geomechfile << "GM_EFRAC_DIP\n";
   for (const auto & efrac : data.vEfrac)
     for (std::size_t i=0; i<efrac.points.size(); ++i)
     {
       geomechfile << efrac.dip[i] << "\t";
       if ((i+1) % n_entries_per_line == 0)
-        geomechfile << std::endl;
+        geomechfile << "\n";
     }
-  geomechfile << "/" << std::endl << std::endl;
+  geomechfile << "/\n\n";
 
-  geomechfile << "GM_EFRAC_STRIKE" << std::endl;
+  geomechfile << "GM_EFRAC_STRIKE\n";
   for (const auto & efrac : data.vEfrac)
     for (std::size_t i=0; i<efrac.points.size(); ++i)
     {
       geomechfile << efrac.strike[i] << "\t";
-      if ((i+1)%n_entries_per_line == 0) geomechfile << std::endl;
+      if ((i+1)%n_entries_per_line == 0) geomechfile << "\n";
     }
-  geomechfile << "/" << std::endl << std::endl;
+  geomechfile << "/\n\n";
 
-  geomechfile << "GM_EFRAC_COHESION" << std::endl;
+  geomechfile << "GM_EFRAC_COHESION\n";
   for (const auto & efrac : data.vEfrac)
-    geomechfile << efrac.cohesion << std::endl;
-  geomechfile << "/" << std::endl << std::endl;
+    geomechfile << efrac.cohesion << "\n";
+  geomechfile << "/\n\n";
 
-  geomechfile << "GM_EFRAC_FRICTION" << std::endl;
+  geomechfile << "GM_EFRAC_FRICTION\n";
   for (const auto & efrac : data.vEfrac)
-    geomechfile << efrac.friction_angle << std::endl;
-  geomechfile << "/" << std::endl << std::endl;
+    geomechfile << efrac.friction_angle << "\n";
+  geomechfile << "/\n\n";
 
-  geomechfile << "GM_EFRAC_DILATION" << std::endl;
+  geomechfile << "GM_EFRAC_DILATION\n";
   for (const auto & efrac : data.vEfrac)
-    geomechfile << efrac.dilation_angle << std::endl;
-  geomechfile << "/" << std::endl << std::endl;
+    geomechfile << efrac.dilation_angle << "\n";
+  geomechfile << "/\n\n";
 
   geomechfile.close();
 }
@@ -327,9 +346,6 @@ void OutputDataGPRS::saveEmbeddedFractureProperties(const std::string file_name)
 
 void OutputDataGPRS::saveBoundaryConditions(const std::string file_name)
 {
-  std::ofstream geomechfile;
-  std::cout << "Computing Dirichlet nodes" << std::endl;
-
   /* this chunk of code find dirichlet nodes
    * Algorithm:
    * 1. First add all Dirichlet nodes specified by the user
@@ -366,7 +382,7 @@ void OutputDataGPRS::saveBoundaryConditions(const std::string file_name)
   }
 
   if ( data.n_dirichlet_faces > 0 )
-    for (const auto & face : ordered_faces)
+    for (auto face = grid.begin_faces(); face != grid.end_faces(); ++face)
       if (data.is_boundary(face.marker()))
       {
         const auto facet_it = data.boundary_faces.find(face.master_index());
@@ -387,57 +403,50 @@ void OutputDataGPRS::saveBoundaryConditions(const std::string file_name)
                 }
         }
         else  // should not happen
-        {
-          std::cout << "face " << face.index()
-                    << " is not a boundary face!! Aborting!!!"
-                    << std::endl;
-          abort();
-        }
+          throw std::runtime_error("face " + std::to_string(face.index()) +
+                                   " is not a boundary face");
       }
 
   setDisp.clear();
 
-  geomechfile.open(file_name.c_str());
+  IO::BufferedWriter geomechfile(file_name);
 
   // save dirichlet faces
   for (std::size_t j=0; j<dim; ++j)
     if (vv_disp_node_ind[j].size() > 0)
     {
-      std::cout << "write all Dirichlet nodes" << std::endl;
       switch (j)
       {
         case 0:
-          geomechfile << "GMNODE_BCDISPX" << std::endl;
+          geomechfile << "GMNODE_BCDISPX\n";
           break;
         case 1:
-          geomechfile << "GMNODE_BCDISPY" << std::endl;
+          geomechfile << "GMNODE_BCDISPY\n";
           break;
         case 2:
-          geomechfile << "GMNODE_BCDISPZ" << std::endl;
+          geomechfile << "GMNODE_BCDISPZ\n";
           break;
       }
 
       for(std::size_t i = 0; i < vv_disp_node_ind[j].size(); ++i)
       {
         geomechfile << vv_disp_node_ind[j][i] + 1 << "\t";
-        geomechfile << vv_disp_node_values[j][i] << std::endl;
+        geomechfile << vv_disp_node_values[j][i] << "\n";
       }
-      geomechfile << "/" << std::endl << std::endl;
+      geomechfile << "/\n\n";
     }
 
   if ( data.n_neumann_faces > 0 )
   {
-    std::cout << "write all Neumann faces" << std::endl;
-
-    geomechfile << "GMFACE_TRACTION_TXYZ" << std::endl;
+    geomechfile << "GMFACE_TRACTION_TXYZ\n";
     for (const auto & facet_it : data.boundary_faces)
       if (facet_it.second.ntype == 2)  // neumann
       {
         geomechfile << facet_it.second.nface + 1 << "\t";
-        geomechfile << facet_it.second.condition << std::endl;
+        geomechfile << facet_it.second.condition << "\n";
       }
 
-    geomechfile << "/" << std::endl << std::endl;
+    geomechfile << "/\n\n";
   }
 
   geomechfile.close();
@@ -446,38 +455,34 @@ void OutputDataGPRS::saveBoundaryConditions(const std::string file_name)
 
 void OutputDataGPRS::saveDiscreteFractureProperties(const std::string file_name)
 {
-  std::cout << "write discrete fracs" << std::endl;
-
-  std::ofstream geomechfile;
-  geomechfile.open(file_name.c_str());
+  IO::BufferedWriter geomechfile(file_name);
   set<int>::iterator itsetint;
 
-  cout << "write all fractured faces\n";
-  geomechfile << "GMFACE_FRACTURE_TO_FLOWCELL" << std::endl;
+  geomechfile << "GMFACE_FRACTURE_TO_FLOWCELL\n";
   for (const auto & face_it : data.dfm_faces)
   {
     geomechfile << face_it.second.nface + 1 << "\t";
     if (face_it.second.coupled)
-      geomechfile << face_it.second.nfluid + 1 << std::endl;
+      geomechfile << face_it.second.nfluid + 1 << "\n";
     else
-      geomechfile << -1 << std::endl;
+      geomechfile << -1 << "\n";
   }
-  geomechfile << "/" << std::endl << std::endl;
+  geomechfile << "/\n\n";
 
-  geomechfile << "GMFACE_FRACTURE_CONDUCTIVITY" << std::endl;
+  geomechfile << "GMFACE_FRACTURE_CONDUCTIVITY\n";
   for (const auto facet_it : data.dfm_faces)
-    geomechfile << facet_it.second.conductivity << std::endl;
-  geomechfile << "/" << std::endl << std::endl;
+    geomechfile << facet_it.second.conductivity << "\n";
+  geomechfile << "/\n\n";
 
-  geomechfile << "GMFACE_FRACTURE_REGION" << std::endl;
+  geomechfile << "GMFACE_FRACTURE_REGION\n";
   for (const auto facet_it : data.dfm_faces)
-    geomechfile << 1 << std::endl;
-  geomechfile << "/" << std::endl << std::endl;
+    geomechfile << 1 << "\n";
+  geomechfile << "/\n\n";
 
-  geomechfile << "GMFACE_FRACTURE_GROUP" << std::endl;
+  geomechfile << "GMFACE_FRACTURE_GROUP\n";
   for (const auto facet_it : data.dfm_faces)
-    geomechfile << 1 << std::endl;
-  geomechfile << "/" << std::endl << std::endl;
+    geomechfile << 1 << "\n";
+  geomechfile << "/\n\n";
 
   geomechfile.close();
 }
@@ -485,10 +490,9 @@ void OutputDataGPRS::saveDiscreteFractureProperties(const std::string file_name)
 
 void OutputDataGPRS::saveWells(const std::string file_name)
 {
-  std::ofstream file;
-  file.open(file_name.c_str());
+  IO::BufferedWriter file(file_name);
 
-  file << "WELSPECS" << std::endl;
+  file << "WELSPECS\n";
   for (const auto & well : data.wells)
   {
     if (well.connected_volumes.empty())
@@ -502,11 +506,11 @@ void OutputDataGPRS::saveWells(const std::string file_name)
     // connected volume + j + k empty
     file << well.connected_volumes[0] << " 1 1 ";
     // reference depth
-    file << -well.reference_depth << " /" << std::endl;
+    file << -well.reference_depth << " /\n";
   }
-  file << "/" << std::endl << std::endl;
+  file << "/\n\n";
 
-  file << "COMPDAT" << std::endl;
+  file << "COMPDAT\n";
   for (const auto & well : data.wells)
   {
     for (std::size_t i=0; i<well.connected_volumes.size(); ++i)
@@ -517,10 +521,48 @@ void OutputDataGPRS::saveWells(const std::string file_name)
       file << "1\t1\t1\tOPEN\t1*\t";
       file << well.indices[i] * flow::CalcTranses::transmissibility_conversion_factor << "\t";
       file << 2*well.radius << "\t";
-      file << "/" << std::endl;
+      file << "/\n";
     }
   }
-  file << "/" << std::endl << std::endl;
+  file << "/\n\n";
+
+  // multi-segment wells: segment 1 is the top node, segment i+2 is the
+  // trajectory part in well.ms_volumes[i]; lengths are along the trajectory
+  // and depths are -z (same as the reference depth in WELSPECS)
+  for (const auto & well : data.wells)
+  {
+    // wells without WELSPECS (no connected volumes) cannot have segments
+    if (well.connected_volumes.empty() || well.ms_volumes.empty())
+      continue;
+
+    file << "WELSEGS\n";
+    // name, top depth, top length, top volume, ABS
+    file << well.name << "\t" << -well.ms_top[2] << "\t"
+         << well.ms_start[0] << "\t1*\tABS /\n";
+    // segments without an outlet (first ones of the branches) flow into the top node
+    std::vector<std::size_t> outlets(well.ms_volumes.size(), 1);
+    for (const auto & connection : well.ms_connections)
+      outlets[connection.first] = connection.second + 2;
+    for (std::size_t i=0; i<well.ms_volumes.size(); ++i)
+    {
+      // segment, segment, branch, outlet, length, depth, diameter
+      file << i + 2 << "\t" << i + 2 << "\t" << well.ms_branch[i] << "\t" << outlets[i] << "\t";
+      file << well.ms_end[i] << "\t" << -well.ms_nodes[i][2] << "\t";
+      file << 2*well.radius << "\t1* /\n";
+    }
+    file << "/\n\n";
+
+    file << "COMPSEGS\n";
+    file << well.name << " /\n";
+    for (std::size_t i=0; i<well.ms_volumes.size(); ++i)
+      if (well.ms_perforated[i])
+      {
+        // connected volume + j + k, branch, start and end length
+        file << well.ms_volumes[i] + 1 << "\t1\t1\t" << well.ms_branch[i] << "\t";
+        file << well.ms_start[i] << "\t" << well.ms_end[i] << " /\n";
+      }
+    file << "/\n\n";
+  }
 
   file.close();
 }
@@ -534,24 +576,23 @@ void OutputDataGPRS::saveFlowMultiScaleData(const std::string file_name)
 
 void OutputDataGPRS::saveMechMultiScaleData(const std::string file_name)
 {
-  std::ofstream out;
-  out.open(file_name.c_str());
+  IO::BufferedWriter out(file_name);
   const auto & ms = data.ms_mech_data;
 
   // save partitioing
   out << "GMMSPARTITIONING";
   for (std::size_t i=0; i < ms.partitioning.size(); ++i)
   {
-    if (i % n_entries_per_line == 0) out << endl;
+    if (i % n_entries_per_line == 0) out << "\n";
     out << ms.partitioning[i] << " ";
   }
-  out << "/" << endl << endl;
+  out << "/\n\n";
 
   // save support
   out << "GMMSSUPPORT ";
   for (std::size_t i=0; i < ms.n_coarse; ++i)
   {
-    out << endl;
+    out << "\n";
     out << ms.support_internal[i].size() << " "  // number of cells (centroid)
         << ms.support_boundary[i].size() << " "; // number of boundary nodes
 
@@ -562,19 +603,19 @@ void OutputDataGPRS::saveMechMultiScaleData(const std::string file_name)
     size_t counter = 3;
     for (const size_t cell : ms.support_internal[i])
     {
-      if (counter++ % n_entries_per_line == 0) out << endl;
+      if (counter++ % n_entries_per_line == 0) out << "\n";
       out << cell << " ";
     }
 
     // boundary nodes
     for (const size_t vertex : ms.support_boundary[i])
     {
-      if (counter++ % n_entries_per_line == 0) out << endl;
+      if (counter++ % n_entries_per_line == 0) out << "\n";
       out << vertex << " ";
     }
   }
 
-  out << "/" << endl << endl;
+  out << "/\n\n";
 
   out.close();
 }
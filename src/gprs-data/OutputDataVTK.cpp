@@ -1,33 +1,121 @@
 #include "OutputDataVTK.hpp"
+#include "VTUWriter.hpp"
+#include "MultiScaleDataMSRSB.hpp"  // partitioning for pvtu pieces
+#include "parallel/parallel_for.hpp"
+
+#include <algorithm>      // std::max_element
+#include <unordered_map>
 
 namespace gprs_data
 {
 
-OutputDataVTK::OutputDataVTK(const SimData & sim_data, const mesh::Mesh & grid)
+namespace
+{
+// legacy vtk file (ascii or binary) with the same interface as IO::VTUWriter
+class LegacyVTKFile
+{
+ public:
+  LegacyVTKFile(const std::string & fname, const bool binary)
+      : binary(binary)
+  {
+    out.open(fname.c_str(), binary ? std::ios::binary : std::ios::out);
+  }
+
+  void write_geometry(const std::vector<Point>                    & vertices,
+                      const std::vector<std::vector<std::size_t>> & cells,
+                      const std::vector<int>                      & vtk_indices)
+  {IO::VTKWriter::write_geometry(vertices, cells, vtk_indices, out, binary);}
+
+  void write_surface_geometry(const std::vector<Point>                    & vertices,
+                              const std::vector<std::vector<std::size_t>> & cells)
+  {IO::VTKWriter::write_surface_geometry(vertices, cells, out, binary);}
+
+  void write_well_trajectory(const std::vector<Point>                              & vertices,
+                             const std::vector<std::pair<std::size_t,std::size_t>> & indices)
+  {IO::VTKWriter::write_well_trajectory(vertices, indices, out, binary);}
+
+  void enter_section_cell_data(const std::size_t n_cells)
+  {IO::VTKWriter::enter_section_cell_data(n_cells, out);}
+
+  void enter_section_point_data(const std::size_t n_vertices)
+  {IO::VTKWriter::enter_section_point_data(n_vertices, out);}
+
+  template <typename T>
+  void add_data(const std::vector<T> & property, const std::string & keyword)
+  {IO::VTKWriter::add_data(property, keyword, out, binary);}
+
+  void close() {out.close();}
+
+ private:
+  std::ofstream out;
+  bool binary;
+};
+}  // end anonymous namespace
+
+
+OutputDataVTK::OutputDataVTK(const SimData & sim_data, const mesh::Mesh & grid,
+                             const OutputFormat format)
     :
     data(sim_data),
-    grid(grid)
+    grid(grid),
+    format(format)
 {}
 
 
 void OutputDataVTK::write_output(const std::string & output_path)
 {
-  save_reservoir_data(output_path + data.config.reservoir_grid_vtk_file);
+  if (format == OutputFormat::vtu || format == OutputFormat::vtu_compressed ||
+      format == OutputFormat::pvtu)
+    write_files<IO::VTUWriter>(output_path);
+  else
+    write_files<LegacyVTKFile>(output_path);
+}
+
+
+std::string OutputDataVTK::file_name(const std::string & vtk_file_name) const
+{
+  if (format != OutputFormat::vtu && format != OutputFormat::vtu_compressed &&
+      format != OutputFormat::pvtu)
+    return vtk_file_name;
+
+  const std::string ext = ".vtk";
+  if (vtk_file_name.size() >= ext.size() &&
+      vtk_file_name.compare(vtk_file_name.size() - ext.size(), ext.size(), ext) == 0)
+    return vtk_file_name.substr(0, vtk_file_name.size() - ext.size()) + ".vtu";
+  else
+    return vtk_file_name + ".vtu";
+}
+
+
+bool OutputDataVTK::file_option() const
+{
+  // pvtu pieces are not compressed
+  return format == OutputFormat::vtk_binary || format == OutputFormat::vtu_compressed;
+}
+
+
+template <typename File>
+void OutputDataVTK::write_files(const std::string & output_path)
+{
+  if (format == OutputFormat::pvtu)
+    save_partitioned_reservoir_data(output_path, data.config.reservoir_grid_vtk_file);
+  else
+    save_reservoir_data<File>(output_path + file_name(data.config.reservoir_grid_vtk_file));
   if (data.dfm_faces.size() > 0)
-    save_dfm_data(output_path + data.config.dfm_grid_vtk_file);
+    save_dfm_data<File>(output_path + file_name(data.config.dfm_grid_vtk_file));
   if (!data.vEfrac.empty())
-    save_edfm_data(output_path + data.config.edfm_grid_vtk_file);
+    save_edfm_data<File>(output_path + file_name(data.config.edfm_grid_vtk_file));
   if (!data.well_vertices.points.empty())
-    save_well_data(output_path + data.config.wells_vtk_file);
+    save_well_data<File>(output_path + file_name(data.config.wells_vtk_file));
 }
 
 
+template <typename File>
 void OutputDataVTK::save_reservoir_data(const std::string & fname)
 {
-  std::ofstream out;
-  out.open(fname.c_str());
-  IO::VTKWriter::write_geometry(grid.get_vertices(), grid.cells, grid.shape_ids, out);
-  IO::VTKWriter::enter_section_cell_data(grid.n_cells(), out);
+  File out(fname, file_option());
+  out.write_geometry(grid.get_vertices(), grid.cells, grid.shape_ids);
+  out.enter_section_cell_data(grid.n_cells());
 
   // save keywords
   for (std::size_t ivar=0; ivar<data.rockPropNames.size(); ++ivar)
@@ -37,20 +125,20 @@ void OutputDataVTK::save_reservoir_data(const std::string & fname)
     for (auto cell = grid.begin_cells(); cell != grid.end_cells(); ++cell)
       property[cell.index()] = data.vsCellRockProps[cell.index()].v_props[ivar];
 
-    IO::VTKWriter::add_data(property, keyword, out);
+    out.add_data(property, keyword);
   }
 
   // save multiscale flow data
   if (!data.ms_flow_data.partitioning.empty())
   {
-    IO::VTKWriter::add_data(data.ms_flow_data.partitioning, "partitioning-flow", out);
+    out.add_data(data.ms_flow_data.partitioning, "partitioning-flow");
     saveMultiScaleSupport(data.ms_mech_data, grid.n_cells(), "support-flow-", out);
   }
   if (!data.ms_mech_data.partitioning.empty())
   {
     const auto & ms = data.ms_mech_data;
-    IO::VTKWriter::add_data(ms.partitioning, "partitioning-mech", out);
-    IO::VTKWriter::enter_section_point_data(grid.n_vertices(), out);
+    out.add_data(ms.partitioning, "partitioning-mech");
+    out.enter_section_point_data(grid.n_vertices());
     // saveMultiScaleSupport(msm, grid.n_vertices(), "support-mech-", out);
 
     // I'm just gonna save vertices and boundaries
@@ -62,28 +150,141 @@ void OutputDataVTK::save_reservoir_data(const std::string & fname)
     }
     for (const size_t i : ms.centroids)
       output[i] = 2;
-    IO::VTKWriter::add_data(output, "support-mech", out);
+    out.add_data(output, "support-mech");
   }
   out.close();
 }
 
 
+std::vector<std::size_t> OutputDataVTK::build_pieces() const
+{
+  // reuse multiscale blocks if we have them
+  if (!data.ms_flow_data.partitioning.empty())
+    return data.ms_flow_data.partitioning;
+  if (!data.ms_mech_data.partitioning.empty())
+    return data.ms_mech_data.partitioning;
+
+  std::size_t n_pieces = data.config.n_vtk_pieces;
+  if (n_pieces == 0)
+    n_pieces = parallel::default_n_threads();
+  n_pieces = std::min(n_pieces, grid.n_cells());
+  if (n_pieces < 2)
+    return std::vector<std::size_t>(grid.n_cells(), 0);
+
+#ifdef WITH_METIS
+  const PartitioningMethod method = PartitioningMethod::metis;
+#else
+  const PartitioningMethod method = PartitioningMethod::morton;
+#endif
+  multiscale::MultiScaleDataMSRSB partitioner(grid, {n_pieces, 1, 1}, method);
+  partitioner.build_partitioning();
+  return partitioner.get_partitioning();
+}
+
+
+void OutputDataVTK::save_partitioned_reservoir_data(const std::string & output_path,
+                                                    const std::string & vtk_file_name)
+{
+  std::string base = file_name(vtk_file_name);
+  base = base.substr(0, base.size() - 4);  // remove .vtu
+
+  const std::vector<std::size_t> piece_of_cell = build_pieces();
+  const std::size_t n_pieces = piece_of_cell.empty() ? 0 :
+      *std::max_element(piece_of_cell.begin(), piece_of_cell.end()) + 1;
+  std::vector<std::vector<std::size_t>> cells_in_piece(n_pieces);
+  for (std::size_t icell = 0; icell < piece_of_cell.size(); ++icell)
+    cells_in_piece[piece_of_cell[icell]].push_back(icell);
+
+  std::vector<std::string> keywords = data.rockPropNames;
+  if (!data.ms_flow_data.partitioning.empty())
+    keywords.push_back("partitioning-flow");
+  if (!data.ms_mech_data.partitioning.empty())
+    keywords.push_back("partitioning-mech");
+
+  std::vector<std::string> piece_names(n_pieces);
+  for (std::size_t piece = 0; piece < n_pieces; ++piece)
+  {
+    const std::string name = base + "_" + std::to_string(piece) + ".vtu";
+    // path relative to the index file
+    piece_names[piece] = name.substr(name.find_last_of('/') + 1);
+  }
+
+  std::cout << "Saving " << n_pieces << " reservoir pieces: "
+            << output_path + base + ".pvtu" << std::endl;
+
+  parallel::parallel_for(0, n_pieces, [&](const std::size_t piece)
+  {
+    const auto & piece_cells = cells_in_piece[piece];
+
+    // renumber vertices within the piece
+    std::unordered_map<std::size_t, std::size_t> local_vertex;
+    std::vector<Point> vertices;
+    std::vector<std::vector<std::size_t>> cells(piece_cells.size());
+    std::vector<int> vtk_indices(piece_cells.size());
+    for (std::size_t i = 0; i < piece_cells.size(); ++i)
+    {
+      const std::size_t icell = piece_cells[i];
+      vtk_indices[i] = grid.shape_ids[icell];
+      cells[i].reserve(grid.cells[icell].size());
+      for (const std::size_t v : grid.cells[icell])
+      {
+        auto it = local_vertex.find(v);
+        if (it == local_vertex.end())
+        {
+          it = local_vertex.insert({v, vertices.size()}).first;
+          vertices.push_back(grid.vertex(v));
+        }
+        cells[i].push_back(it->second);
+      }
+    }
+
+    IO::VTUWriter out(output_path + base.substr(0, base.find_last_of('/') + 1) + piece_names[piece]);
+    out.write_geometry(vertices, cells, vtk_indices);
+    out.enter_section_cell_data(cells.size());
+
+    std::vector<double> property(piece_cells.size());
+    for (std::size_t ivar=0; ivar<data.rockPropNames.size(); ++ivar)
+    {
+      for (std::size_t i = 0; i < piece_cells.size(); ++i)
+        property[i] = data.vsCellRockProps[piece_cells[i]].v_props[ivar];
+      out.add_data(property, data.rockPropNames[ivar]);
+    }
+
+    if (!data.ms_flow_data.partitioning.empty())
+    {
+      for (std::size_t i = 0; i < piece_cells.size(); ++i)
+        property[i] = data.ms_flow_data.partitioning[piece_cells[i]];
+      out.add_data(property, "partitioning-flow");
+    }
+    if (!data.ms_mech_data.partitioning.empty())
+    {
+      for (std::size_t i = 0; i < piece_cells.size(); ++i)
+        property[i] = data.ms_mech_data.partitioning[piece_cells[i]];
+      out.add_data(property, "partitioning-mech");
+    }
+    out.close();
+  }, 0, 1);
+
+  IO::VTUWriter::write_pvtu(output_path + base + ".pvtu", piece_names, keywords);
+}
+
+
+template <typename File>
 void OutputDataVTK::save_dfm_data(const std::string & fname)
 {
   std::cout << "Saving DFM mesh file: " << fname << std::endl;
-  std::ofstream out;
-  out.open(fname.c_str());
-  IO::VTKWriter::write_surface_geometry(data.dfm_master_grid.get_vertices(),
-                                        data.dfm_master_grid.get_polygons(), out);
+  File out(fname, file_option());
+  out.write_surface_geometry(data.dfm_master_grid.get_vertices(),
+                             data.dfm_master_grid.get_polygons());
   out.close();
 }
 
 
+template <typename File>
 void OutputDataVTK::save_edfm_data(const std::string & fname)
 {
   std::cout << "Saving EDFM mesh file: " << fname << std::endl;
-  std::ofstream out;
-  out.open(fname.c_str());
+  File out(fname, file_option());
 
   // write vtk data
   std::size_t n_efrac_vertices = 0;
@@ -125,16 +326,17 @@ void OutputDataVTK::save_edfm_data(const std::string & fname)
     shift += efrac.mesh.n_vertices();
   }
 
-  IO::VTKWriter::write_surface_geometry(efrac_verts, efrac_cells, out);
+  out.write_surface_geometry(efrac_verts, efrac_cells);
 
   out.close();
 }
 
 
+template <typename File>
 void OutputDataVTK::saveMultiScaleSupport(const multiscale::MultiScaleOutputData & ms,
                                           const std::size_t                        size,
                                           const std::string                      & prefix,
-                                          std::ofstream                          & out)
+                                          File                                   & out)
 {
   // coarse nodes
   std::vector<int> support_value(size);
@@ -152,17 +354,19 @@ void OutputDataVTK::saveMultiScaleSupport(const multiscale::MultiScaleOutputData
         support_value[i] = 0;
     }
 
-    IO::VTKWriter::add_data(support_value, prefix + std::to_string(coarse), out);
+    out.add_data(support_value, prefix + std::to_string(coarse));
   }  // end coarse loop
 }
 
 
+template <typename File>
 void OutputDataVTK::save_well_data(const std::string & fname)
 {
   // vtk well geometry
-  IO::VTKWriter::write_well_trajectory(data.well_vertices.points,
-                                       data.well_vertex_indices,
-                                       fname);
+  File out(fname, file_option());
+  out.write_well_trajectory(data.well_vertices.points,
+                            data.well_vertex_indices);
+  out.close();
 }
 
 }
@@ -10,22 +10,43 @@ namespace gprs_data
 class OutputDataVTK
 {
  public:
-  OutputDataVTK(const SimData & sim_data, const mesh::Mesh & grid);
+  // format: one of vtk (ascii), vtk_binary, vtu, vtu_compressed, pvtu
+  OutputDataVTK(const SimData & sim_data, const mesh::Mesh & grid,
+                const OutputFormat format = OutputFormat::vtk);
   void write_output(const std::string & output_path);
 
  private:
+  // File is either a legacy vtk file or IO::VTUWriter
+  template <typename File>
+  void write_files(const std::string & output_path);
+  template <typename File>
   void save_reservoir_data(const std::string & fname);
+  // write reservoir cells into several .vtu pieces (concurrently)
+  // and a .pvtu index file
+  void save_partitioned_reservoir_data(const std::string & output_path,
+                                       const std::string & vtk_file_name);
+  // piece index of each reservoir cell for pvtu output
+  std::vector<std::size_t> build_pieces() const;
+  template <typename File>
   void save_dfm_data(const std::string & fname);
+  template <typename File>
   void save_edfm_data(const std::string & fname);
+  template <typename File>
   void save_well_data(const std::string & fname);
   // size is different for mech and flow
+  template <typename File>
   void saveMultiScaleSupport(const multiscale::MultiScaleOutputData & ms,
                              const std::size_t                        size,
                              const std::string                      & prefix,
-                             std::ofstream                          & out);
+                             File                                   & out);
+  // replace .vtk extension with .vtu for xml output
+  std::string file_name(const std::string & vtk_file_name) const;
+  // binary flag for legacy files, compression flag for vtu
+  bool file_option() const;
 
   const SimData & data;
   const mesh::Mesh & grid;
+  const OutputFormat format;
 };
 
 }
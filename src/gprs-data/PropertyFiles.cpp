@@ -0,0 +1,167 @@
+#include "PropertyFiles.hpp"
+
+#include <algorithm>  // std::min, std::max
+#include <cctype>     // std::isspace
+#include <charconv>   // std::from_chars
+#include <cmath>      // std::floor
+#include <cstring>    // std::memmove
+#include <fstream>
+#include <stdexcept>  // std::runtime_error
+
+namespace gprs_data
+{
+
+namespace
+{
+// values per chunk passed to the handler
+const std::size_t chunk_size = 1 << 20;
+
+
+void read_binary_values(std::ifstream & in, const std::string & file_name,
+                        const std::size_t n, const PropertyChunkHandler & handler)
+{
+  std::vector<double> chunk(std::min(n, chunk_size));
+  for (std::size_t first = 0; first < n; first += chunk.size())
+  {
+    const std::size_t count = std::min(chunk.size(), n - first);
+    in.read(reinterpret_cast<char*>(chunk.data()), count * sizeof(double));
+    if (static_cast<std::size_t>(in.gcount()) != count * sizeof(double))
+      throw std::runtime_error("property file " + file_name + " has less than " +
+                               std::to_string(n) + " values");
+    handler(first, chunk.data(), count);
+  }
+}
+
+
+void read_text_values(std::ifstream & in, const std::string & file_name,
+                      const std::size_t n, const PropertyChunkHandler & handler)
+{
+  std::vector<double> chunk;
+  chunk.reserve(std::min(n, chunk_size));
+  std::size_t first = 0;
+
+  // characters of a number cut by the end of the buffer are moved to its front
+  std::vector<char> buffer(1 << 22);
+  std::size_t tail = 0;
+  bool eof = false;
+  while (first + chunk.size() < n && !eof)
+  {
+    in.read(buffer.data() + tail, buffer.size() - tail);
+    const std::size_t size = tail + in.gcount();
+    eof = !in;
+
+    std::size_t pos = 0;
+    while (first + chunk.size() < n)
+    {
+      while (pos < size && std::isspace(static_cast<unsigned char>(buffer[pos])))
+        pos++;
+      std::size_t end = pos;
+      while (end < size && !std::isspace(static_cast<unsigned char>(buffer[end])))
+        end++;
+      // incomplete number unless the file is over
+      if (pos == size || (end == size && !eof))
+        break;
+
+      double value;
+      const auto result = std::from_chars(buffer.data() + pos, buffer.data() + end, value);
+      if (result.ec != std::errc() || result.ptr != buffer.data() + end)
+        throw std::runtime_error("invalid value '" + std::string(buffer.data() + pos, end - pos) +
+                                 "' in property file " + file_name);
+      chunk.push_back(value);
+      pos = end;
+
+      if (chunk.size() == chunk_size)
+      {
+        handler(first, chunk.data(), chunk.size());
+        first += chunk.size();
+        chunk.clear();
+      }
+    }
+
+    tail = size - pos;
+    if (tail == buffer.size())
+      throw std::runtime_error("value too long in property file " + file_name);
+    std::memmove(buffer.data(), buffer.data() + pos, tail);
+  }
+
+  if (!chunk.empty())
+    handler(first, chunk.data(), chunk.size());
+  if (first + chunk.size() < n)
+    throw std::runtime_error("property file " + file_name + " has less than " +
+                             std::to_string(n) + " values");
+}
+}  // end anonymous namespace
+
+
+void read_property_values(const std::string & file_name, const PropertyFileFormat format,
+                          const std::size_t n, const PropertyChunkHandler & handler)
+{
+  std::ifstream in(file_name, std::ios::binary);
+  if (!in)
+    throw std::runtime_error("cannot open property file " + file_name);
+
+  if (format == PropertyFileFormat::binary)
+    read_binary_values(in, file_name, n, handler);
+  else
+    read_text_values(in, file_name, n, handler);
+}
+
+
+GriddedProperty::GriddedProperty(const PropertyFileConfig & conf)
+    :
+    dimensions(conf.dimensions),
+    origin(conf.origin),
+    spacing(conf.spacing)
+{
+  for (int d = 0; d < 3; ++d)
+  {
+    if (dimensions[d] == 0)
+      throw std::invalid_argument("grid of property " + conf.name + " has zero dimension");
+    if (spacing[d] <= 0)
+      throw std::invalid_argument("grid of property " + conf.name + " has non-positive spacing");
+  }
+
+  values.resize(dimensions[0] * dimensions[1] * dimensions[2]);
+  read_property_values(conf.file, conf.format, values.size(),
+                       [this](const std::size_t first, const double * chunk, const std::size_t count)
+                       {std::copy(chunk, chunk + count, values.begin() + first);});
+}
+
+
+double GriddedProperty::operator()(const angem::Point<3,double> & point) const
+{
+  // lower node and weight of the upper node in each direction
+  std::array<std::size_t,3> lower;
+  std::array<double,3> weight;
+  for (int d = 0; d < 3; ++d)
+  {
+    const double last = static_cast<double>(dimensions[d] - 1);
+    const double s = std::min(std::max((point[d] - origin[d]) / spacing[d], 0.0), last);
+    lower[d] = std::min(static_cast<std::size_t>(std::floor(s)),
+                        dimensions[d] > 1 ? dimensions[d] - 2 : 0);
+    weight[d] = (dimensions[d] > 1) ? s - lower[d] : 0;
+  }
+
+  double result = 0;
+  for (int corner = 0; corner < 8; ++corner)
+  {
+    std::size_t node[3];
+    double w = 1;
+    for (int d = 0; d < 3; ++d)
+    {
+      const bool upper = corner & (1 << d);
+      if (upper && dimensions[d] == 1)
+      {
+        w = 0;
+        break;
+      }
+      node[d] = lower[d] + (upper ? 1 : 0);
+      w *= upper ? weight[d] : 1 - weight[d];
+    }
+    if (w != 0)
+      result += w * values[node[0] + dimensions[0] * (node[1] + dimensions[1] * node[2])];
+  }
+  return result;
+}
+
+}  // end namespace gprs_data
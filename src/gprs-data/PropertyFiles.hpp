@@ -0,0 +1,41 @@
+#pragma once
+
+#include "SimdataConfig.hpp"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace gprs_data
+{
+
+// receives consecutive values read from a file: (index of the first value, values, count)
+using PropertyChunkHandler = std::function<void(const std::size_t, const double *, const std::size_t)>;
+
+/* Read the first n values of a property file.
+ * The file is streamed in chunks of fixed size that are passed to handler,
+ * so arrays with tens of millions of values are never held in memory twice.
+ * Text files: whitespace-separated numbers (anything after the n-th value is ignored).
+ * Binary files: 64-bit floats in native byte order.
+ * Throws std::runtime_error if the file cannot be read or is too short. */
+void read_property_values(const std::string & file_name, const PropertyFileFormat format,
+                          const std::size_t n, const PropertyChunkHandler & handler);
+
+/* Values at the nodes of a regular grid (x fastest, then y, then z)
+ * with trilinear interpolation between the nodes.
+ * Points outside the grid get the values at the closest grid boundary. */
+class GriddedProperty
+{
+ public:
+  // read the node values of conf
+  explicit GriddedProperty(const PropertyFileConfig & conf);
+  // interpolated value at a point
+  double operator()(const angem::Point<3,double> & point) const;
+
+ private:
+  std::array<std::size_t,3> dimensions;
+  angem::Point<3,double> origin, spacing;
+  std::vector<double> values;
+};
+
+}  // end namespace gprs_data
@@ -0,0 +1,182 @@
+#include "PropertyProgram.hpp"
+
+#include <algorithm>  // std::fill, std::copy
+#include <stdexcept>  // std::invalid_argument
+#include <unordered_map>
+
+namespace gprs_data
+{
+
+namespace
+{
+// whether expression assigns variables itself (muparser "a = ...")
+bool has_assignment(const std::string & expression)
+{
+  for (std::size_t i=0; i<expression.size(); ++i)
+    if (expression[i] == '=')
+    {
+      const char prev = (i > 0) ? expression[i-1] : ' ';
+      const char next = (i + 1 < expression.size()) ? expression[i+1] : ' ';
+      if (next == '=')
+        i++;  // skip "=="
+      else if (prev != '<' && prev != '>' && prev != '!')
+        return true;
+    }
+  return false;
+}
+}  // end anonymous namespace
+
+
+void PropertyProgram::compile(mu::Parser & parser, const std::string & expression,
+                              const std::vector<std::string> & variables,
+                              const std::vector<double*> & storage)
+{
+  try
+  {
+    for (std::size_t j=0; j<variables.size(); ++j)
+      parser.DefineVar(variables[j], storage[j]);
+    parser.SetExpr(expression);
+  }
+  catch(mu::Parser::exception_type & e)
+  {
+    throw std::invalid_argument("Initialization error: " + e.GetMsg() +
+                                " when setting expression '" + expression + "'");
+  }
+}
+
+
+PropertyProgram::PropertyProgram(const std::vector<DomainConfig> & domains,
+                                 const std::vector<std::string>  & variables)
+    :
+    variables(variables),
+    programs(domains.size())
+{
+  const std::size_t n_vars = variables.size();
+  std::unordered_map<std::string, std::size_t> variable_index;
+  for (std::size_t j=0; j<n_vars; ++j)
+    variable_index[variables[j]] = j;
+
+  // variables read by each distinct expression
+  std::unordered_map<std::string, std::size_t> expression_index;
+  std::vector<std::vector<std::size_t>> reads;
+  std::vector<double> dummy(n_vars, 0);
+  std::vector<double*> dummy_storage(n_vars);
+  for (std::size_t j=0; j<n_vars; ++j)
+    dummy_storage[j] = &dummy[j];
+
+  for (std::size_t idomain=0; idomain<domains.size(); ++idomain)
+  {
+    const auto & conf = domains[idomain];
+    std::vector<Instruction> program;
+    for (std::size_t i=0; i<conf.expressions.size(); ++i)
+    {
+      const std::string & expression = conf.expressions[i];
+      auto it = expression_index.find(expression);
+      if (it == expression_index.end())
+      {
+        mu::Parser parser;
+        compile(parser, expression, variables, dummy_storage);
+        std::vector<std::size_t> used;
+        double value = 0;
+        try
+        {
+          for (const auto & var : parser.GetUsedVar())
+            used.push_back(variable_index.at(var.first));
+          if (used.empty())
+            value = parser.Eval();
+        }
+        catch(mu::Parser::exception_type & e)
+        {
+          throw std::invalid_argument("Initialization error: " + e.GetMsg() +
+                                      " when setting expression '" + expression + "'");
+        }
+
+        it = expression_index.insert({expression, expressions.size()}).first;
+        expressions.push_back(expression);
+        constant.push_back(used.empty());
+        constant_values.push_back(value);
+        reads.push_back(std::move(used));
+      }
+      program.push_back({it->second, static_cast<std::size_t>(conf.local_to_global_vars.at(i))});
+    }
+
+    // drop expressions whose result is overwritten before it is read
+    // (all variables are stored in the end, so the last write is always kept)
+    std::vector<bool> overwritten(n_vars, false);
+    std::vector<bool> keep(program.size(), false);
+    for (std::size_t i = program.size(); i-- > 0;)
+    {
+      const Instruction & instruction = program[i];
+      // writes of "a = ..." inside expressions are not tracked: keep them
+      if (overwritten[instruction.target] &&
+          !has_assignment(expressions[instruction.expression]))
+        continue;
+      keep[i] = true;
+      overwritten[instruction.target] = true;
+      for (const std::size_t var : reads[instruction.expression])
+        overwritten[var] = false;
+    }
+    for (std::size_t i=0; i<program.size(); ++i)
+      if (keep[i])
+        programs[idomain].push_back(program[i]);
+  }
+}
+
+
+PropertyProgram::Evaluator::Evaluator(const PropertyProgram & program,
+                                      const std::size_t batch_size)
+    :
+    program(program),
+    columns(program.n_variables(), std::vector<double>(batch_size, 0)),
+    parsers(program.n_expressions())
+{
+  // bulk mode reads variable j of point i from storage[j] + i
+  std::vector<double*> storage(columns.size());
+  for (std::size_t j=0; j<columns.size(); ++j)
+    storage[j] = columns[j].data();
+
+  for (std::size_t i=0; i<parsers.size(); ++i)
+    if (!program.constant[i])
+      compile(parsers[i], program.expressions[i], program.variables, storage);
+}
+
+
+void PropertyProgram::Evaluator::evaluate(const std::size_t idomain,
+                                          const std::vector<angem::Point<3,double>> & points)
+{
+  const std::size_t n = points.size();
+  if (n > batch_size())
+    throw std::invalid_argument("batch is larger than the evaluator");
+
+  for (auto & column : columns)
+    std::fill(column.begin(), column.begin() + n, 0);
+  for (std::size_t i=0; i<n; ++i)
+    for (int d=0; d<3; ++d)
+      columns[d][i] = points[i][d];
+
+  std::vector<double> result(n);
+  for (const Instruction & instruction : program.programs[idomain])
+  {
+    auto & target = columns[instruction.target];
+    if (program.constant[instruction.expression])
+    {
+      std::fill(target.begin(), target.begin() + n, program.constant_values[instruction.expression]);
+      continue;
+    }
+
+    // results go into a buffer since the target can be read by the expression
+    try
+    {
+      parsers[instruction.expression].Eval(result.data(), static_cast<int>(n));
+    }
+    catch(mu::Parser::exception_type & e)
+    {
+      throw std::runtime_error("Evaluation error: " + e.GetMsg() +
+                               " when evaluating expression '" +
+                               program.expressions[instruction.expression] + "'");
+    }
+    std::copy(result.begin(), result.end(), target.begin());
+  }
+}
+
+}  // end namespace gprs_data
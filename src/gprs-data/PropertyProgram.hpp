@@ -0,0 +1,79 @@
+#pragma once
+
+#include "SimdataConfig.hpp"
+#include "muparser/muParser.h"
+
+#include <string>
+#include <vector>
+
+namespace gprs_data
+{
+
+/* Rock property expressions of all domains compiled into one program.
+ * Every distinct expression string is parsed once and shared by all domains
+ * that use it. Variables that an expression reads are taken from the parser
+ * (the dependency graph of a domain follows the expression order, which is the
+ * evaluation order of the config). The program of a domain keeps only the
+ * expressions whose results are read later or end up in the cell properties:
+ * a value that is overwritten before anything reads it is not computed.
+ * Expressions that read no variables are evaluated once.
+ *
+ * Points are evaluated in batches by an Evaluator: variables are stored as
+ * columns (one array per variable) and each expression runs over the whole
+ * batch in muparser bulk mode, so the bytecode is reused for all points. */
+class PropertyProgram
+{
+ public:
+  // compile expressions of all domains; variables are config.all_vars
+  // (x, y, z first). throws std::invalid_argument on parser errors
+  PropertyProgram(const std::vector<DomainConfig> & domains,
+                  const std::vector<std::string>  & variables);
+  // number of variables (x, y, z and properties)
+  std::size_t n_variables() const {return variables.size();}
+  // number of distinct compiled expressions
+  std::size_t n_expressions() const {return expressions.size();}
+  // number of expressions evaluated for the domain
+  std::size_t n_instructions(const std::size_t idomain) const {return programs[idomain].size();}
+
+  /* Evaluation workspace: compiled parsers bound to the variable columns.
+   * Parsers are not thread-safe, so use one evaluator per thread. */
+  class Evaluator
+  {
+   public:
+    Evaluator(const PropertyProgram & program, const std::size_t batch_size = 4096);
+    Evaluator(const Evaluator &) = delete;
+    Evaluator & operator=(const Evaluator &) = delete;
+    // evaluate domain expressions at points (at most batch_size points);
+    // variables that are not set by the domain are zero
+    void evaluate(const std::size_t idomain,
+                  const std::vector<angem::Point<3,double>> & points);
+    // value of variable ivar at point i after evaluate
+    inline double value(const std::size_t ivar, const std::size_t i) const {return columns[ivar][i];}
+    std::size_t batch_size() const {return columns.empty() ? 0 : columns[0].size();}
+
+   private:
+    const PropertyProgram & program;
+    std::vector<std::vector<double>> columns;
+    std::vector<mu::Parser> parsers;  // one per distinct expression
+  };
+
+ private:
+  // evaluate expression into variable target
+  struct Instruction
+  {
+    std::size_t expression;
+    std::size_t target;
+  };
+  // parser for expression with all variables bound to storage
+  static void compile(mu::Parser & parser, const std::string & expression,
+                      const std::vector<std::string> & variables,
+                      const std::vector<double*> & storage);
+
+  std::vector<std::string> variables;
+  std::vector<std::string> expressions;        // distinct expressions
+  std::vector<bool> constant;                  // reads no variables
+  std::vector<double> constant_values;
+  std::vector<std::vector<Instruction>> programs;  // per domain
+};
+
+}  // end namespace gprs_data
@@ -0,0 +1,242 @@
+#include "Renumbering.hpp"
+#include "renum.hpp"
+#include "mesh/CellGeometryCache.hpp"
+#include "parallel/parallel_for.hpp"
+
+#include <algorithm>  // std::stable_sort
+#include <limits>     // std::numeric_limits
+#include <numeric>    // std::iota
+#include <stdexcept>  // std::invalid_argument
+
+namespace gprs_data
+{
+
+using Point = angem::Point<3,double>;
+
+namespace
+{
+// spread the lower 21 bits of x so that there are two zero bits between each
+uint64_t spread_bits(uint64_t x)
+{
+  x &= 0x1fffff;
+  x = (x | x << 32) & 0x1f00000000ffff;
+  x = (x | x << 16) & 0x1f0000ff0000ff;
+  x = (x | x << 8)  & 0x100f00f00f00f00f;
+  x = (x | x << 4)  & 0x10c30c30c30c30c3;
+  x = (x | x << 2)  & 0x1249249249249249;
+  return x;
+}
+
+// map a normalized coordinate onto a 21-bit integer grid
+uint64_t quantize(const double v)
+{
+  const double scale = (1 << 21) - 1;
+  return static_cast<uint64_t>(std::min(std::max(v, 0.0), 1.0) * scale);
+}
+}  // end anonymous namespace
+
+
+uint64_t morton_code(const double xn, const double yn, const double zn)
+{
+  return spread_bits(quantize(xn)) |
+      (spread_bits(quantize(yn)) << 1) |
+      (spread_bits(quantize(zn)) << 2);
+}
+
+
+uint64_t hilbert_code(const double xn, const double yn, const double zn)
+{
+  // J. Skilling, Programming the Hilbert curve, AIP Conf. Proc. 707 (2004)
+  // convert axes into the "transposed" hilbert index
+  uint64_t x[3] = {quantize(xn), quantize(yn), quantize(zn)};
+  const uint64_t m = uint64_t(1) << 20;
+  for (uint64_t q = m; q > 1; q >>= 1)
+  {
+    const uint64_t p = q - 1;
+    for (int i = 0; i < 3; ++i)
+      if (x[i] & q)
+        x[0] ^= p;  // invert
+      else
+      {
+        const uint64_t t = (x[0] ^ x[i]) & p;  // exchange
+        x[0] ^= t;
+        x[i] ^= t;
+      }
+  }
+  // gray encode
+  for (int i = 1; i < 3; ++i)
+    x[i] ^= x[i-1];
+  uint64_t t = 0;
+  for (uint64_t q = m; q > 1; q >>= 1)
+    if (x[2] & q)
+      t ^= q - 1;
+  for (int i = 0; i < 3; ++i)
+    x[i] ^= t;
+
+  // interleave: x[0] holds the most significant bit of each triple
+  return (spread_bits(x[0]) << 2) | (spread_bits(x[1]) << 1) | spread_bits(x[2]);
+}
+
+
+namespace
+{
+std::vector<std::size_t> curve_ordering(const mesh::Mesh & grid, const RenumberingMethod method)
+{
+  const mesh::CellGeometryCache cell_geometry(grid);
+  const std::size_t n_cells = grid.n_cells();
+
+  // normalize by the largest extent so that the curve is not stretched
+  const Point & lower = cell_geometry.domain_min();
+  const Point & upper = cell_geometry.domain_max();
+  double extent = std::max({upper.x() - lower.x(),
+                            upper.y() - lower.y(),
+                            upper.z() - lower.z()});
+  if (extent <= 0)
+    extent = 1;
+
+  std::vector<uint64_t> codes(n_cells);
+  parallel::parallel_for(0, n_cells, [&](const std::size_t cell)
+  {
+    const Point & c = cell_geometry.center(cell);
+    const double xn = (c.x() - lower.x()) / extent;
+    const double yn = (c.y() - lower.y()) / extent;
+    const double zn = (c.z() - lower.z()) / extent;
+    codes[cell] = (method == RenumberingMethod::hilbert) ? hilbert_code(xn, yn, zn)
+                                                         : morton_code(xn, yn, zn);
+  });
+
+  std::vector<std::size_t> order(n_cells);
+  std::iota(order.begin(), order.end(), 0);
+  // stable so that the result does not depend on the sort implementation
+  std::stable_sort(order.begin(), order.end(),
+                   [&codes](const std::size_t c1, const std::size_t c2) {return codes[c1] < codes[c2];});
+
+  std::vector<std::size_t> new_index(n_cells);
+  for (std::size_t i = 0; i < n_cells; ++i)
+    new_index[order[i]] = i;
+  return new_index;
+}
+
+
+std::vector<std::size_t> rcm_ordering(const mesh::Mesh & grid)
+{
+  const std::size_t n_cells = grid.n_cells();
+  if (n_cells > static_cast<std::size_t>(std::numeric_limits<int>::max()))
+    throw std::invalid_argument("too many cells for rcm renumbering");
+
+  // renum orders the "vertices" of a cell-vertex graph; pass interior faces
+  // as "cells" and grid cells as "vertices" so that it orders the grid cells
+  // along the face connections
+  std::vector<int> ia = {0}, ja;
+  for (const auto & face : grid.faces)
+    if (face.neighbors.size() == 2)
+    {
+      ja.push_back(static_cast<int>(face.neighbors[0]));
+      ja.push_back(static_cast<int>(face.neighbors[1]));
+      ia.push_back(static_cast<int>(ja.size()));
+    }
+
+  std::vector<int> rcm(n_cells);
+  renum().convert(static_cast<int>(ia.size() - 1), static_cast<int>(n_cells), ia, ja, rcm);
+  return std::vector<std::size_t>(rcm.begin(), rcm.end());
+}
+}  // end anonymous namespace
+
+
+std::vector<std::size_t> cell_ordering(const mesh::Mesh & grid, const RenumberingMethod method)
+{
+  switch (method)
+  {
+    case RenumberingMethod::none :
+      {
+        std::vector<std::size_t> new_index(grid.n_cells());
+        std::iota(new_index.begin(), new_index.end(), 0);
+        return new_index;
+      }
+    case RenumberingMethod::rcm :
+      return rcm_ordering(grid);
+    case RenumberingMethod::hilbert :
+    case RenumberingMethod::morton :
+      return curve_ordering(grid, method);
+  }
+  throw std::invalid_argument("unknown renumbering method");
+}
+
+
+std::vector<std::size_t> renumber_mesh(mesh::Mesh & grid, const RenumberingMethod method)
+{
+  const std::size_t n_cells = grid.n_cells();
+  if (method == RenumberingMethod::none || n_cells == 0)
+    return {};
+
+  std::vector<std::size_t> new_cell = cell_ordering(grid, method);
+
+  // cells
+  std::vector<std::vector<std::size_t>> cells(n_cells);
+  std::vector<int> shape_ids(n_cells), cell_markers(n_cells);
+  for (std::size_t i = 0; i < n_cells; ++i)
+  {
+    cells[new_cell[i]] = std::move(grid.cells[i]);
+    shape_ids[new_cell[i]] = grid.shape_ids[i];
+    cell_markers[new_cell[i]] = grid.cell_markers[i];
+  }
+
+  // vertices in the order they are first met in the new cells
+  // (vertices that are not in any cell go last)
+  const std::size_t n_vertices = grid.n_vertices();
+  const std::size_t unset = std::numeric_limits<std::size_t>::max();
+  std::vector<std::size_t> new_vertex(n_vertices, unset);
+  std::size_t n_numbered = 0;
+  for (auto & cell : cells)
+    for (std::size_t & v : cell)
+    {
+      if (new_vertex[v] == unset)
+        new_vertex[v] = n_numbered++;
+      v = new_vertex[v];
+    }
+  for (std::size_t v = 0; v < n_vertices; ++v)
+    if (new_vertex[v] == unset)
+      new_vertex[v] = n_numbered++;
+
+  std::vector<Point> points(n_vertices);
+  for (std::size_t v = 0; v < n_vertices; ++v)
+    points[new_vertex[v]] = grid.vertices.points[v];
+  angem::PointSet<3,double> vertices;
+  vertices.points.reserve(n_vertices);
+  for (const auto & p : points)
+    vertices.insert(p);
+
+  // faces ordered by their first neighbor cell
+  std::vector<mesh::Face> faces = std::move(grid.faces);
+  for (mesh::Face & face : faces)
+  {
+    for (std::size_t & v : face.ordered_indices)
+      v = new_vertex[v];
+    for (std::size_t & c : face.neighbors)
+      c = new_cell[c];
+    std::sort(face.neighbors.begin(), face.neighbors.end());
+  }
+  const auto first_cell = [unset](const mesh::Face & face)
+                          {return face.neighbors.empty() ? unset : face.neighbors.front();};
+  std::stable_sort(faces.begin(), faces.end(),
+                   [&first_cell](const mesh::Face & f1, const mesh::Face & f2)
+                   {return first_cell(f1) < first_cell(f2);});
+
+  grid.map_faces.clear();
+  grid.map_faces.reserve(faces.size());
+  for (std::size_t i = 0; i < faces.size(); ++i)
+  {
+    faces[i].index = i;
+    faces[i].old_index = i;
+    grid.map_faces.insert({mesh::hash_value(faces[i].ordered_indices), i});
+  }
+  grid.faces = std::move(faces);
+
+  grid.cells = std::move(cells);
+  grid.shape_ids = std::move(shape_ids);
+  grid.cell_markers = std::move(cell_markers);
+  grid.vertices = std::move(vertices);
+  return new_cell;
+}
+
+}  // end namespace gprs_data
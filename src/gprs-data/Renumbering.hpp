@@ -0,0 +1,34 @@
+#pragma once
+
+#include "mesh/Mesh.hpp"
+#include "SimdataConfig.hpp"
+
+#include <cstdint>  // uint64_t
+#include <vector>
+
+namespace gprs_data
+{
+
+// 63-bit morton (z-order) code of a point with coordinates normalized to [0, 1]
+uint64_t morton_code(const double xn, const double yn, const double zn);
+
+// 63-bit index along the 3D hilbert curve of a point with coordinates normalized to [0, 1]
+// (neighboring indices are always neighboring grid points, unlike morton codes)
+uint64_t hilbert_code(const double xn, const double yn, const double zn);
+
+// new index of each cell of grid for the given method
+// (rcm: reverse Cuthill-McKee on the face adjacency graph,
+// hilbert/morton: cell centers sorted along the curve)
+std::vector<std::size_t> cell_ordering(const mesh::Mesh & grid, const RenumberingMethod method);
+
+/* Renumber cells, vertices and faces of grid to improve memory locality.
+ * Cells are ordered with cell_ordering, vertices in the order of their
+ * first appearance in the new cells, and faces by their first neighbor cell,
+ * so the dfm and edfm control volumes, which are numbered in face and cell
+ * order, end up next to the volumes of their host cells.
+ * Cell and face markers are preserved. Must be called before the grid is
+ * used by SimData (no faces are split yet).
+ * Returns the new index of each cell (empty if method is none). */
+std::vector<std::size_t> renumber_mesh(mesh::Mesh & grid, const RenumberingMethod method);
+
+}  // end namespace gprs_data
@@ -2,8 +2,13 @@
 
 #include "angem/Polygon.hpp"
 
+#include <array>
 #include <map>
 #include <memory> // shared / unique_ptr
+#include <stdexcept>  // std::invalid_argument
+
+
+namespace gprs_data {class StageResults;}
 
 
 enum MSPartitioning : int
@@ -17,12 +22,34 @@ enum MSPartitioning : int
 enum PartitioningMethod
 {
   metis = 0,
-  geometric = 1
+  geometric = 1,
+  morton = 2     // equal-size blocks along the morton (z-order) curve
 };
 
 enum OutputFormat
 {
-  gprs, vtk
+  gprs,
+  vtk,            // legacy ascii vtk
+  vtk_binary,     // legacy binary (big-endian) vtk
+  vtu,            // xml vtu with raw appended data
+  vtu_compressed, // xml vtu with zlib-compressed appended data
+  pvtu            // reservoir split into .vtu pieces tied by a .pvtu index
+};
+
+// cell and vertex ordering applied right after the mesh is loaded
+enum class RenumberingMethod
+{
+  none,     // keep the order of the mesh file
+  rcm,      // reverse Cuthill-McKee on the cell connections
+  hilbert,  // cell centers along the hilbert curve
+  morton    // cell centers along the morton (z-order) curve
+};
+
+// encoding of property files
+enum class PropertyFileFormat
+{
+  text,    // whitespace-separated numbers
+  binary   // 64-bit floats in native byte order
 };
 
 
@@ -86,11 +113,28 @@ struct WellConfig
 {
   std::string name;
   double radius;
+  double skin = 0;  // skin factor in the peaceman well index
   std::vector<angem::Point<3,double>> coordinates;
   std::vector<bool> perforated;
 };
 
 
+// rock property read from a file instead of domain expressions
+struct PropertyFileConfig
+{
+  std::string name;  // property (variable) name
+  std::string file;  // msh2gprs resolves relative paths against the config directory
+  PropertyFileFormat format = PropertyFileFormat::text;
+  // gridded data: values at the nodes of a regular grid (x fastest)
+  // that are sampled at cell centers with trilinear interpolation.
+  // if dimensions are zero the file holds one value per cell (mesh file order)
+  std::array<std::size_t,3> dimensions = {0, 0, 0};
+  angem::Point<3,double> origin = {0, 0, 0};
+  angem::Point<3,double> spacing = {1, 1, 1};
+  bool gridded() const {return dimensions[0] > 0;}
+};
+
+
 struct SimdataConfig
 {
   std::vector<EmbeddedFractureConfig>  fractures;  //  embedded  fractures
@@ -99,6 +143,8 @@ struct SimdataConfig
   std::vector<BCConfig>                bc_faces;
   std::vector<BCNodeConfig>            bc_nodes;
   std::vector<WellConfig>              wells;
+  // applied after domain expressions (file values take precedence)
+  std::vector<PropertyFileConfig>      property_files;
 
   EDFMMethod edfm_method = EDFMMethod::simple;
 
@@ -126,6 +172,27 @@ struct SimdataConfig
 
   // output format
   std::vector<OutputFormat> output_formats = {OutputFormat::gprs, OutputFormat::vtk};
+  // number of reservoir pieces for pvtu output (0 means number of threads)
+  // multiscale partitioning is used instead if available
+  size_t n_vtk_pieces = 0;
+  // save parsed mesh into a binary snapshot (<mesh file>.cache)
+  // and load it on later runs if the mesh file has not changed
+  bool mesh_cache = true;
+  // save results of expensive stages (rock properties, reservoir transes)
+  // and reuse them while their inputs do not change (opt-in: results of
+  // large models take gigabytes in <config dir>/.msh2gprs-cache)
+  bool stage_cache = false;
+  // where stage results are saved (set by the driver, empty disables caching)
+  std::string stage_cache_dir;
+  // least recently used stage results are removed above this size
+  std::size_t stage_cache_max_bytes = std::size_t(8) << 30;  // 8 GB
+  // stage results kept in memory for all runs of a batch (set by the driver)
+  std::shared_ptr<gprs_data::StageResults> shared_stage_results;
+  // write reservoir connections that later stages do not modify
+  // (not touching embedded fractures) out of memory as soon as they are computed
+  bool stream_connections = false;
+  // reorder cells and vertices to improve memory locality of later stages
+  RenumberingMethod renumbering = RenumberingMethod::none;
 
   // output file names
   // GPRS format
@@ -146,6 +213,39 @@ struct SimdataConfig
 };
 
 
+// convert output format name from config file into OutputFormat
+inline OutputFormat output_format(const std::string & name)
+{
+  if (name == "gprs") return OutputFormat::gprs;
+  else if (name == "vtk") return OutputFormat::vtk;
+  else if (name == "vtk-binary") return OutputFormat::vtk_binary;
+  else if (name == "vtu") return OutputFormat::vtu;
+  else if (name == "vtu-compressed") return OutputFormat::vtu_compressed;
+  else if (name == "pvtu") return OutputFormat::pvtu;
+  else throw std::invalid_argument("unknown output format " + name);
+}
+
+
+// convert renumbering method name from config file into RenumberingMethod
+inline RenumberingMethod renumbering_method(const std::string & name)
+{
+  if (name == "none") return RenumberingMethod::none;
+  else if (name == "rcm") return RenumberingMethod::rcm;
+  else if (name == "hilbert") return RenumberingMethod::hilbert;
+  else if (name == "morton") return RenumberingMethod::morton;
+  else throw std::invalid_argument("unknown renumbering method " + name);
+}
+
+
+// convert property file format name from config file into PropertyFileFormat
+inline PropertyFileFormat property_file_format(const std::string & name)
+{
+  if (name == "text") return PropertyFileFormat::text;
+  else if (name == "binary") return PropertyFileFormat::binary;
+  else throw std::invalid_argument("unknown property file format " + name);
+}
+
+
 // find an item in a vector
 template<typename T>
 std::size_t find(const T & item, const std::vector<T> & vec)
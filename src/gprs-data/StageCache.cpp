@@ -0,0 +1,212 @@
+#include "StageCache.hpp"
+
+#include <algorithm>   // std::sort
+#include <cstdio>      // std::rename, std::remove, std::snprintf
+#include <fstream>
+#include <functional>  // std::hash
+#include <iostream>
+#include <thread>
+
+#include <dirent.h>    // opendir, readdir
+#include <sys/stat.h>  // stat
+#include <utime.h>     // utime
+
+namespace gprs_data
+{
+
+namespace
+{
+const std::uint64_t stage_cache_magic = 0x45474154534d4d32ULL;  // "2MMSTAGE"
+// bump when the stage algorithms or the stored data change
+const std::uint64_t stage_cache_version = 1;
+const std::string cache_extension = ".bin";
+constexpr double megabyte = 1024.0 * 1024.0;
+}
+
+
+StageResults::StageResults(const std::size_t max_bytes)
+    :
+    max_bytes(max_bytes)
+{}
+
+
+bool StageResults::get(const std::string & name, std::vector<char> & data)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  const auto it = entries.find(name);
+  if (it == entries.end())
+    return false;
+  it->second.last_use = ++clock;
+  data = it->second.data;
+  return true;
+}
+
+
+void StageResults::put(const std::string & name, const std::vector<char> & data)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  auto & entry = entries[name];
+  total_bytes += data.size();
+  total_bytes -= entry.data.size();
+  entry.data = data;
+  entry.last_use = ++clock;
+
+  // drop the least recently used results (there are a few per mesh)
+  while (total_bytes > max_bytes && entries.size() > 1)
+  {
+    auto oldest = entries.end();
+    for (auto it = entries.begin(); it != entries.end(); ++it)
+      if (it->first != name && (oldest == entries.end() ||
+                                it->second.last_use < oldest->second.last_use))
+        oldest = it;
+    total_bytes -= oldest->second.data.size();
+    entries.erase(oldest);
+  }
+}
+
+
+StageCache::StageCache(const std::string & directory, const std::size_t max_bytes,
+                       const std::shared_ptr<StageResults> & memory)
+    :
+    directory(directory),
+    max_bytes(max_bytes),
+    memory(memory)
+{
+  if (!this->directory.empty() && this->directory.back() != '/')
+    this->directory += '/';
+}
+
+
+std::string StageCache::entry_name(const std::string & stage, const std::uint64_t key) const
+{
+  char hex[17];
+  std::snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(key));
+  return stage + "-" + hex;
+}
+
+
+std::string StageCache::file_name(const std::string & stage, const std::uint64_t key) const
+{
+  return directory + entry_name(stage, key) + cache_extension;
+}
+
+
+bool StageCache::load(const std::string & stage, const std::uint64_t key,
+                      CacheReader & reader) const
+{
+  if (!enabled()) return false;
+
+  std::vector<char> data;
+  if (memory && memory->get(entry_name(stage, key), data))
+  {
+    reader = CacheReader(std::move(data));
+    return true;
+  }
+  if (directory.empty()) return false;
+
+  const std::string fname = file_name(stage, key);
+  std::ifstream in(fname.c_str(), std::ios::binary);
+  if (!in) return false;
+
+  std::uint64_t header[4];  // magic, version, key, size
+  in.read(reinterpret_cast<char*>(header), sizeof(header));
+  if (!in || header[0] != stage_cache_magic || header[1] != stage_cache_version ||
+      header[2] != key)
+    return false;
+
+  data.resize(header[3]);
+  in.read(data.data(), data.size());
+  if (!in) return false;
+
+  if (memory)
+    memory->put(entry_name(stage, key), data);
+  reader = CacheReader(std::move(data));
+  utime(fname.c_str(), nullptr);  // mark as recently used
+  return true;
+}
+
+
+void StageCache::save(const std::string & stage, const std::uint64_t key,
+                      const CacheWriter & writer) const
+{
+  if (!enabled()) return;
+
+  if (memory)
+    memory->put(entry_name(stage, key), writer.data());
+  if (directory.empty()) return;
+
+  const std::string fname = file_name(stage, key);
+  // batch jobs may save the same result concurrently: one temporary per thread
+  const std::string tmp_file = fname + "." +
+      std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+  {
+    std::ofstream out(tmp_file.c_str(), std::ios::binary);
+    if (!out)
+      throw std::runtime_error("cannot open file " + tmp_file);
+    const std::uint64_t header[4] = {stage_cache_magic, stage_cache_version, key,
+                                     writer.data().size()};
+    out.write(reinterpret_cast<const char*>(header), sizeof(header));
+    out.write(writer.data().data(), writer.data().size());
+    if (!out)
+      throw std::runtime_error("failed writing " + tmp_file);
+  }
+
+  if (std::rename(tmp_file.c_str(), fname.c_str()) != 0)
+  {
+    std::remove(tmp_file.c_str());
+    throw std::runtime_error("cannot write " + fname);
+  }
+
+  const std::size_t cache_size = evict(fname);
+  std::cout << "saved " << stage << " to " << fname << " ("
+            << writer.data().size() / megabyte << " MB, cache "
+            << cache_size / megabyte << " MB)" << std::endl;
+}
+
+
+std::size_t StageCache::evict(const std::string & keep) const
+{
+  struct Entry
+  {
+    std::string file;
+    std::size_t size;
+    time_t last_use;
+  };
+  std::vector<Entry> entries;
+  std::size_t total = 0;
+
+  DIR * dir = opendir(directory.c_str());
+  if (!dir) return 0;
+  while (const dirent * item = readdir(dir))
+  {
+    const std::string name = item->d_name;
+    if (name.size() <= cache_extension.size() ||
+        name.compare(name.size() - cache_extension.size(), cache_extension.size(),
+                     cache_extension) != 0)
+      continue;
+    struct stat info;
+    const std::string file = directory + name;
+    if (stat(file.c_str(), &info) != 0 || !S_ISREG(info.st_mode))
+      continue;
+    entries.push_back({file, static_cast<std::size_t>(info.st_size), info.st_mtime});
+    total += info.st_size;
+  }
+  closedir(dir);
+
+  // oldest first
+  std::sort(entries.begin(), entries.end(),
+            [](const Entry & a, const Entry & b) {return a.last_use < b.last_use;});
+  for (const auto & entry : entries)
+  {
+    if (total <= max_bytes) break;
+    if (entry.file == keep) continue;
+    if (std::remove(entry.file.c_str()) == 0)
+    {
+      std::cout << "removed old stage cache " << entry.file << std::endl;
+      total -= entry.size;
+    }
+  }
+  return total;
+}
+
+}  // end namespace gprs_data
@@ -0,0 +1,221 @@
+#pragma once
+
+#include "angem/Point.hpp"
+
+#include <cstdint>      // uint64_t
+#include <cstring>      // memcpy
+#include <memory>       // std::shared_ptr
+#include <mutex>
+#include <stdexcept>    // std::runtime_error
+#include <string>
+#include <type_traits>  // std::is_arithmetic
+#include <unordered_map>
+#include <vector>
+
+namespace gprs_data
+{
+
+/* 64-bit FNV-1a hash of a sequence of values.
+ * Used to build keys for cached stage results from the parts
+ * of the config and the mesh that a stage depends on. */
+class Hasher
+{
+ public:
+  template <typename T>
+  typename std::enable_if<std::is_arithmetic<T>::value, Hasher &>::type
+  operator<<(const T value)
+  {
+    std::uint64_t word = 0;
+    std::memcpy(&word, &value, sizeof(T));
+    hash = (hash ^ word) * prime;
+    return *this;
+  }
+
+  Hasher & operator<<(const std::string & str)
+  {
+    (*this) << str.size();
+    for (const char c : str)
+      (*this) << c;
+    return *this;
+  }
+
+  Hasher & operator<<(const angem::Point<3,double> & point)
+  {
+    return (*this) << point[0] << point[1] << point[2];
+  }
+
+  template <typename T>
+  Hasher & operator<<(const std::vector<T> & values)
+  {
+    (*this) << values.size();
+    for (const auto & value : values)
+      (*this) << value;
+    return *this;
+  }
+
+  std::uint64_t value() const {return hash;}
+
+ private:
+  static constexpr std::uint64_t prime = 0x100000001b3ULL;
+  std::uint64_t hash = 0xcbf29ce484222325ULL;
+};
+
+
+// serializes stage results into a byte buffer
+class CacheWriter
+{
+ public:
+  template <typename T>
+  typename std::enable_if<std::is_arithmetic<T>::value>::type
+  write(const T value)
+  {
+    const std::size_t pos = buffer.size();
+    buffer.resize(pos + sizeof(T));
+    std::memcpy(buffer.data() + pos, &value, sizeof(T));
+  }
+
+  template <typename T>
+  typename std::enable_if<std::is_arithmetic<T>::value>::type
+  write(const std::vector<T> & values)
+  {
+    write(values.size());
+    const std::size_t pos = buffer.size();
+    buffer.resize(pos + values.size() * sizeof(T));
+    if (!values.empty())
+      std::memcpy(buffer.data() + pos, values.data(), values.size() * sizeof(T));
+  }
+
+  void write(const std::string & str)
+  {
+    write(str.size());
+    buffer.insert(buffer.end(), str.begin(), str.end());
+  }
+
+  const std::vector<char> & data() const {return buffer;}
+
+ private:
+  std::vector<char> buffer;
+};
+
+
+// reads data written with CacheWriter; throws std::runtime_error if
+// the buffer is too short
+class CacheReader
+{
+ public:
+  CacheReader() = default;
+  explicit CacheReader(std::vector<char> && data) : buffer(std::move(data)) {}
+
+  template <typename T>
+  typename std::enable_if<std::is_arithmetic<T>::value, T>::type
+  read()
+  {
+    T value;
+    copy(&value, sizeof(T));
+    return value;
+  }
+
+  template <typename T>
+  typename std::enable_if<std::is_arithmetic<T>::value>::type
+  read(std::vector<T> & values)
+  {
+    const std::size_t size = read<std::size_t>();
+    if (size > (buffer.size() - pos) / sizeof(T))
+      throw std::runtime_error("corrupt cache");
+    values.resize(size);
+    copy(values.data(), size * sizeof(T));
+  }
+
+  void read(std::string & str)
+  {
+    const std::size_t size = read<std::size_t>();
+    if (size > buffer.size() - pos)
+      throw std::runtime_error("corrupt cache");
+    str.assign(buffer.data() + pos, size);
+    pos += size;
+  }
+
+  // true if all data has been read
+  bool done() const {return pos == buffer.size();}
+
+ private:
+  void copy(void * dst, const std::size_t n)
+  {
+    if (n > buffer.size() - pos)
+      throw std::runtime_error("corrupt cache");
+    if (n > 0)
+      std::memcpy(dst, buffer.data() + pos, n);
+    pos += n;
+  }
+
+  std::vector<char> buffer;
+  std::size_t pos = 0;
+};
+
+
+/* Stage results kept in memory and shared by the runs of a batch:
+ * realisations whose stage inputs are the same get the result of the
+ * first one without recomputing it or going through the disk.
+ * Thread-safe. Least recently used results are dropped while the
+ * results take more than max_bytes. */
+class StageResults
+{
+ public:
+  explicit StageResults(const std::size_t max_bytes);
+  // copy the result stored under name into data; false if there is none
+  bool get(const std::string & name, std::vector<char> & data);
+  void put(const std::string & name, const std::vector<char> & data);
+
+ private:
+  struct Entry
+  {
+    std::vector<char> data;
+    std::uint64_t last_use;
+  };
+
+  std::mutex mutex;
+  std::unordered_map<std::string, Entry> entries;
+  std::size_t total_bytes = 0;
+  const std::size_t max_bytes;
+  std::uint64_t clock = 0;  // incremented on every access
+};
+
+
+/* On-disk storage of stage results between runs.
+ * Every (stage, key) pair has its own file <directory>/<stage>-<key>.bin,
+ * so changing any input of a stage gives a different file, switching back
+ * to earlier inputs (e.g. alternating fracture or well variants) finds
+ * the earlier result, and concurrent runs with different inputs never
+ * overwrite each other. After a save, the least recently used results are
+ * removed until the directory holds at most max_bytes.
+ * With shared results (batch runs) they are looked up in memory first.
+ * Empty directory and no shared results disable the cache. */
+class StageCache
+{
+ public:
+  StageCache(const std::string & directory, const std::size_t max_bytes,
+             const std::shared_ptr<StageResults> & memory = nullptr);
+  // whether the cache is used at all
+  bool enabled() const {return !directory.empty() || memory;}
+  // load stage data into reader; returns false if there is no result
+  // for this key
+  bool load(const std::string & stage, const std::uint64_t key,
+            CacheReader & reader) const;
+  // save stage data; throws std::runtime_error on failure
+  void save(const std::string & stage, const std::uint64_t key,
+            const CacheWriter & writer) const;
+
+ private:
+  // name of a result: <stage>-<key>
+  std::string entry_name(const std::string & stage, const std::uint64_t key) const;
+  std::string file_name(const std::string & stage, const std::uint64_t key) const;
+  // remove least recently used results (except keep) while the cache is too large;
+  // returns the size of the cache
+  std::size_t evict(const std::string & keep) const;
+
+  std::string directory;
+  std::size_t max_bytes;
+  std::shared_ptr<StageResults> memory;
+};
+
+}  // end namespace gprs_data
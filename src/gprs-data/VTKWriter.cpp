@@ -6,26 +6,43 @@
 namespace IO
 {
 
-// edfm
-void VTKWriter::write_surface_geometry(const std::vector<Point>    & vertices,
-                                       const std::vector<std::vector<std::size_t>> & cells,
-                                       std::ofstream               & out)
+void VTKWriter::write_header(const std::string & title, std::ofstream & out, const bool binary)
 {
   out << "# vtk DataFile Version 2.0 \n";
-  out << "3D Fractures \n";
-  out << "ASCII \n \n";
+  out << title << " \n";
+  if (binary)
+    out << "BINARY\n";
+  else
+    out << "ASCII \n \n";
   out << "DATASET UNSTRUCTURED_GRID \n";
+}
 
-  // points
+
+void VTKWriter::write_points(const std::vector<Point> & vertices, std::ofstream & out, const bool binary)
+{
   const std::size_t n_points = vertices.size();
-  out << "POINTS" << "\t"
-      << n_points << " float"
-      << std::endl;
+  if (binary)
+  {
+    out << "POINTS" << "\t" << n_points << " double" << "\n";
+    std::vector<double> coord(3 * n_points);
+    for (std::size_t i = 0; i < n_points; ++i)
+      for (int j = 0; j < 3; ++j)
+        coord[3*i + j] = vertices[i][j];
+    write_big_endian<double>(coord, out);
+    out << "\n";
+  }
+  else
+  {
+    out << "POINTS" << "\t" << n_points << " float" << "\n";
+    for (const auto & p : vertices)
+      out << p << "\n";
+  }
+}
 
-  for (const auto & p : vertices)
-    out << p << std::endl;
 
-  // cells
+void VTKWriter::write_cells(const std::vector<std::vector<std::size_t>> & cells,
+                            std::ofstream & out, const bool binary)
+{
   const std::size_t n_cells = cells.size();
   std::size_t vind_size_total = 0;
   for (const auto & cell : cells)
@@ -34,46 +51,81 @@ void VTKWriter::write_surface_geometry(const std::vector<Point>    & vertices,
   out << "CELLS" << "\t"
       << n_cells << "\t"
       << vind_size_total + n_cells
-      << std::endl;
+      << "\n";
 
-  for (const auto & cell : cells)
+  if (binary)
   {
-    out << cell.size() << "\t";
-    for (std::size_t i : cell)
-      out << i << "\t";
-    out << std::endl;
+    std::vector<int32_t> connectivity;
+    connectivity.reserve(vind_size_total + n_cells);
+    for (const auto & cell : cells)
+    {
+      connectivity.push_back(static_cast<int32_t>(cell.size()));
+      for (std::size_t i : cell)
+        connectivity.push_back(static_cast<int32_t>(i));
+    }
+    write_big_endian<int32_t>(connectivity, out);
+    out << "\n";
   }
+  else
+    for (const auto & cell : cells)
+    {
+      out << cell.size() << "\t";
+      for (std::size_t i : cell)
+        out << i << "\t";
+      out << "\n";
+    }
+}
 
-  out << std::endl;
-  out << "CELL_TYPES" << "\t" << n_cells << std::endl;
-  for (const auto & cell : cells)
+
+void VTKWriter::write_cell_types(const std::vector<int> & vtk_indices,
+                                 std::ofstream & out, const bool binary)
+{
+  out << "CELL_TYPES" << "\t" << vtk_indices.size() << "\n";
+  if (binary)
   {
-    if (cell.size() == 4)  // quad
-      out << 9 << std::endl;
-    else if (cell.size() == 3)  // triangle
-      out << 5 << std::endl;
-    else
-      out << 7 << std::endl;
-    // else if (cell.size() == 5 || cell.size() == 6)  // polygon
-    //   out << 7 << std::endl;
-    // else
-    // {
-    //   std::cout << "unknown cell type : " << cell.size() << " vertices" << std::endl;
-    //   exit(-1);
-    // }
+    write_big_endian<int32_t>(vtk_indices, out);
+    out << "\n";
   }
+  else
+    for (const auto & id : vtk_indices)
+      out << id << "\n";
+}
+
 
+// edfm
+void VTKWriter::write_surface_geometry(const std::vector<Point>    & vertices,
+                                       const std::vector<std::vector<std::size_t>> & cells,
+                                       std::ofstream               & out,
+                                       const bool                    binary)
+{
+  write_header("3D Fractures", out, binary);
+  write_points(vertices, out, binary);
+  write_cells(cells, out, binary);
+  out << "\n";
+
+  std::vector<int> vtk_indices(cells.size());
+  for (std::size_t i = 0; i < cells.size(); ++i)
+  {
+    if (cells[i].size() == 4)  // quad
+      vtk_indices[i] = 9;
+    else if (cells[i].size() == 3)  // triangle
+      vtk_indices[i] = 5;
+    else  // polygon
+      vtk_indices[i] = 7;
+  }
+  write_cell_types(vtk_indices, out, binary);
 }
 
 
 void VTKWriter::
 write_surface_geometry(const std::vector<Point>                    & vertices,
                        const std::vector<std::vector<std::size_t>> & cells,
-                       const std::string                           & fname)
+                       const std::string                           & fname,
+                       const bool                                    binary)
 {
   std::ofstream out;
-  out.open(fname.c_str());
-  write_surface_geometry(vertices, cells, out);
+  out.open(fname.c_str(), binary ? std::ios::binary : std::ios::out);
+  write_surface_geometry(vertices, cells, out, binary);
   out.close();
 }
 
@@ -180,47 +232,14 @@ void VTKWriter::write_geometry(const std::vector<Point>    & vertices,
 void VTKWriter::write_geometry(const std::vector<Point>                    & vertices,
                                const std::vector<std::vector<std::size_t>> & cells,
                                const std::vector<int>                      & vtk_indices,
-                               std::ofstream                               & out)
+                               std::ofstream                               & out,
+                               const bool                                    binary)
 {
-  out << "# vtk DataFile Version 2.0 \n";
-  out << "3D Fractures \n";
-  out << "ASCII \n \n";
-  out << "DATASET UNSTRUCTURED_GRID \n";
-
-  // points
-  const std::size_t n_points = vertices.size();
-  out << "POINTS" << "\t"
-      << n_points << " float"
-      << std::endl;
-
-  for (const auto & p : vertices)
-    out << p << std::endl;
-
-  // cells
-  const std::size_t n_cells = cells.size();
-  std::size_t vind_size_total = 0;
-  for (const auto & cell : cells)
-    vind_size_total += cell.size();
-
-  out << "CELLS" << "\t"
-      << n_cells << "\t"
-      << vind_size_total + n_cells
-      << std::endl;
-
-  for (const auto & cell : cells)
-  {
-    out << cell.size() << "\t";
-    for (std::size_t i : cell)
-      out << i << "\t";
-    out << std::endl;
-  }
-
-  out << std::endl;
-  out << "CELL_TYPES" << "\t" << n_cells << std::endl;
-  for (const auto & id : vtk_indices)
-  {
-    out << id << std::endl;
-  }
+  write_header("3D Fractures", out, binary);
+  write_points(vertices, out, binary);
+  write_cells(cells, out, binary);
+  out << "\n";
+  write_cell_types(vtk_indices, out, binary);
 }
 
 
@@ -228,11 +247,12 @@ void VTKWriter::write_geometry(const std::vector<Point>                    & ver
 void VTKWriter::write_geometry(const std::vector<Point>                    & vertices,
                                const std::vector<std::vector<std::size_t>> & cells,
                                const std::vector<int>                      & vtk_indices,
-                               const std::string                           & fname)
+                               const std::string                           & fname,
+                               const bool                                    binary)
 {
   std::ofstream out;
-  out.open(fname.c_str());
-  write_geometry(vertices, cells, vtk_indices, out);
+  out.open(fname.c_str(), binary ? std::ios::binary : std::ios::out);
+  write_geometry(vertices, cells, vtk_indices, out, binary);
   out.close();
 }
 
@@ -240,32 +260,29 @@ void VTKWriter::write_geometry(const std::vector<Point>                    & ver
 // this function is used to write line segments to show wells in paraview
 void VTKWriter::write_well_trajectory(const std::vector<Point>                              & vertices,
                                       const std::vector<std::pair<std::size_t,std::size_t>> & indices,
-                                      const std::string                                     & fname)
+                                      std::ofstream                                         & out,
+                                      const bool                                              binary)
 {
-  std::ofstream out;
-  out.open(fname.c_str());
-
-  out << "# vtk DataFile Version 2.0 \n";
-  out << "Wells \n";
-  out << "ASCII \n \n";
-  out << "DATASET UNSTRUCTURED_GRID \n";
+  write_header("Wells", out, binary);
+  write_points(vertices, out, binary);
 
-  // points
-  const std::size_t n_points = vertices.size();
-  out << "POINTS" << "\t" << n_points << " float" << std::endl;
-  for (const auto & p : vertices)
-    out << p << std::endl;
+  std::vector<std::vector<std::size_t>> segments(indices.size());
+  for (std::size_t i=0; i<indices.size(); ++i)
+    segments[i] = {indices[i].first, indices[i].second};
+  write_cells(segments, out, binary);
 
-  // 3 because n_cells + 2 points per cell
-  out << "CELLS" << "\t" << indices.size() << "\t" << 3*indices.size() << std::endl;
+  write_cell_types(std::vector<int>(indices.size(), 3), out, binary);
+}
 
-  for (const auto & segment : indices)
-    out << 2 << "\t" << segment.first << "\t" << segment.second << std::endl;
-
-  out << "CELL_TYPES" << "\t" << indices.size() << std::endl;
-  for (std::size_t i=0; i<indices.size(); ++i)
-    out << 3 << std::endl;
 
+void VTKWriter::write_well_trajectory(const std::vector<Point>                              & vertices,
+                                      const std::vector<std::pair<std::size_t,std::size_t>> & indices,
+                                      const std::string                                     & fname,
+                                      const bool                                              binary)
+{
+  std::ofstream out;
+  out.open(fname.c_str(), binary ? std::ios::binary : std::ios::out);
+  write_well_trajectory(vertices, indices, out, binary);
   out.close();
 }
 
@@ -273,14 +290,14 @@ void VTKWriter::write_well_trajectory(const std::vector<Point>
 void VTKWriter::enter_section_cell_data(const std::size_t n_cells,
                                         std::ofstream & out)
 {
-  out << "CELL_DATA" << "\t" << n_cells << std::endl;
+  out << "CELL_DATA" << "\t" << n_cells << "\n";
 }
 
 
 void VTKWriter::enter_section_point_data(const std::size_t n_vertices,
                                          std::ofstream & out)
 {
-  out << "POINT_DATA" << "\t" << n_vertices << std::endl;
+  out << "POINT_DATA" << "\t" << n_vertices << "\n";
 }
 
 }  // end namespace
@@ -3,6 +3,10 @@
 #include <GElement.hpp>
 #include "angem/Point.hpp"
 #include <fstream>
+#include <cstdint>  // int32_t
+#include <cstring>  // memcpy
+#include <algorithm>  // std::min, std::swap
+#include <vector>
 
 using Point = angem::Point<3,double>;
 
@@ -15,21 +19,25 @@ class VTKWriter
   // for fractures
   static void write_surface_geometry(const std::vector<Point>                    & vertices,
                                      const std::vector<std::vector<std::size_t>> & cells,
-                                     const std::string                           & fname);
+                                     const std::string                           & fname,
+                                     const bool                                    binary = false);
   // for fractures
   static void write_surface_geometry(const std::vector<Point>                    & vertices,
                                      const std::vector<std::vector<std::size_t>> & cells,
-                                     std::ofstream                               & out);
+                                     std::ofstream                               & out,
+                                     const bool                                    binary = false);
 
   static void write_geometry(const std::vector<Point>                    & vertices,
                         const std::vector<std::vector<std::size_t>> & cells,
                         const std::vector<int>                      & vtk_indices,
-                        const std::string                           & fname);
+                        const std::string                           & fname,
+                        const bool                                    binary = false);
 
   static void write_geometry(const std::vector<Point>                    & vertices,
                         const std::vector<std::vector<std::size_t>> & cells,
                         const std::vector<int>                      & vtk_indices,
-                        std::ofstream                               & out);
+                        std::ofstream                               & out,
+                        const bool                                    binary = false);
 
   // wicked old timur's Gelement format for reservoir
   static void write_geometry(const std::vector<Point>    & vertices,
@@ -42,12 +50,20 @@ class VTKWriter
 
   static void write_well_trajectory(const std::vector<Point>                              & vertices,
                                     const std::vector<std::pair<std::size_t,std::size_t>> & indices,
-                                    const std::string                                     & fname);
+                                    const std::string                                     & fname,
+                                    const bool                                              binary = false);
+
+  static void write_well_trajectory(const std::vector<Point>                              & vertices,
+                                    const std::vector<std::pair<std::size_t,std::size_t>> & indices,
+                                    std::ofstream                                         & out,
+                                    const bool                                              binary = false);
   // add cell data to vtk file
+  // binary: legacy binary format (big-endian), must match the geometry
   template <typename T>
   static void add_data(const std::vector<T> & property,
                        const std::string           keyword,
-                       std::ofstream             & out);
+                       std::ofstream             & out,
+                       const bool                  binary = false);
 
   static void enter_section_cell_data(const std::size_t n_cells,
                                       std::ofstream & out);
@@ -56,20 +72,64 @@ class VTKWriter
 
  private:
   VTKWriter();
+  // write header lines of a legacy file
+  static void write_header(const std::string & title, std::ofstream & out, const bool binary);
+  // write points section of a legacy file
+  static void write_points(const std::vector<Point> & vertices, std::ofstream & out, const bool binary);
+  // write cells with vertex indices of a legacy file
+  static void write_cells(const std::vector<std::vector<std::size_t>> & cells,
+                          std::ofstream & out, const bool binary);
+  // write cell types of a legacy file
+  static void write_cell_types(const std::vector<int> & vtk_indices,
+                               std::ofstream & out, const bool binary);
+ public:
+  // write values as big-endian binary numbers of type Out (legacy binary vtk)
+  template <typename Out, typename T>
+  static void write_big_endian(const std::vector<T> & values, std::ofstream & out);
 };
 
 // add cell data to vtk file
 template <typename T>
 void VTKWriter::add_data(const std::vector<T> &     property,
                          const std::string          keyword,
-                         std::ofstream            & out)
+                         std::ofstream            & out,
+                         const bool                 binary)
 {
   out << "SCALARS\t" << keyword << "\t";
-  out << "float" << std::endl;
-  out << "LOOKUP_TABLE HSV" << std::endl;
-  for (const double item : property)
-    out << static_cast<double>(item)<< std::endl;
-  out << std::endl;
+  out << "float" << "\n";
+  out << "LOOKUP_TABLE HSV" << "\n";
+  if (binary)
+    write_big_endian<float>(property, out);
+  else
+    for (const double item : property)
+      out << static_cast<double>(item)<< "\n";
+  out << "\n";
+}
+
+
+template <typename Out, typename T>
+void VTKWriter::write_big_endian(const std::vector<T> & values, std::ofstream & out)
+{
+  const uint16_t one = 1;
+  const bool swap = *reinterpret_cast<const char*>(&one) == 1;  // little-endian host
+
+  // convert in batches to avoid a full copy of large arrays
+  const std::size_t batch = 1 << 16;
+  std::vector<char> buffer(std::min(batch, values.size()) * sizeof(Out));
+  for (std::size_t first = 0; first < values.size(); first += batch)
+  {
+    const std::size_t last = std::min(values.size(), first + batch);
+    char * dst = buffer.data();
+    for (std::size_t i = first; i < last; ++i, dst += sizeof(Out))
+    {
+      const Out value = static_cast<Out>(values[i]);
+      std::memcpy(dst, &value, sizeof(Out));
+      if (swap)
+        for (std::size_t b = 0; b < sizeof(Out) / 2; ++b)
+          std::swap(dst[b], dst[sizeof(Out) - 1 - b]);
+    }
+    out.write(buffer.data(), (last - first) * sizeof(Out));
+  }
 }
 
 }  // end namespace
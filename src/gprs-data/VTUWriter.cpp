@@ -0,0 +1,223 @@
+#include "VTUWriter.hpp"
+
+#include <stdexcept>  // std::invalid_argument
+
+#ifdef WITH_ZLIB
+#include <zlib.h>
+#endif
+
+namespace IO
+{
+
+// uncompressed size of a compressed block
+static const std::size_t compression_block_size = 1 << 20;
+
+
+VTUWriter::VTUWriter(const std::string & fname, const bool compress)
+    :
+    fname(fname),
+    compress(compress)
+{
+#ifndef WITH_ZLIB
+  if (compress)
+    throw std::invalid_argument("vtu compression requires zlib");
+#endif
+}
+
+
+VTUWriter::~VTUWriter()
+{
+  if (!closed)
+    close();
+}
+
+
+void VTUWriter::write_geometry(const std::vector<angem::Point<3,double>>  & vertices,
+                               const std::vector<std::vector<std::size_t>> & cell_vertices,
+                               const std::vector<int>                      & vtk_indices)
+{
+  n_points = vertices.size();
+  n_cells = cell_vertices.size();
+
+  std::vector<double> coord(3 * n_points);
+  for (std::size_t i = 0; i < n_points; ++i)
+    for (int j = 0; j < 3; ++j)
+      coord[3*i + j] = vertices[i][j];
+  points.push_back(make_array<double>("Points", "Float64", coord, 3));
+
+  std::vector<int64_t> connectivity, offsets;
+  offsets.reserve(n_cells);
+  for (const auto & cell : cell_vertices)
+  {
+    for (const std::size_t v : cell)
+      connectivity.push_back(v);
+    offsets.push_back(connectivity.size());
+  }
+  cells.push_back(make_array<int64_t>("connectivity", "Int64", connectivity));
+  cells.push_back(make_array<int64_t>("offsets", "Int64", offsets));
+  cells.push_back(make_array<uint8_t>("types", "UInt8", vtk_indices));
+}
+
+
+void VTUWriter::write_surface_geometry(const std::vector<angem::Point<3,double>>  & vertices,
+                                       const std::vector<std::vector<std::size_t>> & cell_vertices)
+{
+  std::vector<int> vtk_indices(cell_vertices.size());
+  for (std::size_t i = 0; i < cell_vertices.size(); ++i)
+  {
+    if (cell_vertices[i].size() == 4)  // quad
+      vtk_indices[i] = 9;
+    else if (cell_vertices[i].size() == 3)  // triangle
+      vtk_indices[i] = 5;
+    else  // polygon
+      vtk_indices[i] = 7;
+  }
+  write_geometry(vertices, cell_vertices, vtk_indices);
+}
+
+
+void VTUWriter::write_well_trajectory(const std::vector<angem::Point<3,double>>               & vertices,
+                                      const std::vector<std::pair<std::size_t,std::size_t>> & indices)
+{
+  std::vector<std::vector<std::size_t>> segments(indices.size());
+  for (std::size_t i=0; i<indices.size(); ++i)
+    segments[i] = {indices[i].first, indices[i].second};
+  write_geometry(vertices, segments, std::vector<int>(indices.size(), 3));
+}
+
+
+void VTUWriter::enter_section_cell_data(const std::size_t)
+{
+  current_section = &cell_data;
+}
+
+
+void VTUWriter::enter_section_point_data(const std::size_t)
+{
+  current_section = &point_data;
+}
+
+
+std::vector<char> VTUWriter::encode(const std::vector<char> & raw) const
+{
+  std::vector<char> block;
+  if (!compress)
+  {
+    // header: number of bytes
+    const uint64_t n_bytes = raw.size();
+    block.resize(sizeof(uint64_t) + raw.size());
+    std::memcpy(block.data(), &n_bytes, sizeof(uint64_t));
+    std::memcpy(block.data() + sizeof(uint64_t), raw.data(), raw.size());
+    return block;
+  }
+
+#ifdef WITH_ZLIB
+  // header: n_blocks, block size, last block size, compressed size of each block
+  const uint64_t n_blocks = (raw.size() + compression_block_size - 1) / compression_block_size;
+  const uint64_t last_size = (n_blocks == 0) ? 0 : raw.size() - (n_blocks - 1) * compression_block_size;
+  std::vector<uint64_t> header = {n_blocks, compression_block_size, last_size};
+  std::vector<char> compressed;
+  for (uint64_t b = 0; b < n_blocks; ++b)
+  {
+    const uLong src_size = (b == n_blocks - 1) ? last_size : compression_block_size;
+    uLongf dst_size = compressBound(src_size);
+    const std::size_t start = compressed.size();
+    compressed.resize(start + dst_size);
+    compress2(reinterpret_cast<Bytef*>(compressed.data() + start), &dst_size,
+              reinterpret_cast<const Bytef*>(raw.data() + b * compression_block_size),
+              src_size, Z_DEFAULT_COMPRESSION);
+    compressed.resize(start + dst_size);
+    header.push_back(dst_size);
+  }
+
+  block.resize(header.size() * sizeof(uint64_t) + compressed.size());
+  std::memcpy(block.data(), header.data(), header.size() * sizeof(uint64_t));
+  std::memcpy(block.data() + header.size() * sizeof(uint64_t), compressed.data(), compressed.size());
+#endif
+  return block;
+}
+
+
+void VTUWriter::write_array_headers(const std::vector<DataArray> & arrays,
+                                    std::size_t & offset, std::ofstream & out) const
+{
+  for (const auto & array : arrays)
+  {
+    out << "        <DataArray type=\"" << array.type << "\" Name=\"" << array.name << "\"";
+    if (array.n_components > 1)
+      out << " NumberOfComponents=\"" << array.n_components << "\"";
+    out << " format=\"appended\" offset=\"" << offset << "\"/>\n";
+    offset += array.data.size();
+  }
+}
+
+
+void VTUWriter::close()
+{
+  closed = true;
+  std::ofstream out(fname.c_str(), std::ios::binary);
+
+  const uint16_t one = 1;
+  const bool little_endian = *reinterpret_cast<const char*>(&one) == 1;
+
+  out << "<?xml version=\"1.0\"?>\n";
+  out << "<VTKFile type=\"UnstructuredGrid\" version=\"1.0\" byte_order=\""
+      << (little_endian ? "LittleEndian" : "BigEndian") << "\" header_type=\"UInt64\"";
+  if (compress)
+    out << " compressor=\"vtkZLibDataCompressor\"";
+  out << ">\n";
+  out << "  <UnstructuredGrid>\n";
+  out << "    <Piece NumberOfPoints=\"" << n_points << "\" NumberOfCells=\"" << n_cells << "\">\n";
+
+  std::size_t offset = 0;
+  out << "      <PointData>\n";
+  write_array_headers(point_data, offset, out);
+  out << "      </PointData>\n";
+  out << "      <CellData>\n";
+  write_array_headers(cell_data, offset, out);
+  out << "      </CellData>\n";
+  out << "      <Points>\n";
+  write_array_headers(points, offset, out);
+  out << "      </Points>\n";
+  out << "      <Cells>\n";
+  write_array_headers(cells, offset, out);
+  out << "      </Cells>\n";
+  out << "    </Piece>\n";
+  out << "  </UnstructuredGrid>\n";
+
+  out << "  <AppendedData encoding=\"raw\">\n   _";
+  for (const auto * section : {&point_data, &cell_data, &points, &cells})
+    for (const auto & array : *section)
+      out.write(array.data.data(), array.data.size());
+  out << "\n  </AppendedData>\n";
+  out << "</VTKFile>\n";
+  out.close();
+}
+
+void VTUWriter::write_pvtu(const std::string              & fname,
+                           const std::vector<std::string> & pieces,
+                           const std::vector<std::string> & cell_keywords)
+{
+  std::ofstream out(fname.c_str());
+  const uint16_t one = 1;
+  const bool little_endian = *reinterpret_cast<const char*>(&one) == 1;
+
+  out << "<?xml version=\"1.0\"?>\n";
+  out << "<VTKFile type=\"PUnstructuredGrid\" version=\"1.0\" byte_order=\""
+      << (little_endian ? "LittleEndian" : "BigEndian") << "\" header_type=\"UInt64\">\n";
+  out << "  <PUnstructuredGrid GhostLevel=\"0\">\n";
+  out << "    <PCellData>\n";
+  for (const auto & keyword : cell_keywords)
+    out << "      <PDataArray type=\"Float64\" Name=\"" << keyword << "\"/>\n";
+  out << "    </PCellData>\n";
+  out << "    <PPoints>\n";
+  out << "      <PDataArray type=\"Float64\" NumberOfComponents=\"3\"/>\n";
+  out << "    </PPoints>\n";
+  for (const auto & piece : pieces)
+    out << "    <Piece Source=\"" << piece << "\"/>\n";
+  out << "  </PUnstructuredGrid>\n";
+  out << "</VTKFile>\n";
+  out.close();
+}
+
+}  // end namespace IO
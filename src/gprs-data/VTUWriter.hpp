@@ -0,0 +1,101 @@
+#pragma once
+
+#include "angem/Point.hpp"
+
+#include <cstdint>  // int64_t, uint8_t
+#include <cstring>  // memcpy
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace IO
+{
+
+/* Writer for the XML unstructured grid format (.vtu).
+ * Data arrays are stored in the appended section as raw binary,
+ * optionally compressed with zlib (requires WITH_ZLIB).
+ * Interface mirrors VTKWriter: write geometry, enter data sections,
+ * add data. The file is written in close() (or in the destructor),
+ * since the xml header needs the sizes of all arrays. */
+class VTUWriter
+{
+ public:
+  // compress: compress data arrays with zlib
+  VTUWriter(const std::string & fname, const bool compress = false);
+  // writes the file if close() has not been called
+  ~VTUWriter();
+  // volumetric grid (vtk_indices are vtk cell types)
+  void write_geometry(const std::vector<angem::Point<3,double>>  & vertices,
+                      const std::vector<std::vector<std::size_t>> & cells,
+                      const std::vector<int>                      & vtk_indices);
+  // for fractures (cell types deduced from the number of vertices)
+  void write_surface_geometry(const std::vector<angem::Point<3,double>>  & vertices,
+                              const std::vector<std::vector<std::size_t>> & cells);
+  // line segments for wells
+  void write_well_trajectory(const std::vector<angem::Point<3,double>>               & vertices,
+                             const std::vector<std::pair<std::size_t,std::size_t>> & indices);
+  // subsequent add_data calls add cell data
+  void enter_section_cell_data(const std::size_t n_cells);
+  // subsequent add_data calls add point data
+  void enter_section_point_data(const std::size_t n_vertices);
+  // add scalar data to the current section
+  template <typename T>
+  void add_data(const std::vector<T> & property,
+                const std::string    & keyword);
+  // write the file
+  void close();
+  // write a .pvtu index that ties together pieces (paths relative to the index)
+  // cell_keywords: names of cell data arrays (Float64) in every piece
+  static void write_pvtu(const std::string              & fname,
+                         const std::vector<std::string> & pieces,
+                         const std::vector<std::string> & cell_keywords);
+
+ private:
+  struct DataArray
+  {
+    std::string name;
+    std::string type;
+    int n_components;
+    std::vector<char> data;  // encoded block (with the size header)
+  };
+
+  // convert values to Out and encode them (raw or compressed)
+  template <typename Out, typename T>
+  DataArray make_array(const std::string & name, const std::string & type,
+                       const std::vector<T> & values, const int n_components = 1) const;
+  // add size header and compress if necessary
+  std::vector<char> encode(const std::vector<char> & raw) const;
+  void write_array_headers(const std::vector<DataArray> & arrays,
+                           std::size_t & offset, std::ofstream & out) const;
+
+  std::string fname;
+  bool compress;
+  bool closed = false;
+  std::size_t n_points = 0, n_cells = 0;
+  std::vector<DataArray> points, cells, point_data, cell_data;
+  std::vector<DataArray> * current_section = &cell_data;
+};
+
+
+template <typename T>
+void VTUWriter::add_data(const std::vector<T> & property,
+                         const std::string    & keyword)
+{
+  current_section->push_back(make_array<double>(keyword, "Float64", property));
+}
+
+
+template <typename Out, typename T>
+VTUWriter::DataArray VTUWriter::make_array(const std::string & name, const std::string & type,
+                                           const std::vector<T> & values, const int n_components) const
+{
+  std::vector<char> raw(values.size() * sizeof(Out));
+  for (std::size_t i = 0; i < values.size(); ++i)
+  {
+    const Out value = static_cast<Out>(values[i]);
+    std::memcpy(raw.data() + i * sizeof(Out), &value, sizeof(Out));
+  }
+  return {name, type, n_components, encode(raw)};
+}
+
+}  // end namespace IO
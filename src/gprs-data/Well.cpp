@@ -5,6 +5,7 @@ Well::Well(const WellConfig & config)
     :
     name(config.name),
     radius(config.radius),
+    skin(config.skin),
     perforated(config.perforated)
 {
   assert(!config.coordinates.empty());
@@ -12,6 +12,8 @@
  * There are two types of wells: simple and complex
  * Simple wells are vertical and only have (x, y) coordinates
  * Complex wells are defined with pairs of (x, y, z) segments
+ * Complex wells are also multi-segment wells: the trajectory is split
+ * into well segments by the cells it crosses (see ms_* members)
   */
 class Well
 {
@@ -25,6 +27,7 @@ class Well
   std::vector<bool> perforated;
   angem::Point<3,double> coordinate;
   double radius, reference_depth;
+  double skin;
   std::string name;
   bool reference_depth_set = false;
 
@@ -36,4 +39,19 @@ class Well
   std::vector<angem::Point<3,double>> directions;
   // productivity at each intersection
   std::vector<double> indices;
+
+  // multi-segment data (complex wells)
+  // cell intersections ordered along the trajectory from the first node;
+  // non-perforated intersections are segments without connected volumes
+  std::vector<std::size_t> ms_volumes;  // flow volume crossed by each segment
+  // distance along the trajectory to the segment start and end
+  std::vector<double> ms_start, ms_end;
+  std::vector<angem::Point<3,double>> ms_nodes;  // segment end points
+  angem::Point<3,double> ms_top;  // trajectory point at ms_start[0] (top node)
+  std::vector<bool> ms_perforated;
+  // branch of each segment (from 1): the trajectory parts between gaps,
+  // where it leaves the domain, are separate branches
+  std::vector<std::size_t> ms_branch;
+  // connections between segments (segment, outlet segment); none across gaps
+  std::vector<std::pair<std::size_t,std::size_t>> ms_connections;
 };
@@ -52,9 +52,9 @@ void renum::convert(const int nc, const int nv, const vector<int>& ia, const vec
 		//find first non-enumerated vertex
 		for(int k = 0; k < nv && cur == -1; ++k)
 			if( rcm[k] == -1 ) cur = k;
-		//find vertex with smallest order
+		//find non-enumerated vertex with smallest order
 		for(int k = cur; k < nv; ++k)
-			if( order[k] < order[cur] ) cur = k;
+			if( rcm[k] == -1 && order[k] < order[cur] ) cur = k;
 		assert(cur != -1); //just in case
 		//initialize queue
 		std::deque<int> q;
@@ -91,53 +91,6 @@ void renum::convert(const int nc, const int nv, const vector<int>& ia, const vec
 	//reverse enumeration
 	for(int k = 0; k < nv; ++k)
 		rcm[k] = nv - rcm[k] - 1;	
-	//write order info
-	FILE * fout = fopen("rcm.txt","w");
-	for(int k = 0; k < nv; ++k)
-		fprintf(fout,"%d %d\n",k, rcm[k]);
-	fclose(fout);
-	//write matrix in mtx format
-	{
-		FILE * mtx = fopen("matrix.mtx","w");
-		fprintf(mtx,"%%MatrixMarket matrix coordinate real general\n");
-		fprintf(mtx,"%d %d %d",nv,nv,ia[nc]-ia[0]);
-		std::vector<int> conns;
-		for(int k = 0; k < nv; ++k) //go over nodes
-		{
-			for(int j = v_ia[k]; j < v_ia[k+1]; ++j) //nodes to cells
-				for(int l = ia[v_ja[j]]; l < ia[v_ja[j]+1]; ++l) //cells to nodes
-					conns.push_back(ja[l]);
-			//connections may be not unique
-			std::sort(conns.begin(),conns.end());
-			conns.resize(std::unique(conns.begin(),conns.end())-conns.begin());
-			//write connections
-			for(int j = 0; j < (int)conns.size(); ++j)
-				fprintf(mtx,"%d %d 1.0\n",rcm[k],rcm[conns[j]]);
-			conns.clear();
-		}
-		fclose(mtx);
-	}
-	//write matrix in mtx format
-	{
-		FILE * mtx = fopen("original_matrix.mtx","w");
-		fprintf(mtx,"%%MatrixMarket matrix coordinate real general\n");
-		fprintf(mtx,"%d %d %d",nv,nv,ia[nc]-ia[0]);
-		std::vector<int> conns;
-		for(int k = 0; k < nv; ++k) //go over nodes
-		{
-			for(int j = v_ia[k]; j < v_ia[k+1]; ++j) //nodes to cells
-				for(int l = ia[v_ja[j]]; l < ia[v_ja[j]+1]; ++l) //cells to nodes
-					conns.push_back(ja[l]);
-			//connections may be not unique
-			std::sort(conns.begin(),conns.end());
-			conns.resize(std::unique(conns.begin(),conns.end())-conns.begin());
-			//write connections
-			for(int j = 0; j < (int)conns.size(); ++j)
-				fprintf(mtx,"%d %d 1.0\n",k,conns[j]);
-			conns.clear();
-		}
-		fclose(mtx);
-	}
 	delete [] order;
 	delete [] v_ia;
 	delete [] v_ja;
@@ -11,13 +11,25 @@
 #include "mesh/utils.hpp" // to remesh embedded fractures
 #include "mesh/Mesh.hpp" // 3D mesh format
 // parser for user-defined expressions for reservoir data
-#include "muparser/muParser.h"
 #include "MultiScaleDataMSRSB.hpp"
 #include "MultiScaleDataMech.hpp"
+#include "PropertyProgram.hpp"
+#include "PropertyFiles.hpp"
+#include "ConnectionSpool.hpp"
+#include "parallel/parallel_for.hpp"
+#include "parallel/PerThread.hpp"
 
 #include <algorithm>
+#include <array>
+#include <cmath>       // std::floor
 #include <exception>
+#include <functional>  // std::greater
+#include <limits>      // std::numeric_limits
+#include <memory>      // std::shared_ptr
+#include <queue>       // std::priority_queue
+#include <stdexcept>   // std::logic_error
 #include <unordered_set>
+#include <sys/stat.h>  // stat
 
 using Point = angem::Point<3, double>;
 const int MARKER_BELOW_FRAC = 0;
@@ -30,10 +42,20 @@ namespace gprs_data
 SimData::SimData(mesh::Mesh & grid, const SimdataConfig & config)
     :
     grid(grid),
-    config(config)
+    config(config),
+    stage_cache(config.stage_cache_dir, config.stage_cache_max_bytes,
+                config.shared_stage_results)
 {
   // Kirill's renumbering
   // pRenum = new renum();
+
+  for (std::size_t i = 0; i < config.bc_faces.size(); ++i)
+    bc_face_table.insert(config.bc_faces[i].label, static_cast<int>(i));
+  for (std::size_t i = 0; i < config.discrete_fractures.size(); ++i)
+    dfm_face_table.insert(config.discrete_fractures[i].label, static_cast<int>(i));
+  for (std::size_t i = 0; i < config.domains.size(); ++i)
+    if (config.domains[i].coupled)
+      coupled_domain_table.insert(config.domains[i].label, static_cast<int>(i));
 }
 
 SimData::~SimData()
@@ -41,11 +63,42 @@ SimData::~SimData()
 }
 
 
+// whether boxes [lo1, hi1] and [lo2, hi2] overlap (touching within tol counts)
+inline bool boxes_overlap(const angem::Point<3,double> & lo1, const angem::Point<3,double> & hi1,
+                          const angem::Point<3,double> & lo2, const angem::Point<3,double> & hi2,
+                          const double tol)
+{
+  for (int i = 0; i < 3; ++i)
+    if (lo1[i] > hi2[i] + tol || lo2[i] > hi1[i] + tol)
+      return false;
+  return true;
+}
+
+
+// bounding box of a set of points
+inline void bounding_box(const std::vector<angem::Point<3,double>> & points,
+                         angem::Point<3,double> & lo, angem::Point<3,double> & hi)
+{
+  lo = points[0];
+  hi = points[0];
+  for (const auto & p : points)
+    for (int i = 0; i < 3; ++i)
+    {
+      lo[i] = std::min(lo[i], p[i]);
+      hi[i] = std::max(hi[i], p[i]);
+    }
+}
+
+
 void SimData::defineEmbeddedFractureProperties()
 {
   std::size_t ef_ind = 0;
   // class that checks if shapes collide
   angem::CollisionGJK<double> collision;
+  // cells that cannot touch a fracture are rejected with their cached
+  // bounding boxes and vertex-plane distances, without building polyhedra
+  const mesh::CellGeometryCache cell_geometry(grid);
+  const auto & vertices = grid.get_vertices();
   // non-const since fracture is adjusted to avoid collision with vertices
   for (auto & frac_conf : config.fractures)
   {
@@ -57,8 +110,27 @@ void SimData::defineEmbeddedFractureProperties()
  redo_collision:
     // find cells intersected by the fracture
     frac.cells.clear();
+    Point frac_min, frac_max;
+    bounding_box(frac_conf.body->get_points(), frac_min, frac_max);
+    const auto & frac_plane = frac_conf.body->plane();
     for (auto cell = grid.begin_cells(); cell != grid.end_cells(); ++cell)
     {
+      const std::size_t icell = cell.index();
+      const double cell_size = (cell_geometry.bbox_max(icell) - cell_geometry.bbox_min(icell)).norm();
+      if (!boxes_overlap(cell_geometry.bbox_min(icell), cell_geometry.bbox_max(icell),
+                         frac_min, frac_max, 1e-6 * cell_size))
+        continue;
+      // the fracture plane must pass between (or through) cell vertices
+      bool above = false, below = false;
+      for (const std::size_t v : grid.cells[icell])
+      {
+        const double d = frac_plane.signed_distance(vertices[v]);
+        if (d >= -1e-6 * cell_size) above = true;
+        if (d <= 1e-6 * cell_size) below = true;
+      }
+      if (!above || !below)
+        continue;
+
       const std::unique_ptr<angem::Polyhedron<double>> p_poly_cell = cell.polyhedron();
       const auto & poly_cell = *p_poly_cell;
 
@@ -154,6 +226,13 @@ void SimData::computeCellClipping()
     vvSection.resize(frac_cells.size());
     std::vector<angem::PolyGroup<double>> splits(frac_cells.size());
 
+    // index of a cell in frac_cells (frac_cells.size() if not crossed)
+    std::vector<std::size_t> local_index(grid.n_cells(), frac_cells.size());
+    for (std::size_t i = 0; i < frac_cells.size(); ++i)
+      local_index[frac_cells[i]] = i;
+    // vector of cells containing efrac and neighboring face (reused for all faces)
+    std::vector<std::size_t> v_neighbors;
+
     /* loop faces:
      * if any neighbor cell is in collision list,
      * determine the intersection points of the face with the fracture plane
@@ -161,11 +240,10 @@ void SimData::computeCellClipping()
      */
     for (auto face = grid.begin_faces(); face != grid.end_faces(); ++face)
     {
-      // vector of cells containing efrac and neighboring face
-      std::vector<std::size_t> v_neighbors;
+      v_neighbors.clear();
       for (const std::size_t & ineighbor : face.neighbors())
       {
-        const std::size_t frac_cell_local_ind = find(ineighbor, frac_cells);
+        const std::size_t frac_cell_local_ind = local_index[ineighbor];
         if (frac_cell_local_ind != frac_cells.size())
           v_neighbors.push_back(frac_cell_local_ind);
       }
@@ -264,51 +342,223 @@ void SimData::computeCellClipping()
 
 void SimData::mergeSmallFracCells()
 {
-  for (std::size_t ifrac=0; ifrac<config.fractures.size(); ++ifrac)
+  // flow indices of fracture elements before any merging:
+  // merged elements are only marked and removed from flow data in the end
+  std::vector<std::size_t> flow_shift(vEfrac.size());
+  for (std::size_t ifrac=0; ifrac<vEfrac.size(); ++ifrac)
+    flow_shift[ifrac] = efrac_flow_index(ifrac, 0);
+  std::vector<bool> deleted_flow_elements(flow_data.cells.size(), false);
+  std::size_t n_merged_total = 0;
+
+  for (std::size_t ifrac=0; ifrac<vEfrac.size(); ++ifrac)
   {
-    auto & msh = vEfrac[ifrac].mesh;
+    auto & efrac = vEfrac[ifrac];
+    auto & msh = efrac.mesh;
+    const std::size_t n_elements = msh.n_polygons();
+    if (n_elements == 0)
+      continue;
 
-    double max_area = 0;
-    for (const auto & element : msh.get_polygons())
+    // element areas are computed once and updated on merges
+    std::vector<double> areas(n_elements);
+    parallel::parallel_for(0, n_elements, [&](const std::size_t ielement)
     {
-      angem::Polygon<double> poly(msh.get_vertices(), element);
-      const double area = poly.area();
-      max_area = std::max(area, max_area);
+      const angem::Polygon<double> poly(msh.get_vertices(),
+                                        msh.get_polygons()[ielement]);
+      areas[ielement] = poly.area();
+    });
+    const double max_area = *std::max_element(areas.begin(), areas.end());
+    const double min_area = config.frac_cell_elinination_factor * max_area;
+
+    // min-heap of small elements (area, element);
+    // entries of merged or grown elements are stale and skipped
+    using HeapEntry = std::pair<double, std::size_t>;
+    std::priority_queue<HeapEntry, std::vector<HeapEntry>, std::greater<HeapEntry>> small_elements;
+    for (std::size_t ielement=0; ielement<n_elements; ++ielement)
+      if (areas[ielement] < min_area)
+        small_elements.push({areas[ielement], ielement});
+
+    std::vector<bool> merged(n_elements, false);
+    std::size_t n_merged = 0;
+    while (!small_elements.empty())
+    {
+      const HeapEntry entry = small_elements.top();
+      small_elements.pop();
+      const std::size_t ielement = entry.second;
+      if (merged[ielement] || entry.first != areas[ielement])
+        continue;
+
+      // merge into the largest neighbor
+      std::size_t target = n_elements;
+      mesh::Edge shared_edge;
+      for (const auto & edge : msh.get_edges(ielement))
+        for (const std::size_t neighbor : msh.get_neighbors(edge))
+          if (neighbor != ielement &&
+              (target == n_elements || areas[neighbor] > areas[target]))
+          {
+            target = neighbor;
+            shared_edge = edge;
+          }
+      if (target == n_elements)  // isolated element
+        continue;
+
+      msh.absorb_element(target, ielement, shared_edge);
+      flow_data.merge_elements(flow_shift[ifrac] + target,
+                               flow_shift[ifrac] + ielement);
+      deleted_flow_elements[flow_shift[ifrac] + ielement] = true;
+      merged[ielement] = true;
+      n_merged++;
+
+      areas[target] += areas[ielement];
+      areas[ielement] = 0;
+      if (areas[target] < min_area)
+        small_elements.push({areas[target], target});
     }
 
-    // merge tiny cells
-    std::size_t ielement = 0;
-    std::size_t n_frac_elements = msh.n_polygons();
+    if (n_merged == 0)
+      continue;
 
-    // loop is with variable upper limit since elements can be
-    // merged and deleted
-    while (ielement < n_frac_elements)
+    // remove merged elements from the fracture data
+    msh.remove_empty_elements();
+    // the per-element arrays must follow the fracture mesh
+    const auto remove_merged = [&merged, n_elements, ifrac](auto & values)
     {
-      angem::Polygon<double> poly(msh.get_vertices(),
-                                  msh.get_polygons()[ielement]);
-      const double area_factor = poly.area() / max_area;
+      if (values.size() != n_elements)
+        throw std::logic_error("embedded fracture " + std::to_string(ifrac) +
+                               " data does not match its mesh");
+      std::size_t n_kept = 0;
+      for (std::size_t ielement=0; ielement<n_elements; ++ielement)
+        if (!merged[ielement])
+          values[n_kept++] = values[ielement];
+      values.resize(n_kept);
+    };
+    remove_merged(efrac.cells);
+    remove_merged(efrac.points);
+    remove_merged(efrac.dip);
+    remove_merged(efrac.strike);
+
+    n_merged_total += n_merged;
+  }
+
+  if (n_merged_total > 0)
+  {
+    flow_data.delete_elements(deleted_flow_elements);
+    std::cout << "merged " << n_merged_total << " small fracture cells" << std::endl;
+  }
+}
+
+
+void SimData::computeReservoirTransmissibilities()
+{
+  // reservoir flow data only depends on the mesh, rock properties and dfm
+  // so it can be reused when only edfm fractures or wells change
+  const std::uint64_t cache_key = reservoir_transes_key();
+  std::vector<flow::CellData> matrix_cells;
+  MatrixConnections matrix_connections;
+  if (load_matrix_flow_data(cache_key, matrix_cells, matrix_connections))
+    std::cout << "loaded reservoir transes from stage cache" << std::endl;
+  else
+  {
+    compute_matrix_flow_data(matrix_cells, matrix_connections);
+    save_matrix_flow_data(cache_key, matrix_cells, matrix_connections);
+  }
 
-      if (area_factor < config.frac_cell_elinination_factor)
+  // copy to global
+  const std::size_t n_volumes = matrix_cells.size();
+  std::cout << "n_volumes = " << n_volumes << std::endl;
+  std::cout << "grid.n_cells() = " << grid.n_cells() << std::endl;
+  flow_data.cells.reserve(n_volumes);
+  for (std::size_t i=0; i<n_volumes; ++i)
+  {
+    auto & cell = flow_data.cells.emplace_back();
+    cell.volume = matrix_cells[i].volume;
+    cell.porosity = matrix_cells[i].porosity;
+    cell.depth = matrix_cells[i].depth;
+  }
+
+  // streaming mode: connections that no later stage modifies are formatted
+  // for output and dropped right away. edfm stages only modify connections
+  // of the cells crossed by embedded fractures; dfm connections are kept too.
+  std::vector<bool> keep_in_memory;
+  if (config.stream_connections)
+  {
+    flow_data.spool = std::make_shared<flow::ConnectionSpool>();
+    keep_in_memory.assign(grid.n_cells(), false);
+    for (const auto & efrac : vEfrac)
+      for (const std::size_t icell : efrac.cells)
+        keep_in_memory[icell] = true;
+  }
+  const auto can_stream = [&](const std::size_t ielement)
+  {
+    return ielement >= n_flow_dfm_faces && !keep_in_memory[ielement - n_flow_dfm_faces];
+  };
+
+  for (const auto & conn : matrix_connections)
+  {
+    const auto & element_pair = conn.first;
+    if (flow_data.spool && can_stream(element_pair.first) && can_stream(element_pair.second))
+    {
+      flow_data.spool->add(element_pair.first, element_pair.second, conn.second);
+      continue;
+    }
+
+    auto & face = flow_data.insert_connection(element_pair.first, element_pair.second);
+    face.transmissibility = conn.second.transmissibility;
+    face.thermal_conductivity = conn.second.thermal_conductivity;
+    face.conType = conn.second.conType;
+    std::size_t face_second_conN = conn.second.conCV.size();
+    face.conCV.resize(face_second_conN);
+    face.conTr.resize(face_second_conN);
+    face.conArea.resize(face_second_conN);
+    face.conPerm.resize(face_second_conN);
+    face.zVolumeFactor.resize(face_second_conN);
+    for(std::size_t m=0; m < face_second_conN; m++){
+        face.conCV[m] = conn.second.conCV[m];
+        face.conTr[m] = conn.second.conTr[m];
+        face.conArea[m] = conn.second.conArea[m];
+        face.conPerm[m] = conn.second.conPerm[m];
+        face.zVolumeFactor[m] = conn.second.zVolumeFactor[m];
+    }
+  }
+  if (flow_data.spool)
+    std::cout << "streamed " << flow_data.spool->size() << " of "
+              << matrix_connections.size() << " reservoir connections" << std::endl;
+  // free the computed connections before the next stages
+  MatrixConnections().swap(matrix_connections);
+
+  // save custom user-defined cell data for flow output
+  const std::size_t n_vars = rockPropNames.size();
+  // save flow variable names
+  flow_data.custom_names.clear();
+  for (std::size_t j=0; j<n_vars; ++j)
+    if (config.expression_type[j] == 0)
+      flow_data.custom_names.push_back(rockPropNames[j]);
+
+  // save values
+  for (auto face = grid.begin_faces(); face != grid.end_faces(); ++face)
+    if (is_fracture(face.marker()))
+      if(dfm_faces.find(face.index())->second.coupled)
       {
-        const std::size_t global_ielement = efrac_flow_index(ifrac, ielement);
-        const std::size_t new_element = msh.merge_element(ielement);
-        // update flow data
-        flow_data.merge_elements(efrac_flow_index(ifrac, new_element),
-                                 global_ielement);
-
-        n_frac_elements = msh.n_polygons();
-        if (ielement >= n_frac_elements)
-          break;
-        continue;
+        const std::size_t icell = face.neighbors()[0];
+        for (std::size_t j=0; j<n_vars; ++j)
+          if (config.expression_type[j] == 0)
+          {
+            const std::size_t ielement = dfm_faces[face.index()].nfluid;
+            flow_data.cells[ielement].custom.push_back(vsCellRockProps[icell].v_props[j]);
+          }
       }
-      ielement++;
-    }
 
+  for (std::size_t i=0; i<grid.n_cells(); ++i)
+  {
+    const std::size_t ielement = n_flow_dfm_faces + i;
+    for (std::size_t j=0; j<n_vars; ++j)
+      if (config.expression_type[j] == 0)
+        flow_data.cells[ielement].custom.push_back( vsCellRockProps[i].v_props[j] );
   }
 }
 
 
-void SimData::computeReservoirTransmissibilities()
+void SimData::compute_matrix_flow_data(std::vector<flow::CellData> & cells,
+                                       MatrixConnections           & connections)
 {
   // init tran
   flow::CalcTranses calc;
@@ -428,69 +678,204 @@ void SimData::computeReservoirTransmissibilities()
   std::cout << "end compute karimi" << std::endl;
   calc.extractData(matrix_flow_data);
 
-  // copy to global
-  const std::size_t n_volumes = matrix_flow_data.cells.size();
-  std::cout << "n_volumes = " << n_volumes << std::endl;
-  std::cout << "grid.n_cells() = " << grid.n_cells() << std::endl;
-  flow_data.cells.reserve(n_volumes);
-  for (std::size_t i=0; i<n_volumes; ++i)
+  // the order of connections defines the order of flow_data
+  cells = std::move(matrix_flow_data.cells);
+  connections.reserve(matrix_flow_data.map_connection.size());
+  for (auto & conn : matrix_flow_data.map_connection)
+    connections.emplace_back(matrix_flow_data.invert_hash(conn.first), std::move(conn.second));
+}
+
+
+std::uint64_t SimData::mesh_hash() const
+{
+  if (grid_hash_computed)
+    return grid_hash;
+
+  Hasher hasher;
+  hasher << grid.get_vertices() << grid.cells << grid.shape_ids << grid.cell_markers;
+  // faces are stored in index order
+  for (const auto & face : grid.faces)
   {
-    auto & cell = flow_data.cells.emplace_back();
-    cell.volume = matrix_flow_data.cells[i].volume;
-    cell.porosity = matrix_flow_data.cells[i].porosity;
-    cell.depth = matrix_flow_data.cells[i].depth;
+    Hasher face_hasher;
+    face_hasher << face.ordered_indices << face.marker << face.neighbors;
+    hasher << face.index << face_hasher.value();
   }
 
-  for (const auto & conn : matrix_flow_data.map_connection)
+  grid_hash = hasher.value();
+  grid_hash_computed = true;
+  return grid_hash;
+}
+
+
+std::uint64_t SimData::rock_properties_key() const
+{
+  Hasher hasher;
+  hasher << std::string("rock properties") << mesh_hash();
+  for (const auto & domain : config.domains)
+    hasher << domain.label << domain.expressions << domain.variables << domain.coupled;
+  hasher << config.all_vars << config.expression_type << config.special_keywords;
+  for (const auto & source : config.property_files)
   {
-    const auto element_pair = matrix_flow_data.invert_hash(conn.first);
-    auto & face = flow_data.insert_connection(element_pair.first, element_pair.second);
-    face.transmissibility = conn.second.transmissibility;
-    face.thermal_conductivity = conn.second.thermal_conductivity;
-    face.conType = conn.second.conType;
-    std::size_t face_second_conN = conn.second.conCV.size();
-    face.conCV.resize(face_second_conN);
-    face.conTr.resize(face_second_conN);
-    face.conArea.resize(face_second_conN);
-    face.conPerm.resize(face_second_conN);
-    face.zVolumeFactor.resize(face_second_conN);
-    for(std::size_t m=0; m < face_second_conN; m++){
-        face.conCV[m] = conn.second.conCV[m];
-        face.conTr[m] = conn.second.conTr[m];
-        face.conArea[m] = conn.second.conArea[m];
-        face.conPerm[m] = conn.second.conPerm[m];
-        face.zVolumeFactor[m] = conn.second.zVolumeFactor[m];
+    hasher << source.name << source.file << static_cast<int>(source.format)
+           << source.dimensions[0] << source.dimensions[1] << source.dimensions[2]
+           << source.origin << source.spacing;
+    // file contents are not hashed: size and modification time tell if it changed
+    struct stat file_stat;
+    if (stat(source.file.c_str(), &file_stat) == 0)
+      hasher << static_cast<std::int64_t>(file_stat.st_size)
+             << static_cast<std::int64_t>(file_stat.st_mtime);
+  }
+  if (!config.property_files.empty())
+    hasher << cell_renumbering;
+  return hasher.value();
+}
+
+
+std::uint64_t SimData::reservoir_transes_key() const
+{
+  Hasher hasher;
+  hasher << std::string("reservoir transes") << rock_properties_key();
+  for (const auto & frac : config.discrete_fractures)
+    hasher << frac.label << frac.conductivity << frac.aperture;
+  hasher << n_flow_dfm_faces;
+  return hasher.value();
+}
+
+
+bool SimData::load_rock_properties(const std::uint64_t key)
+{
+  CacheReader reader;
+  if (!stage_cache.load("rock_properties", key, reader))
+    return false;
+
+  try
+  {
+    std::vector<std::string> names(reader.read<std::size_t>());
+    for (auto & name : names)
+      reader.read(name);
+    std::vector<RockProps> props(reader.read<std::size_t>());
+    for (auto & cell : props)
+      reader.read(cell.v_props);
+    if (!reader.done() || props.size() != grid.n_cells())
+      return false;
+    rockPropNames = std::move(names);
+    vsCellRockProps = std::move(props);
+  }
+  catch (const std::runtime_error &)
+  {
+    return false;
+  }
+  return true;
+}
+
+
+void SimData::save_rock_properties(const std::uint64_t key) const
+{
+  if (!stage_cache.enabled()) return;
+
+  CacheWriter writer;
+  writer.write(rockPropNames.size());
+  for (const auto & name : rockPropNames)
+    writer.write(name);
+  writer.write(vsCellRockProps.size());
+  for (const auto & cell : vsCellRockProps)
+    writer.write(cell.v_props);
+
+  try
+  {
+    stage_cache.save("rock_properties", key, writer);
+  }
+  catch (const std::runtime_error & e)
+  {
+    std::cout << "warning: " << e.what() << std::endl;
+  }
+}
+
+
+bool SimData::load_matrix_flow_data(const std::uint64_t           key,
+                                    std::vector<flow::CellData> & cells,
+                                    MatrixConnections           & connections) const
+{
+  CacheReader reader;
+  if (!stage_cache.load("reservoir_transes", key, reader))
+    return false;
+
+  try
+  {
+    cells.resize(reader.read<std::size_t>());
+    for (auto & cell : cells)
+    {
+      cell.volume = reader.read<double>();
+      cell.porosity = reader.read<double>();
+      cell.depth = reader.read<double>();
+    }
+
+    connections.resize(reader.read<std::size_t>());
+    for (auto & conn : connections)
+    {
+      conn.first.first = reader.read<std::size_t>();
+      conn.first.second = reader.read<std::size_t>();
+      flow::FaceData & face = conn.second;
+      face.transmissibility = reader.read<double>();
+      face.thermal_conductivity = reader.read<double>();
+      face.conType = reader.read<std::size_t>();
+      reader.read(face.conCV);
+      reader.read(face.conTr);
+      reader.read(face.conArea);
+      reader.read(face.zVolumeFactor);
+      reader.read(face.conPerm);
     }
+    if (!reader.done())
+      throw std::runtime_error("corrupt cache");
+  }
+  catch (const std::runtime_error &)
+  {
+    cells.clear();
+    connections.clear();
+    return false;
   }
+  return true;
+}
 
-  // save custom user-defined cell data for flow output
-  const std::size_t n_vars = rockPropNames.size();
-  // save flow variable names
-  flow_data.custom_names.clear();
-  for (std::size_t j=0; j<n_vars; ++j)
-    if (config.expression_type[j] == 0)
-      flow_data.custom_names.push_back(rockPropNames[j]);
 
-  // save values
-  for (auto face = grid.begin_faces(); face != grid.end_faces(); ++face)
-    if (is_fracture(face.marker()))
-      if(dfm_faces.find(face.index())->second.coupled)
-      {
-        const std::size_t icell = face.neighbors()[0];
-        for (std::size_t j=0; j<n_vars; ++j)
-          if (config.expression_type[j] == 0)
-          {
-            const std::size_t ielement = dfm_faces[face.index()].nfluid;
-            flow_data.cells[ielement].custom.push_back(vsCellRockProps[icell].v_props[j]);
-          }
-      }
+void SimData::save_matrix_flow_data(const std::uint64_t                 key,
+                                    const std::vector<flow::CellData> & cells,
+                                    const MatrixConnections           & connections) const
+{
+  if (!stage_cache.enabled()) return;
 
-  for (std::size_t i=0; i<grid.n_cells(); ++i)
+  CacheWriter writer;
+  writer.write(cells.size());
+  for (const auto & cell : cells)
   {
-    const std::size_t ielement = n_flow_dfm_faces + i;
-    for (std::size_t j=0; j<n_vars; ++j)
-      if (config.expression_type[j] == 0)
-        flow_data.cells[ielement].custom.push_back( vsCellRockProps[i].v_props[j] );
+    writer.write(cell.volume);
+    writer.write(cell.porosity);
+    writer.write(cell.depth);
+  }
+
+  writer.write(connections.size());
+  for (const auto & conn : connections)
+  {
+    writer.write(conn.first.first);
+    writer.write(conn.first.second);
+    const flow::FaceData & face = conn.second;
+    writer.write(face.transmissibility);
+    writer.write(face.thermal_conductivity);
+    writer.write(face.conType);
+    writer.write(face.conCV);
+    writer.write(face.conTr);
+    writer.write(face.conArea);
+    writer.write(face.zVolumeFactor);
+    writer.write(face.conPerm);
+  }
+
+  try
+  {
+    stage_cache.save("reservoir_transes", key, writer);
+  }
+  catch (const std::runtime_error & e)
+  {
+    std::cout << "warning: " << e.what() << std::endl;
   }
 }
 
@@ -842,8 +1227,9 @@ apply_projection_edfm(const std::size_t                ifrac,     // embedded fr
 
   for (const auto & face : pedfm_select_faces(cell, split))
   {
+    const Point face_normal = face.geometry().normal();
     // don't connect to cells that are perpendicular to the fracture
-    if (fabs(frac_normal.dot(face.normal())) < 1e-10)
+    if (fabs(frac_normal.dot(face_normal)) < 1e-10)
       continue;
     if (face.neighbors().size() < 2)  // is boundary
         continue;
@@ -857,8 +1243,8 @@ apply_projection_edfm(const std::size_t                ifrac,     // embedded fr
     // modify neighbor map
     const auto neighbor = cell.neighbor_by_face(face);
 
-    const double k_cell_n = fabs(get_permeability(cell.index()) * face.normal());
-    const double k_neighbor_n = fabs(get_permeability(neighbor.index()) * face.normal());
+    const double k_cell_n = fabs(get_permeability(cell.index()) * face_normal);
+    const double k_neighbor_n = fabs(get_permeability(neighbor.index()) * face_normal);
     const double volume_cell = cell.volume();
     const double volume_neighbor = neighbor.volume();
     const double k_face = k_cell_n * k_neighbor_n * (volume_cell + volume_neighbor) /
@@ -994,8 +1380,9 @@ SimData::pedfm_select_faces(const mesh::cell_iterator      & cell,
   for (const auto & face : cell.faces())
   {
     bool any_points_coniside = false;
-    for (const auto & vertex : face.vertices())
-      if (point_set.find(vertex) != point_set.size())
+    const auto face_geometry = face.geometry();
+    for (std::size_t i = 0; i < face_geometry.n_vertices(); ++i)
+      if (point_set.find(face_geometry.vertex(i)) != point_set.size())
         any_points_coniside = true;
     if (any_points_coniside)
       connected_faces.push_back(face);
@@ -1074,6 +1461,13 @@ compute_frac_frac_intersection_transes(const std::vector<angem::Point<3,double>>
 
 void SimData::defineRockProperties()
 {
+  const std::uint64_t cache_key = rock_properties_key();
+  if (load_rock_properties(cache_key))
+  {
+    std::cout << "loaded rock properties from stage cache" << std::endl;
+    return;
+  }
+
   // print header
   std::cout << "function parsers setup" << std::endl;
   std::cout << "Variables:" << std::endl;
@@ -1092,95 +1486,110 @@ void SimData::defineRockProperties()
   vsCellRockProps.resize(grid.n_cells());
 
   const std::size_t n_variables = config.all_vars.size();
-  std::vector<double> vars(n_variables);
 
   // save variables name for output
   rockPropNames.resize(n_variables - shift);
   for (std::size_t i=shift; i<config.all_vars.size(); ++i)
     rockPropNames[i - shift] = config.all_vars[i];
 
-  // loop various domain configs:
-  // they may have different number of variables and expressions
-  for (const auto & conf: config.domains)
+  // expressions of all domains are parsed once
+  const gprs_data::PropertyProgram program(config.domains, config.all_vars);
+  std::cout << "compiled " << program.n_expressions() << " distinct expressions" << std::endl;
+
+  // cells of each domain
+  // (a cell in several domains gets the properties of the last one)
+  std::vector<std::vector<std::size_t>> domain_cells(config.domains.size());
+  std::unordered_map<int, std::vector<std::size_t>> label_domains;
+  for (std::size_t idomain=0; idomain<config.domains.size(); ++idomain)
+    label_domains[config.domains[idomain].label].push_back(idomain);
+  for (auto cell = grid.begin_cells(); cell != grid.end_cells(); ++cell)
   {
-    const std::size_t n_expressions = conf.expressions.size();
-    std::vector<mu::Parser> parsers(n_expressions);
+    const auto it = label_domains.find(cell.marker());
+    if (it != label_domains.end())
+      domain_cells[it->second.back()].push_back(cell.index());
+  }
 
-    // assign expressions and variables
-    for (std::size_t i=0; i<n_expressions; ++i)
+  // evaluate batches of cells in parallel with an evaluator per thread
+  const std::size_t batch_size = 4096;
+  parallel::PerThread<std::shared_ptr<gprs_data::PropertyProgram::Evaluator>> evaluators;
+  for (std::size_t idomain=0; idomain<config.domains.size(); ++idomain)
+  {
+    const auto & cells = domain_cells[idomain];
+    const std::size_t n_batches = (cells.size() + batch_size - 1) / batch_size;
+    parallel::parallel_for(0, n_batches, [&](const std::size_t ibatch)
     {
-      for (std::size_t j=0; j<n_variables; ++j)
-      {
-        try {
-          parsers[i].DefineVar(config.all_vars[j], &vars[j]);
-        }
-        catch(mu::Parser::exception_type & e)
-        {
-          std::cout << _T("Initialization error:  ") << e.GetMsg() << endl;
-          std::cout << "when setting variable '"
-                    << config.all_vars[j]
-                    << "'" << std::endl;
-          exit(-1);
-        }
-      }
-      try {
-        parsers[i].SetExpr(conf.expressions[i]);
-      }
-      catch(mu::Parser::exception_type & e)
+      auto & evaluator = evaluators.local();
+      if (!evaluator)
+        evaluator = std::make_shared<gprs_data::PropertyProgram::Evaluator>(program, batch_size);
+
+      const std::size_t first = ibatch * batch_size;
+      const std::size_t last = std::min(cells.size(), first + batch_size);
+      std::vector<Point> centers;
+      centers.reserve(last - first);
+      for (std::size_t i = first; i < last; ++i)
+        centers.push_back(grid.create_cell_iterator(cells[i]).center());
+
+      evaluator->evaluate(idomain, centers);
+
+      // copy vars to cell properties (skip x,y,z)
+      for (std::size_t i = first; i < last; ++i)
       {
-        std::cout << _T("Initialization error:  ") << e.GetMsg() << endl;
-        std::cout << "when setting expression '"
-                  << conf.expressions[i]
-                  << "'" << std::endl;
-        exit(-1);
+        auto & props = vsCellRockProps[cells[i]].v_props;
+        props.resize(n_variables - shift);
+        for (std::size_t j=shift; j<n_variables; ++j)
+          props[j - shift] = evaluator->value(j, i - first);
       }
-    }
+    }, 0, 1);
+  }  // end domain loop
 
-    // loop cells and evaluate expressions
-    for (auto cell = grid.begin_cells(); cell != grid.end_cells(); ++cell)
+  readPropertyFiles();
+  save_rock_properties(cache_key);
+}
+
+
+void SimData::readPropertyFiles()
+{
+  if (config.property_files.empty())
+    return;
+
+  // cells outside of the domains have no properties yet
+  const std::size_t n_props = rockPropNames.size();
+  for (auto & cell : vsCellRockProps)
+    cell.v_props.resize(n_props, 0);
+
+  const std::size_t n_cells = grid.n_cells();
+  for (const auto & source : config.property_files)
+  {
+    std::cout << "reading property " << source.name << " from " << source.file << std::endl;
+    const std::size_t iprop = find(source.name, rockPropNames);
+    if (iprop == n_props)
+      throw std::invalid_argument("unknown property " + source.name);
+
+    if (source.gridded())
     {
-      if ( cell.marker() == conf.label ) // cells
+      // trilinear lookup at cell centers
+      const gprs_data::GriddedProperty values(source);
+      parallel::parallel_for(0, n_cells, [&](const std::size_t icell)
       {
-        std::fill(vars.begin(), vars.end(), 0);
-        Point center = cell.center();
-        vars[0] = center[0];  // x
-        vars[1] = center[1];  // y
-        vars[2] = center[2];  // z
-
-        // Evaluate expression -> write into variable
-        for (std::size_t i=0; i<n_expressions; ++i)
-        {
-          try {
-            vars[conf.local_to_global_vars.at(i)] = parsers[i].Eval();
-          }
-          catch(mu::Parser::exception_type & e)
-          {
-            std::cout << _T("Evaluation error:  ") << e.GetMsg() << endl;
-            std::cout << "when evaluating expression '"
-                      << conf.expressions[i]
-                      << "'" << std::endl;
-            exit(-1);
-          }
-        }
-
-        // copy vars to cell properties
-        vsCellRockProps[cell.index()].v_props.resize(n_variables - shift);
-        // start from 3 to skip x,y,z
-        for (std::size_t j=shift; j<n_variables; ++j)
-        {
-          try
-          {
-            vsCellRockProps[cell.index()].v_props[j - shift] = vars[j];
-          }
-          catch (std::out_of_range & e)
+        vsCellRockProps[icell].v_props[iprop] =
+            values(grid.create_cell_iterator(icell).center());
+      });
+    }
+    else
+    {
+      // one value per cell in the mesh file order
+      gprs_data::read_property_values(source.file, source.format, n_cells,
+          [&](const std::size_t first, const double * values, const std::size_t count)
           {
-            vsCellRockProps[cell.index()].v_props[j - shift] = 0;
-          }
-        }
-      }  // end match label
-    }    // end cell loop
-  }  // end domain loop
-
+            for (std::size_t i = 0; i < count; ++i)
+            {
+              const std::size_t icell = cell_renumbering.empty() ? first + i
+                                                                 : cell_renumbering[first + i];
+              vsCellRockProps[icell].v_props[iprop] = values[i];
+            }
+          });
+    }
+  }
 }
 
 
@@ -1213,16 +1622,9 @@ void SimData::handleConnections()
   gm_cell_to_flow_cell.resize(grid.n_cells(), std::vector<std::size_t>());
 
   // cells
-  for (auto cell = grid.begin_cells(); cell!=grid.end_cells(); ++cell)
-    for (const auto & conf : config.domains)
-    {
-      if (cell.marker() == conf.label) // cells
-        if (conf.coupled)
-        {
-          gm_cell_to_flow_cell[cell.index()].push_back(n_flow_dfm_faces + cell.index());
-          break;
-        }
-    }
+  for (std::size_t icell = 0; icell < grid.n_cells(); ++icell)
+    if (coupled_domain_table.contains(grid.cell_markers[icell]))
+      gm_cell_to_flow_cell[icell].push_back(n_flow_dfm_faces + icell);
 
   // finally embedded fractures
   for (std::size_t ifrac=0; ifrac<vEfrac.size(); ++ifrac)
@@ -1231,9 +1633,8 @@ void SimData::handleConnections()
     for (std::size_t i=0; i<efrac.cells.size(); ++i)
     {
       const std::size_t icell = efrac.cells[i];
-      for (const auto & conf: config.domains)
-        if (grid.cell_markers[icell] == conf.label and conf.coupled)
-          gm_cell_to_flow_cell[icell].push_back(efrac_flow_index(ifrac, i));
+      if (coupled_domain_table.contains(grid.cell_markers[icell]))
+        gm_cell_to_flow_cell[icell].push_back(efrac_flow_index(ifrac, i));
     }
   }
 }
@@ -1241,37 +1642,64 @@ void SimData::handleConnections()
 
 void SimData::definePhysicalFacets()
 {
-  std::size_t n_facets = 0;
   int nfluid = 0;
   n_neumann_faces = 0;
   n_dirichlet_faces = 0;
 
-  for (auto face = grid.begin_faces(); face != grid.end_faces(); ++face)
+  // classify faces in parallel: config entries of each face
+  const std::size_t n_faces = grid.n_faces();
+  std::vector<int> face_bc(n_faces), face_dfm(n_faces);
+  std::vector<char> face_coupled(n_faces, 0);
+  parallel::PerThread<std::array<std::size_t,2>> bc_counters({0, 0});  // dirichlet, neumann
+  parallel::parallel_for(0, n_faces, [&](const std::size_t iface)
   {
-    const bool is_boundary = (face.neighbors().size() < 2);
+    const auto face = grid.create_const_face_iterator(iface);
     const int marker = face.marker();
-    for (const auto & conf : config.bc_faces)  // external domain boundaries
-      if (marker == conf.label)
-      {
-        PhysicalFace facet;
-        facet.nface = face.index();
-        facet.ntype = conf.type;
-        facet.nmark = conf.label;
-        facet.condition = conf.value;
-        facet.coupled = false;
-        boundary_faces.insert({face.index(), facet});
-        boundary_face_markers.insert(marker);
-        if (conf.type == 1)
-          n_dirichlet_faces++;
-        else if (conf.type == 2)
-          n_neumann_faces++;
+    face_bc[iface] = bc_face_table.find(marker);  // external domain boundaries
+    if (face_bc[iface] >= 0)
+    {
+      const int type = config.bc_faces[face_bc[iface]].type;
+      if (type == 1)
+        bc_counters.local()[0]++;
+      else if (type == 2)
+        bc_counters.local()[1]++;
+    }
 
-        break;
-      }
+    const bool is_boundary = (face.neighbors().size() < 2);
+    face_dfm[iface] = is_boundary ? -1 : dfm_face_table.find(marker);  // discrete fractures
+    if (face_dfm[iface] >= 0)
+      for (const auto & neighbor : face.neighbors())
+        if (coupled_domain_table.contains(grid.cell_markers[neighbor]))
+          face_coupled[iface] = 1;
+  });
+  for (const auto & counters : bc_counters.all())
+  {
+    n_dirichlet_faces += counters[0];
+    n_neumann_faces += counters[1];
+  }
+
+  // fill in facets in face order (dfm control volumes are numbered in this order)
+  for (std::size_t iface = 0; iface < n_faces; ++iface)
+  {
+    if (face_bc[iface] < 0 && face_dfm[iface] < 0)
+      continue;
+
+    const auto face = grid.create_const_face_iterator(iface);
+    const int marker = face.marker();
+    if (face_bc[iface] >= 0)
+    {
+      const auto & conf = config.bc_faces[face_bc[iface]];
+      PhysicalFace facet;
+      facet.nface = face.index();
+      facet.ntype = conf.type;
+      facet.nmark = conf.label;
+      facet.condition = conf.value;
+      facet.coupled = false;
+      boundary_faces.insert({face.index(), facet});
+      boundary_face_markers.insert(marker);
+    }
 
-    if (!is_boundary)
-      for (std::size_t ifrac=0; ifrac<config.discrete_fractures.size(); ++ifrac)
-        if( marker == config.discrete_fractures[ifrac].label)  // dirscrete fractures
+    if (face_dfm[iface] >= 0)
     {
       PhysicalFace facet;
       facet.nface = face.index();
@@ -1279,12 +1707,7 @@ void SimData::definePhysicalFacets()
       facet.nmark = marker;
       facet.neighbor_cells = face.neighbors();
       fracture_face_markers.insert(marker);
-      bool coupled = false;
-      const auto neighbors = face.neighbors();
-      for (const auto & neighbor : neighbors)
-        for (const auto & conf: config.domains)
-          if (grid.cell_markers[neighbor] == conf.label and conf.coupled)
-            coupled = true;
+      const bool coupled = face_coupled[iface];
 
       if (coupled)
       {
@@ -1297,8 +1720,8 @@ void SimData::definePhysicalFacets()
         facet.coupled = false;
       }
 
-      facet.aperture = config.discrete_fractures[ifrac].aperture; //m
-      facet.conductivity = config.discrete_fractures[ifrac].conductivity; //mD.m
+      facet.aperture = config.discrete_fractures[face_dfm[iface]].aperture; //m
+      facet.conductivity = config.discrete_fractures[face_dfm[iface]].conductivity; //mD.m
       dfm_faces.insert({face.index(), facet});
 
       if (coupled)
@@ -1515,63 +1938,115 @@ void SimData::meshFractures()
       const double tol = std::min(new_frac_mesh.minimum_edge_size() / 3,
                                   efrac.mesh.minimum_edge_size() / 3);
 
-      for (std::size_t i=0; i<new_frac_mesh.n_polygons(); ++i)
-        for (std::size_t j=0; j<efrac.mesh.n_polygons(); ++j)
+      // the new mesh is a structured n1 x n2 lattice (element i1 + i2*n1 spans
+      // [i1, i1+1] x [i2, i2+1] in lattice coordinates), so the new elements that
+      // may overlap an old element are found from the bounding box of its vertices
+      const double t1_lattice = n1 / t1.dot(t1);
+      const double t2_lattice = n2 / t2.dot(t2);
+      const double tol1 = tol / t1.norm() * n1;
+      const double tol2 = tol / t2.norm() * n2;
+      const auto lattice_range = [](const double lo, const double hi, const std::size_t n)
+      {
+        const double first = std::max(std::floor(lo), 0.0);
+        const double last = std::min(std::floor(hi) + 1, static_cast<double>(n));
+        return std::make_pair(static_cast<std::size_t>(first),
+                              static_cast<std::size_t>(std::max(first, last)));
+      };
+
+      // find overlapping pairs (new element i, old element j) in parallel
+      struct Overlap
+      {
+        std::size_t i, j;
+        double factor;  // section area / old element area
+      };
+      const std::size_t n_old_elements = efrac.mesh.n_polygons();
+      std::vector<std::vector<Overlap>> element_overlaps(n_old_elements);
+      parallel::parallel_for(0, n_old_elements, [&](const std::size_t j)
+      {
+        const auto & old_vertices = efrac.mesh.get_vertices();
+        const auto & old_element = efrac.mesh.get_polygons()[j];
+        const double max = std::numeric_limits<double>::max();
+        double lo1 = max, hi1 = -max, lo2 = max, hi2 = -max;
+        for (const std::size_t v : old_element)
         {
-          const angem::Polygon<double> poly_i(new_frac_mesh.get_vertices(),
-                                              new_frac_mesh.get_polygons()[i]);
-          const angem::Polygon<double> poly_j(efrac.mesh.get_vertices(),
-                                              efrac.mesh.get_polygons()[j]);
-          std::vector<Point> section;
-          if (angem::collision(poly_i, poly_j, section, tol))
-          {
-            if (section.size() == 2) // only touching sides
-              continue;
-
-            std::cout << "collision " << i << " " << j << std::endl;
-            const angem::Polygon<double> poly_section(section);
+          const Point d = old_vertices[v] - points[0];
+          const double x1 = d.dot(t1) * t1_lattice;
+          const double x2 = d.dot(t2) * t2_lattice;
+          lo1 = std::min(lo1, x1);
+          hi1 = std::max(hi1, x1);
+          lo2 = std::min(lo2, x2);
+          hi2 = std::max(hi2, x2);
+        }
 
-            const std::size_t old_element = old_shift + j;
-            const auto neighbors = flow_data.v_neighbors[old_element];
-            for (const auto & neighbor : neighbors)
+        const angem::Polygon<double> poly_j(old_vertices, old_element);
+        const double area_j = poly_j.area();
+        const auto range1 = lattice_range(lo1 - tol1, hi1 + tol1, n1);
+        const auto range2 = lattice_range(lo2 - tol2, hi2 + tol2, n2);
+        for (std::size_t i2 = range2.first; i2 < range2.second; ++i2)
+          for (std::size_t i1 = range1.first; i1 < range1.second; ++i1)
+          {
+            const std::size_t i = i2 * n1 + i1;
+            const angem::Polygon<double> poly_i(new_frac_mesh.get_vertices(),
+                                                new_frac_mesh.get_polygons()[i]);
+            std::vector<Point> section;
+            if (angem::collision(poly_i, poly_j, section, tol))
             {
-              if (neighbor < n_flow_dfm_faces + grid.n_cells() and neighbor > n_flow_dfm_faces)
-              {
-                flow::FaceData * new_connection;
-                if (new_flow_data.connection_exists(new_shift + i, neighbor))
-                  *new_connection = new_flow_data.get_connection(new_shift + i, neighbor);
-                else
-                  *new_connection = new_flow_data.insert_connection(new_shift + i, neighbor);
-
-                const auto & old_conn = flow_data.get_connection(old_element, neighbor);
-                const double factor = poly_section.area() / poly_j.area();
-                const double T_ij = old_conn.transmissibility;
-                {
-                    (*new_connection).transmissibility = T_ij * factor;
-                    (*new_connection).thermal_conductivity = old_conn.thermal_conductivity * factor; // shall be validated later.
-                    (*new_connection).conType = old_conn.conType;
-                    std::size_t old_conn_conN = old_conn.conCV.size();
-                    (*new_connection).conCV.resize(old_conn_conN);
-                    (*new_connection).conTr.resize(old_conn_conN);
-                    (*new_connection).conArea.resize(old_conn_conN);
-                    (*new_connection).conPerm.resize(old_conn_conN);
-                    (*new_connection).zVolumeFactor.resize(old_conn_conN);
-                    for (std::size_t m=0; m<old_conn_conN; m++){
-                        (*new_connection).conCV[m] = old_conn.conCV[m];
-                        (*new_connection).conTr[m] = old_conn.conTr[m];
-                        (*new_connection).conArea[m] = old_conn.conArea[m]*factor;
-                        (*new_connection).conPerm[m] = old_conn.conPerm[m];
-                        (*new_connection).zVolumeFactor[m] = old_conn.zVolumeFactor[m];
-                    }
-                }
-              }
+              if (section.size() == 2) // only touching sides
+                continue;
+              const angem::Polygon<double> poly_section(section);
+              element_overlaps[j].push_back({i, j, poly_section.area() / area_j});
             }
           }
-          else
+      });
+
+      // apply in the order of new elements
+      std::vector<Overlap> overlaps;
+      for (const auto & element_overlap : element_overlaps)
+        overlaps.insert(overlaps.end(), element_overlap.begin(), element_overlap.end());
+      std::sort(overlaps.begin(), overlaps.end(),
+                [](const Overlap & o1, const Overlap & o2)
+                {return std::make_pair(o1.i, o1.j) < std::make_pair(o2.i, o2.j);});
+      std::cout << "fracture " << f << ": " << overlaps.size()
+                << " overlaps of new and old elements" << std::endl;
+
+      for (const Overlap & overlap : overlaps)
+      {
+        const std::size_t i = overlap.i;
+        const std::size_t old_element = old_shift + overlap.j;
+        const auto neighbors = flow_data.v_neighbors[old_element];
+        for (const auto & neighbor : neighbors)
+        {
+          if (neighbor < n_flow_dfm_faces + grid.n_cells() and neighbor > n_flow_dfm_faces)
           {
-            // std::cout << "no collision " << i << " " << j << std::endl;
+            flow::FaceData & new_connection =
+                new_flow_data.connection_exists(new_shift + i, neighbor)
+                ? new_flow_data.get_connection(new_shift + i, neighbor)
+                : new_flow_data.insert_connection(new_shift + i, neighbor);
+
+            const auto & old_conn = flow_data.get_connection(old_element, neighbor);
+            const double factor = overlap.factor;
+            const double T_ij = old_conn.transmissibility;
+            {
+                new_connection.transmissibility = T_ij * factor;
+                new_connection.thermal_conductivity = old_conn.thermal_conductivity * factor; // shall be validated later.
+                new_connection.conType = old_conn.conType;
+                std::size_t old_conn_conN = old_conn.conCV.size();
+                new_connection.conCV.resize(old_conn_conN);
+                new_connection.conTr.resize(old_conn_conN);
+                new_connection.conArea.resize(old_conn_conN);
+                new_connection.conPerm.resize(old_conn_conN);
+                new_connection.zVolumeFactor.resize(old_conn_conN);
+                for (std::size_t m=0; m<old_conn_conN; m++){
+                    new_connection.conCV[m] = old_conn.conCV[m];
+                    new_connection.conTr[m] = old_conn.conTr[m];
+                    new_connection.conArea[m] = old_conn.conArea[m]*factor;
+                    new_connection.conPerm[m] = old_conn.conPerm[m];
+                    new_connection.zVolumeFactor[m] = old_conn.zVolumeFactor[m];
+                }
+            }
           }
-        }  // end frac element loop
+        }
+      }  // end overlap loop
 
       flow::FlowData frac_flow_data;
       computeFracFracTran(f, efrac, new_frac_mesh, frac_flow_data);
@@ -1750,29 +2225,49 @@ bool SimData::is_reservoir_element(const std::size_t flow_element_index) const
 
 void SimData::setupWells()
 {
+  if (config.wells.empty()) return;
+  // bounding boxes to skip cells far from the wells
+  const mesh::CellGeometryCache cell_geometry(grid);
+  // search structures of complex wells
+  std::unique_ptr<mesh::CellBucketGrid> buckets;
+  std::unique_ptr<mesh::VertexCells> vertex_cells;
   for (const auto & conf : config.wells)
   {
     Well well(conf);
     std::cout << "setting up " << well.name << std::endl;
     if (well.simple())
-      setupSimpleWell(well);
+      setupSimpleWell(well, cell_geometry);
     else
-      setupComplexWell(well);
+    {
+      if (!buckets)
+      {
+        buckets = std::make_unique<mesh::CellBucketGrid>(cell_geometry);
+        vertex_cells = std::make_unique<mesh::VertexCells>(grid);
+      }
+      setupComplexWell(well, *buckets, *vertex_cells);
+    }
 
-    std::cout << "computing WI" << std::endl;
-    computeWellIndex(well);
     wells.push_back(std::move(well));
   }
+
+  std::cout << "computing WI" << std::endl;
+  computeWellIndices(cell_geometry);
 }
 
 
-void SimData::setupSimpleWell(Well & well)
+void SimData::setupSimpleWell(Well & well, const mesh::CellGeometryCache & cell_geometry)
 {
   std::cout << "simple well " << well.name << std::endl;
   const Point direction = {0, 0, -1};
   // well assigned with a single coordinate
   for (auto cell = grid.begin_cells(); cell != grid.end_cells(); ++cell)
   {
+    const std::size_t icell = cell.index();
+    const double cell_size = (cell_geometry.bbox_max(icell) - cell_geometry.bbox_min(icell)).norm();
+    if (!boxes_overlap(cell_geometry.bbox_min(icell), cell_geometry.bbox_max(icell),
+                       well.coordinate, well.coordinate, 1e-6 * cell_size))
+      continue;
+
     const std::unique_ptr<angem::Polyhedron<double>> p_poly_cell = cell.polyhedron();
     if (p_poly_cell->point_inside(well.coordinate))
     {
@@ -1795,48 +2290,181 @@ void SimData::setupSimpleWell(Well & well)
 }
 
 
-void SimData::setupComplexWell(Well & well)
+void SimData::setupComplexWell(Well & well, const mesh::CellBucketGrid & buckets,
+                               const mesh::VertexCells & vertex_cells)
 {
   // setup well with segments
   std::cout << "complex well " << well.name << std::endl;
+  const std::size_t no_cell = std::numeric_limits<std::size_t>::max();
+  // cell that contains the end of the previous intersection
+  std::size_t current = no_cell;
+  // distance along the trajectory to the start of the current segment
+  double trajectory_start = 0;
+
   for (std::size_t isegment = 0; isegment < well.segments.size(); ++isegment)
   {
-    auto segment = well.segments[isegment];
+    const auto & segment = well.segments[isegment];
+    const bool perforated = (isegment < well.perforated.size()) ? well.perforated[isegment] : true;
+    const double length = segment.first.distance(segment.second);
+    if (length == 0)
+      continue;
+    const Point direction = (segment.second - segment.first) / length;
+    const double tol = 1e-6 * length;
+
+    // part [t0, t1] of the segment inside the cell (distances from the segment start)
+    // false if the segment does not cross the cell
     std::vector<Point> section_data;
-    for (auto cell = grid.begin_cells(); cell != grid.end_cells(); ++cell)
+    const auto cell_interval = [&](const std::size_t icell, double & t0, double & t1)
     {
-      const std::unique_ptr<angem::Polyhedron<double>> p_poly_cell = cell.polyhedron();
-      if (angem::collision(segment.first, segment.second,
-                           *p_poly_cell, section_data, 1e-6))
+      section_data.clear();
+      const std::unique_ptr<angem::Polyhedron<double>> p_poly_cell =
+          grid.create_cell_iterator(icell).polyhedron();
+      if (!angem::collision(segment.first, segment.second,
+                            *p_poly_cell, section_data, 1e-6) ||
+          section_data.size() < 2)
+        return false;
+      t0 = std::numeric_limits<double>::max();
+      t1 = -t0;
+      for (const Point & p : section_data)
+      {
+        const double t = (p - segment.first).dot(direction);
+        t0 = std::min(t0, t);
+        t1 = std::max(t1, t);
+      }
+      return t1 - t0 > tol;
+    };
+
+    double t = 0;
+    while (t < length - tol)
+    {
+      // march: the segment continues in the current cell or in one of its face neighbors
+      std::size_t next = no_cell;
+      double next_t1 = t;
+      if (current != no_cell)
       {
-        if (section_data.size() != 2)
+        std::vector<std::size_t> candidates = grid.create_cell_iterator(current).neighbor_indices();
+        candidates.push_back(current);
+        for (const std::size_t icell : candidates)
         {
-          std::cout << "just touching cell " << cell.index() << std::endl;
-          section_data.clear();
-          continue;
+          double t0, t1;
+          if (cell_interval(icell, t0, t1) && t0 <= t + tol && t1 > std::max(t, next_t1) + tol)
+          {
+            next = icell;
+            next_t1 = t1;
+          }
         }
-        std::cout << "fully occupying cell " << cell.index() << std::endl;
+      }
 
-        well.connected_volumes.push_back(res_cell_flow_index(cell.index()));
-        well.segment_length.push_back(section_data[0].distance(section_data[1]));
-        well.directions.push_back(segment.second - segment.first);
-        well.directions.back().normalize();
-
-        // for visulatization
-        well_vertex_indices.emplace_back();
-        well_vertex_indices.back().first = well_vertices.insert(section_data[0]);
-        well_vertex_indices.back().second = well_vertices.insert(section_data[1]);
-
-        // auto-detect reference depth for bhp
-        if (!well.reference_depth_set)
-          if(cell.center()[2] < well.reference_depth)
-            well.reference_depth = cell.center()[2];
-        section_data.clear();
+      // the segment leaves the cell through an edge or a vertex:
+      // it continues in a cell that shares a vertex with the current one
+      if (next == no_cell && current != no_cell)
+      {
+        const auto face_neighbors = grid.create_cell_iterator(current).neighbor_indices();
+        for (const std::size_t icell : vertex_cells.vertex_neighbors(grid, current))
+        {
+          if (std::find(face_neighbors.begin(), face_neighbors.end(), icell) !=
+              face_neighbors.end())
+            continue;  // tested above
+          double t0, t1;
+          if (cell_interval(icell, t0, t1) && t0 <= t + tol && t1 > std::max(t, next_t1) + tol)
+          {
+            next = icell;
+            next_t1 = t1;
+          }
+        }
+      }
+
+      // the segment enters the domain or there is a gap: search for the
+      // closest crossed cell ahead, bucket by bucket along the segment
+      double next_t0 = t;
+      if (next == no_cell)
+      {
+        next_t0 = std::numeric_limits<double>::max();
+        const double step = buckets.bucket_size();
+        std::unordered_set<std::size_t> tested;
+        // stop once the chunks are past the start of the closest crossed cell
+        for (double chunk_start = t; chunk_start < length - tol && chunk_start < next_t0;
+             chunk_start += step)
+        {
+          const double chunk_end = std::min(chunk_start + step, length);
+          Point chunk_min, chunk_max;
+          bounding_box({segment.first + direction * chunk_start,
+                        segment.first + direction * chunk_end}, chunk_min, chunk_max);
+          for (std::size_t i = 0; i < 3; ++i)
+          {
+            chunk_min[i] -= tol;
+            chunk_max[i] += tol;
+          }
+          for (const std::size_t icell : buckets.cells_in_box(chunk_min, chunk_max))
+          {
+            if (!tested.insert(icell).second)
+              continue;
+            double t0, t1;
+            if (cell_interval(icell, t0, t1) && t1 > t + tol && t0 < next_t0)
+            {
+              next = icell;
+              next_t0 = std::max(t, t0);
+              next_t1 = t1;
+            }
+          }
+        }
+      }
+
+      if (next == no_cell)  // rest of the segment is outside of the domain
+        break;
+
+      const Point p0 = segment.first + direction * next_t0;
+      const Point p1 = segment.first + direction * next_t1;
+
+      // multi-segment topology: a segment flows into the previous one unless
+      // the trajectory left the domain between them, then it starts a new branch
+      const bool continued = !well.ms_volumes.empty() &&
+                             trajectory_start + next_t0 <= well.ms_end.back() + tol;
+      if (continued)
+        well.ms_connections.push_back({well.ms_volumes.size(), well.ms_volumes.size() - 1});
+      if (well.ms_volumes.empty())
+        well.ms_top = p0;
+      well.ms_branch.push_back(well.ms_branch.empty() ? 1 :
+                               well.ms_branch.back() + (continued ? 0 : 1));
+      well.ms_volumes.push_back(res_cell_flow_index(next));
+      well.ms_start.push_back(trajectory_start + next_t0);
+      well.ms_end.push_back(trajectory_start + next_t1);
+      well.ms_nodes.push_back(p1);
+      well.ms_perforated.push_back(perforated);
+
+      if (perforated)
+      {
+        well.connected_volumes.push_back(res_cell_flow_index(next));
+        well.segment_length.push_back(next_t1 - next_t0);
+        well.directions.push_back(direction);
+      }
+
+      // for visulatization
+      well_vertex_indices.emplace_back();
+      well_vertex_indices.back().first = well_vertices.insert(p0);
+      well_vertex_indices.back().second = well_vertices.insert(p1);
+
+      // auto-detect reference depth for bhp
+      if (!well.reference_depth_set)
+      {
+        const double z = grid.create_cell_iterator(next).center()[2];
+        if(z < well.reference_depth)
+          well.reference_depth = z;
       }
+
+      current = next;
+      t = next_t1;
     }
+
+    // the next segment starts where this one ends
+    if (t < length - tol)
+      current = no_cell;
+    trajectory_start += length;
   }
 
   well.reference_depth_set = true;
+  std::cout << "well " << well.name << ": " << well.ms_volumes.size() << " segments, "
+            << well.connected_volumes.size() << " perforated" << std::endl;
 
   // error if no connected volumes
   if (well.connected_volumes.empty())
@@ -1844,30 +2472,6 @@ void SimData::setupComplexWell(Well & well)
 }
 
 
-inline
-double get_bounding_interval(const angem::Point<3,double>     & direction,
-                             const angem::Polyhedron<double> * poly)
-{
-  assert(fabs(direction.norm() - 1) < 1e-8);
-  angem::Point<3,double> neg_direction = - direction;
-  return fabs((poly->support(direction) - poly->support(neg_direction)).dot(direction));
-}
-
-
-angem::Point<3,double> SimData::get_dx_dy_dz(const std::size_t icell) const
-{
-  const auto cell_poly = grid.create_cell_iterator(icell).polyhedron();
-  angem::Point<3,double> dir, result;
-  dir = {1, 0, 0};
-  result[0] = get_bounding_interval(dir, cell_poly.get());
-  dir = {0, 1, 0};
-  result[1] = get_bounding_interval(dir, cell_poly.get());
-  dir = {0, 0, 1};
-  result[2] = get_bounding_interval(dir, cell_poly.get());
-  return result;
-}
-
-
 double compute_productivity(const double k1, const double k2,
                             const double dx1, const double dx2,
                             const double length, const double radius,
@@ -1884,29 +2488,81 @@ double compute_productivity(const double k1, const double k2,
 }
 
 
-void SimData::computeWellIndex(Well & well)
+void SimData::computeWellIndices(const mesh::CellGeometryCache & cell_geometry)
 {
-  well.indices.resize(well.connected_volumes.size());
-  for (std::size_t i = 0; i<well.connected_volumes.size(); ++i)
+  // all well connections as (well, connection) pairs
+  std::vector<std::pair<std::size_t,std::size_t>> connections;
+  std::vector<std::size_t> cells;
+  for (std::size_t iwell = 0; iwell < wells.size(); ++iwell)
+  {
+    auto & well = wells[iwell];
+    well.indices.resize(well.connected_volumes.size());
+    for (std::size_t i = 0; i < well.connected_volumes.size(); ++i)
+    {
+      connections.push_back({iwell, i});
+      cells.push_back(well.connected_volumes[i] - n_flow_dfm_faces);
+    }
+  }
+  std::sort(cells.begin(), cells.end());
+  cells.erase(std::unique(cells.begin(), cells.end()), cells.end());
+
+  // permeability property columns are found once instead of by key for each cell
+  const std::size_t ipermx = find(std::string("PERMX"), rockPropNames);
+  const std::size_t ipermy = find(std::string("PERMY"), rockPropNames);
+  const std::size_t ipermz = find(std::string("PERMZ"), rockPropNames);
+  const std::size_t iperm = find(std::string("PERM"), rockPropNames);
+  const auto has_property = [this](const std::size_t icell, const std::size_t ikey)
+  {
+    return ikey < rockPropNames.size() && ikey < vsCellRockProps[icell].v_props.size();
+  };
+
+  // permeability and bounding box extents of the connected cells
+  // (same values as get_permeability and the cell support intervals)
+  const std::size_t n_cells = cells.size();
+  std::vector<double> kx(n_cells), ky(n_cells), kz(n_cells);
+  std::vector<double> dx(n_cells), dy(n_cells), dz(n_cells);
+  parallel::parallel_for(0, n_cells, [&](const std::size_t i)
+  {
+    const std::size_t icell = cells[i];
+    const auto & props = vsCellRockProps[icell].v_props;
+    if (has_property(icell, ipermx) && has_property(icell, ipermy) && has_property(icell, ipermz))
+    {
+      kx[i] = props[ipermx];
+      ky[i] = props[ipermy];
+      kz[i] = props[ipermz];
+    }
+    else if (has_property(icell, iperm))
+      kx[i] = ky[i] = kz[i] = props[iperm];
+    else
+      kx[i] = ky[i] = kz[i] = config.default_permeability;
+
+    const Point extent = cell_geometry.bbox_max(icell) - cell_geometry.bbox_min(icell);
+    dx[i] = extent[0];
+    dy[i] = extent[1];
+    dz[i] = extent[2];
+  });
+
+  parallel::parallel_for(0, connections.size(), [&](const std::size_t iconn)
   {
+    auto & well = wells[connections[iconn].first];
+    const std::size_t i = connections[iconn].second;
     const std::size_t icell = well.connected_volumes[i] - n_flow_dfm_faces;
-    const angem::Point<3,double> perm = get_permeability(icell);
-    angem::Point<3,double> dx_dy_dz = get_dx_dy_dz(icell);
+    const std::size_t c = std::lower_bound(cells.begin(), cells.end(), icell) - cells.begin();
+    const double length = well.segment_length[i];
+    const Point & direction = well.directions[i];
+
     angem::Point<3,double> productivity;
     productivity[0] =
-        compute_productivity(perm[1], perm[2], dx_dy_dz[1], dx_dy_dz[2],
-                             well.segment_length[i]*fabs(well.directions[i][0]),
-                             well.radius);
+        compute_productivity(ky[c], kz[c], dy[c], dz[c],
+                             length*fabs(direction[0]), well.radius, well.skin);
     productivity[1] =
-        compute_productivity(perm[0], perm[2], dx_dy_dz[0], dx_dy_dz[2],
-                             well.segment_length[i]*fabs(well.directions[i][1]),
-                             well.radius);
+        compute_productivity(kx[c], kz[c], dx[c], dz[c],
+                             length*fabs(direction[1]), well.radius, well.skin);
     productivity[2] =
-        compute_productivity(perm[0], perm[1], dx_dy_dz[0], dx_dy_dz[1],
-                             well.segment_length[i]*fabs(well.directions[i][2]),
-                             well.radius);
+        compute_productivity(kx[c], ky[c], dx[c], dy[c],
+                             length*fabs(direction[2]), well.radius, well.skin);
     well.indices[i] = productivity.norm();
-  }
+  });
 }
 
 
@@ -18,9 +18,14 @@
 #include "angem/Collisions.hpp"
 #include "mesh/SurfaceMesh.hpp"
 #include "mesh/Mesh.hpp"
+#include "mesh/CellGeometryCache.hpp"
+#include "mesh/CellBucketGrid.hpp"
+#include "mesh/VertexCells.hpp"
 #include "SimdataConfig.hpp"
 #include <Well.hpp>
 #include "MultiScaleOutputData.hpp"
+#include "StageCache.hpp"
+#include "MarkerTable.hpp"
 
 #include <algorithm>
 #include <cmath>
@@ -110,7 +115,8 @@ public:
   // determine geometry of intersection of embedded fractures with the mesh
   void computeCellClipping();
   // merge small section elemenents of edfm fractures with larger neighbors (flow only)
-  // the implementation is for the old architecture, needs a rewrite
+  // elements below frac_cell_elinination_factor * (max element area) are merged
+  // smallest first; merged elements are removed from flow data in one pass at the end
   void mergeSmallFracCells();
   // create cartesian mesh within edfm fractures for flow computation
   void meshFractures();
@@ -138,27 +144,45 @@ public:
   void computeTransEfracIntersection();
 
   // helper: check if face is a fracture
-  bool is_fracture (const int marker)
+  bool is_fracture (const int marker) const
   {
-    const auto it = fracture_face_markers.find(marker);
-    if (it != fracture_face_markers.end())
-      return true;
-    else return false;
+    return fracture_face_markers.contains(marker);
   }
 
   // helper: check if face is a boundary face
-  bool is_boundary (const int marker)
+  bool is_boundary (const int marker) const
   {
-    const auto it = boundary_face_markers.find(marker);
-    if (it != boundary_face_markers.end())
-      return true;
-    else return false;
+    return boundary_face_markers.contains(marker);
   }
 
   // Multiscale
   void build_multiscale_data();
 
 protected:
+  // reservoir flow connections in the order they are inserted into flow_data
+  using MatrixConnections =
+      std::vector<std::pair<std::pair<std::size_t,std::size_t>, flow::FaceData>>;
+  // run CalcTranses on the reservoir cells and dfm faces
+  void compute_matrix_flow_data(std::vector<flow::CellData> & cells,
+                                MatrixConnections           & connections);
+  // hash of the grid (computed once)
+  std::uint64_t mesh_hash() const;
+  // read config.property_files into vsCellRockProps
+  void readPropertyFiles();
+  // stage cache key of defineRockProperties (mesh, domains and property files)
+  std::uint64_t rock_properties_key() const;
+  // stage cache key of computeReservoirTransmissibilities
+  // (mesh, domains and discrete fractures)
+  std::uint64_t reservoir_transes_key() const;
+  // stage cache I/O; load functions return false if there is no valid result
+  bool load_rock_properties(const std::uint64_t key);
+  void save_rock_properties(const std::uint64_t key) const;
+  bool load_matrix_flow_data(const std::uint64_t           key,
+                             std::vector<flow::CellData> & cells,
+                             MatrixConnections           & connections) const;
+  void save_matrix_flow_data(const std::uint64_t                 key,
+                             const std::vector<flow::CellData> & cells,
+                             const MatrixConnections           & connections) const;
   // number of default variables (such as cell x,y,z) for rock properties
   std::size_t n_default_vars() const;
   // get property from cell->v_props by key
@@ -175,13 +199,14 @@ protected:
                                               flow::FlowData                              & flow_data) const;
   // get flow volume index of an edfm element
   // create a well that occupies a single cell in z direction
-  void setupSimpleWell(Well & well);
+  void setupSimpleWell(Well & well, const mesh::CellGeometryCache & cell_geometry);
   // create a complex well that occupies multiple cells and is arbitrarily-oriented
-  void setupComplexWell(Well & well);
-  // compute productivities of all well segments
-  void computeWellIndex(Well & well);
-  // get dimensions of a cell bounding box
-  angem::Point<3,double> get_dx_dy_dz(const std::size_t icell) const;
+  // (cells are searched among the vertex neighbors and then in the buckets along the segments)
+  void setupComplexWell(Well & well, const mesh::CellBucketGrid & buckets,
+                        const mesh::VertexCells & vertex_cells);
+  // compute productivities of all well connections of all wells in parallel
+  // (cell sizes are the bounding box extents from cell_geometry)
+  void computeWellIndices(const mesh::CellGeometryCache & cell_geometry);
 
   // is given flow element an embedded fracture
   // Params [in]
@@ -239,6 +264,9 @@ public:
   SimdataConfig config;
   // class that handles mesh (cells, faces, neighbors, face-splitting)
   mesh::Mesh & grid;
+  // new index of each cell of the mesh file if the grid was renumbered
+  // (empty otherwise); per-cell property files are in the mesh file order
+  std::vector<std::size_t> cell_renumbering;
   // class that stores dfm grid for vtk output
   mesh::SurfaceMesh<double> dfm_master_grid;
 
@@ -278,9 +306,9 @@ public:
   std::vector<std::vector<std::size_t>> gm_cell_to_flow_cell;
 
   // set of markers for dfm faces (used in is_fracture)
-  std::set<int> fracture_face_markers;
+  MarkerTable fracture_face_markers;
   // set of markers for boundary faces (used in is_boundary)
-  std::unordered_set<int> boundary_face_markers;
+  MarkerTable boundary_face_markers;
 
   // multiscale
   multiscale::MultiScaleOutputData ms_flow_data;
@@ -293,6 +321,17 @@ protected:
   // it might be used in older timur's version for 2nd order elements but not
   // in this version
   StandardElements * pStdElement;
+  // results of expensive stages saved between runs
+  StageCache stage_cache;
+  mutable std::uint64_t grid_hash = 0;
+  mutable bool grid_hash_computed = false;
+  // config lookup tables (built in the constructor)
+  // marker -> index in config.bc_faces
+  MarkerTable bc_face_table;
+  // marker -> index in config.discrete_fractures
+  MarkerTable dfm_face_table;
+  // markers of the domains that are coupled with flow
+  MarkerTable coupled_domain_table;
   // class that performs vertex renumbering  after dfm split for
   // linear solver operation
   // renum * pRenum;
@@ -1,6 +1,9 @@
 #define _CRT_SECURE_NO_DEPRECATE
 #include "transes.hpp"
 #include "simdata.hpp"
+#include "BufferedWriter.hpp"
+#include "ConnectionSpool.hpp"
+#include "profiling/Profiler.hpp"
 #include <random>
 
 namespace flow
@@ -1083,6 +1086,8 @@ void CalcTranses::ComputeTransmissibilityList()
 /********************************************************************/
 void CalcTranses::compute_flow_data()
 {
+    const profiling::ScopedTimer timer("CalcTranses");
+
     double m1x, m1y, m1z,
         p1x, p1y, p1z,
         m2x, m2y, m2z,
@@ -1173,17 +1178,45 @@ void CalcTranses::compute_flow_data()
       ZConduction[j][5] = 0.0;
    }
 
-    ComputeBasicGeometry();
-    ComputeControlVolumeList();
-    PrepareConnectionList();
-    ConstructConnectionList();
+    {
+      const profiling::ScopedTimer timer("ComputeBasicGeometry");
+      ComputeBasicGeometry();
+    }
+    {
+      const profiling::ScopedTimer timer("ComputeControlVolumeList");
+      ComputeControlVolumeList();
+    }
+    {
+      const profiling::ScopedTimer timer("PrepareConnectionList");
+      PrepareConnectionList();
+    }
+    {
+      const profiling::ScopedTimer timer("ConstructConnectionList");
+      ConstructConnectionList();
+    }
 
-    if (NbOptions == 1) VolumeCorrection();
+    if (NbOptions == 1)
+    {
+      const profiling::ScopedTimer timer("VolumeCorrection");
+      VolumeCorrection();
+    }
 
-    ComputeContinuityNode();
-    ComputeDirectionalPermeability();
-    ComputeTransmissibilityPart();
-    ComputeTransmissibilityList();
+    {
+      const profiling::ScopedTimer timer("ComputeContinuityNode");
+      ComputeContinuityNode();
+    }
+    {
+      const profiling::ScopedTimer timer("ComputeDirectionalPermeability");
+      ComputeDirectionalPermeability();
+    }
+    {
+      const profiling::ScopedTimer timer("ComputeTransmissibilityPart");
+      ComputeTransmissibilityPart();
+    }
+    {
+      const profiling::ScopedTimer timer("ComputeTransmissibilityList");
+      ComputeTransmissibilityList();
+    }
 
     //////////////////////////////////
     ///// Computing Total Volume /////
@@ -1372,6 +1405,7 @@ void CalcTranses::writeOutputFiles(const std::string & output_path) const
 
 void CalcTranses::extractData(FlowData & data) const
 {
+  const profiling::ScopedTimer timer("CalcTranses::extractData");
   // std::cout << "extracting volume data" << std::endl;
   // Extract Volumes, porosity, depth
   data.cells.resize(NbCVs);
@@ -1465,45 +1499,51 @@ void CalcTranses::save_output(const FlowData    & data,
   const std::string fname_gmupdate_data = "fname_trans_data.txt";
 
   {  // Write cell data
-    ofstream out;
-    out.open((output_dir + fname_cell_data).c_str());
+    IO::BufferedWriter out(output_dir + fname_cell_data);
 
     ///// OUTPUT Dimensions /////
-    out << "DIMENS" << std::endl;
+    out << "DIMENS\n";
     out << data.cells.size() << "\t"
         << 1 << "\t" << 1 << "\t"
-        << std::endl;
-    out << "/" << std::endl << std::endl;
+        << "\n";
+    out << "/\n\n";
 
     ///// OUTPUT Volumes /////
-    out << "VOLUME" << std::endl;
-    for (const auto & v : data.cells)
-      out << v.volume << std::endl;
-    out << "/" << std::endl << std::endl;
+    out << "VOLUME\n";
+    out.write_parallel(data.cells.size(), [&data](IO::BufferedWriter & chunk, const std::size_t i)
+    {
+      chunk << data.cells[i].volume << "\n";
+    });
+    out << "/\n\n";
 
     ///// OUTPUT Porosity /////
-    out << "PORO" << std::endl;
-    for (const auto & v : data.cells)
-      out << v.porosity << std::endl;
-    out << "/" << std::endl << std::endl;
+    out << "PORO\n";
+    out.write_parallel(data.cells.size(), [&data](IO::BufferedWriter & chunk, const std::size_t i)
+    {
+      chunk << data.cells[i].porosity << "\n";
+    });
+    out << "/\n\n";
 
     ///// OUTPUT Depth  /////
-    out << "DEPTH" << std::endl;
-    for (const auto & v : data.cells)
-      out << v.depth << std::endl;
-    out << "/" << std::endl << std::endl;
+    out << "DEPTH\n";
+    out.write_parallel(data.cells.size(), [&data](IO::BufferedWriter & chunk, const std::size_t i)
+    {
+      chunk << data.cells[i].depth << "\n";
+    });
+    out << "/\n\n";
 
     // additional data (if any)
     for (std::size_t i=0; i<data.custom_names.size(); ++i)
     {
-      out << data.custom_names[i] << std::endl;
-      for (const auto & cell : data.cells)
+      out << data.custom_names[i] << "\n";
+      out.write_parallel(data.cells.size(), [&data, i](IO::BufferedWriter & chunk, const std::size_t icell)
       {
+        const auto & cell = data.cells[icell];
         if (cell.custom.size() != data.custom_names.size())
           assert(cell.custom.size() == data.custom_names.size());
-        out << cell.custom[i] << std::endl;
-      }
-      out << "/" << std::endl << std::endl;
+        chunk << cell.custom[i] << "\n";
+      });
+      out << "/\n\n";
     }
 
     out.close();
@@ -1511,100 +1551,128 @@ void CalcTranses::save_output(const FlowData    & data,
 
   { // Face data
 
-    ofstream out;
-    out.open((output_dir + fname_face_data).c_str());
+    IO::BufferedWriter out(output_dir + fname_face_data);
 
     /* OUTPUT Transmissibility */
-    out << "TPFACONNS" << std::endl;
+    out << "TPFACONNS\n";
     std::size_t n_connections = data.map_connection.size();
-    out << n_connections << std::endl;
+    out << n_connections + (data.spool ? data.spool->size() : 0) << "\n";
+    // connections streamed out during the computation go first
+    if (data.spool)
+      data.spool->copy_connections(out);
+    // map iteration order, but random access for parallel formatting
+    std::vector<const std::pair<const std::size_t, FaceData>*> connections;
+    connections.reserve(n_connections);
     for (const auto & conn : data.map_connection)
+      connections.push_back(&conn);
+
+    out.write_parallel(n_connections, [&data, &connections](IO::BufferedWriter & chunk, const std::size_t i)
     {
-      // const std::size_t iconn = conn.second;
+      const auto & conn = *connections[i];
       const auto element_pair = data.invert_hash(conn.first);
-      const auto face = conn.second;
-      out << element_pair.first << "\t"
-          << element_pair.second << "\t"
-          << std::scientific
-          << face.transmissibility * transmissibility_conversion_factor
-          << std::defaultfloat << std::endl;
-    }
-    out << "/" << std::endl;
+      write_connection(chunk, element_pair.first, element_pair.second, conn.second);
+    });
+    out << "/\n";
 
     out.close();
   }
 
   { // Geometric part of transmissibilities
-      ofstream out;
-      out.open((output_dir + fname_gmupdate_data).c_str());
+      IO::BufferedWriter out(output_dir + fname_gmupdate_data);
 
 
-      out << "GMUPDATETRANS" << std::endl;
-      int k=0;
+      out << "GMUPDATETRANS\n";
+      // streamed connections go first
+      std::size_t k = 0;
+      if (data.spool)
+      {
+        data.spool->copy_geometric_data(out);
+        k = data.spool->n_geometric_entries();
+      }
       for (const auto & conn : data.map_connection)
-        {
-        const auto face = conn.second;
-        if(face.conType==1 || face.conType==2)	// M-M, M-F ////////////////////////////
-          {
-          if(face.conType==1)		// M-M ////////////////////////////
-          {
-              // Con# conType i ai j aj -> Tij=ai*aj/(ai+aj)
-              out << k << "\t"
-                  << face.conType << "\t"
-                  << face.conCV[0] << "\t"
-                  << face.conTr[0] << "\t"
-                  << face.conCV[1] << "\t"
-                  << face.conTr[1] << std::endl;
-          }
-          if(face.conType==2)		// M-F ////////////////////////////
-          {
-              //Con# conType m am i ci ei ki ai=ci*ki/ei-> Tmi=am*ai/(am+ai)
-              out << k << "\t"
-                  << face.conType << "\t"
-                  << face.conCV[0] << "\t"
-                  << face.conTr[0] << "\t"
-                  << face.conCV[1] << "\t"
-                  << 2.*face.conArea[1]  << "\t"
-                  << face.zVolumeFactor[1] << "\t"
-                  << face.conPerm[1] << "\t"
-                  << std::endl;
-          }
+        if (write_geometric_data(out, k, conn.second))
           k++;
-          }
-        if(face.conType==3)	// F-F /////////////////////////////////////////////////
-          {
-           //Con# conType i ci ei ki j cj ej kj N n cn en kn
-           //ai=ci*ki*ei aj=cj*kj*ej an=cn*kn*en
-           //-> Tij=ai*aj/(SUM an)
-           //
-            std::size_t j = 0;
-            std::size_t n = 1;
-            std::size_t conN = face.conCV.size();
-            out << k << "\t"
-              << face.conType << "\t"
-              << face.conCV[j] << "\t"
-              << face.conTr[j]/(face.conPerm[j]*face.zVolumeFactor[j]) << "\t"
-              << face.zVolumeFactor[j] << "\t"
-              << face.conPerm[j]  << "\t"
-              << face.conCV[n] << "\t"
-              << face.conTr[n]/(face.conPerm[n]*face.zVolumeFactor[n])<< "\t"
-              << face.zVolumeFactor[n] << "\t"
-              << face.conPerm[n] << "\t"
-              << face.conCV[n] << "\t";
-            for(std::size_t m=0; m< conN; m++)
-              out << face.conCV[m] << "\t"
-                  << face.conTr[m]/(face.conPerm[m]*face.zVolumeFactor[m]) << "\t"
-                  << face.zVolumeFactor[m] << "\t"
-                  << face.conPerm[m] << "\t";
-            out << std::endl;
-            k++;
-           }
-        }
-      out << "/" << std::endl;
+      out << "/\n";
 
       out.close();
   }
 
 }
 
+
+void CalcTranses::write_connection(IO::BufferedWriter & out,
+                                   const std::size_t    ielement,
+                                   const std::size_t    jelement,
+                                   const FaceData     & face)
+{
+  out << ielement << "\t"
+      << jelement << "\t"
+      << std::scientific
+      << face.transmissibility * transmissibility_conversion_factor
+      << std::defaultfloat << "\n";
+}
+
+
+bool CalcTranses::write_geometric_data(IO::BufferedWriter & out,
+                                       const std::size_t    k,
+                                       const FaceData     & face)
+{
+  if(face.conType==1 || face.conType==2)	// M-M, M-F ////////////////////////////
+    {
+    if(face.conType==1)		// M-M ////////////////////////////
+    {
+        // Con# conType i ai j aj -> Tij=ai*aj/(ai+aj)
+        out << k << "\t"
+            << face.conType << "\t"
+            << face.conCV[0] << "\t"
+            << face.conTr[0] << "\t"
+            << face.conCV[1] << "\t"
+            << face.conTr[1] << "\n";
+    }
+    if(face.conType==2)		// M-F ////////////////////////////
+    {
+        //Con# conType m am i ci ei ki ai=ci*ki/ei-> Tmi=am*ai/(am+ai)
+        out << k << "\t"
+            << face.conType << "\t"
+            << face.conCV[0] << "\t"
+            << face.conTr[0] << "\t"
+            << face.conCV[1] << "\t"
+            << 2.*face.conArea[1]  << "\t"
+            << face.zVolumeFactor[1] << "\t"
+            << face.conPerm[1] << "\t"
+            << "\n";
+    }
+    return true;
+    }
+  if(face.conType==3)	// F-F /////////////////////////////////////////////////
+    {
+     //Con# conType i ci ei ki j cj ej kj N n cn en kn
+     //ai=ci*ki*ei aj=cj*kj*ej an=cn*kn*en
+     //-> Tij=ai*aj/(SUM an)
+     //
+      std::size_t j = 0;
+      std::size_t n = 1;
+      std::size_t conN = face.conCV.size();
+      out << k << "\t"
+        << face.conType << "\t"
+        << face.conCV[j] << "\t"
+        << face.conTr[j]/(face.conPerm[j]*face.zVolumeFactor[j]) << "\t"
+        << face.zVolumeFactor[j] << "\t"
+        << face.conPerm[j]  << "\t"
+        << face.conCV[n] << "\t"
+        << face.conTr[n]/(face.conPerm[n]*face.zVolumeFactor[n])<< "\t"
+        << face.zVolumeFactor[n] << "\t"
+        << face.conPerm[n] << "\t"
+        << face.conCV[n] << "\t";
+      for(std::size_t m=0; m< conN; m++)
+        out << face.conCV[m] << "\t"
+            << face.conTr[m]/(face.conPerm[m]*face.zVolumeFactor[m]) << "\t"
+            << face.zVolumeFactor[m] << "\t"
+            << face.conPerm[m] << "\t";
+      out << "\n";
+      return true;
+     }
+  return false;
+}
+
 }
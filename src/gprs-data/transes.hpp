@@ -27,6 +27,12 @@
 #include <time.h>
 
 
+namespace IO
+{
+class BufferedWriter;
+}
+
+
 namespace flow
 {
 
@@ -44,6 +50,16 @@ public:
   void compute_flow_data();
   static void save_output(const FlowData    & data,
                           const std::string & output_dir);
+  // write one line of TPFACONNS keyword
+  static void write_connection(IO::BufferedWriter & out,
+                               const std::size_t    ielement,
+                               const std::size_t    jelement,
+                               const FaceData     & face);
+  // write entry k of GMUPDATETRANS keyword
+  // returns false if the connection type has no geometric data
+  static bool write_geometric_data(IO::BufferedWriter & out,
+                                   const std::size_t    k,
+                                   const FaceData     & face);
   // this guy writes text output in a series of files
   void writeOutputFiles(const std::string & output_path) const;
   void extractData(FlowData & data) const;
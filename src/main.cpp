@@ -1,18 +1,269 @@
-#include <gprs-data/simdata.hpp>
-#include <gprs-data/OutputDataGPRS.hpp>
-#include "gprs-data/OutputDataVTK.hpp"
+#include <engine/Engine.hpp>
 #include <parsers/JsonParser.hpp>
 #include <parsers/YamlParser.hpp>
 #include <uint256/uint256_t.h>
 #include <parsers/GmshReader.hpp>
+#include <parsers/MeshCache.hpp>
 #include <mesh/Mesh.hpp>
+#include <profiling/Profiler.hpp>
+#include <parallel/ThreadPool.hpp>
 
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <experimental/filesystem>
 
 namespace filesystem = std::experimental::filesystem;
 using Path = filesystem::path;
 
+// read json or yaml config
+SimdataConfig parse_config(const std::string & fname_config)
+{
+  std::cout << "parsing " << fname_config << std::endl;
+  const profiling::ScopedTimer timer("parse config");
+  const std::size_t str_len = fname_config.size();
+  SimdataConfig config;
+  if (fname_config.substr(str_len - 4, str_len) == "json")
+  {
+    Parsers::JsonParser parser;
+    parser.parse_file(fname_config);
+    config = parser.get_config();
+  }
+  else if (fname_config.substr(str_len - 4, str_len) == "yaml")
+  {
+    std::cout << "warning: yaml parser is still experimental" << std::endl;
+    Parsers::YamlParser parser;
+    parser.parse_file(fname_config);
+    config = parser.get_config();
+  }
+
+  // files named in the config are relative to it, not to the working directory
+  const Path config_dir_path = filesystem::absolute(Path(fname_config)).parent_path();
+  for (auto & source : config.property_files)
+    if (Path(source.file).is_relative())
+      source.file = config_dir_path / source.file;
+  return config;
+}
+
+
+// read gmsh file (or its binary cache)
+// throws if the file cannot be read
+void read_mesh(const std::string & fname_gmsh, const bool use_cache, mesh::Mesh & msh)
+{
+  std::cout << "reading " << fname_gmsh << std::endl;
+  const profiling::ScopedTimer timer("read mesh");
+  const std::string fname_cache = fname_gmsh + ".cache";
+  std::uint64_t mesh_hash = 0;
+  bool cached = false;
+  if (use_cache)
+  {
+    mesh_hash = Parsers::MeshCache::file_hash(fname_gmsh);
+    cached = Parsers::MeshCache::load(fname_cache, mesh_hash, msh);
+    if (cached)
+      std::cout << "loaded mesh from cache " << fname_cache << std::endl;
+  }
+
+  if (!cached)
+  {
+    Parsers::GmshReader::read_input(fname_gmsh, msh);
+    if (use_cache)
+      try
+      {
+        std::cout << "saving mesh cache " << fname_cache << std::endl;
+        Parsers::MeshCache::save(fname_cache, mesh_hash, msh);
+      }
+      catch (const std::runtime_error & e)
+      {
+        std::cout << "warning: " << e.what() << std::endl;
+      }
+  }
+}
+
+
+// results of expensive stages are kept next to the config
+void setup_stage_cache(const Path & config_dir_path, SimdataConfig & config)
+{
+  if (!config.stage_cache) return;
+  const Path stage_cache_path = config_dir_path / ".msh2gprs-cache";
+  std::error_code error;
+  filesystem::create_directories(stage_cache_path, error);
+  if (!error)
+  {
+    config.stage_cache_dir = filesystem::absolute(stage_cache_path);
+    std::cout << "stage cache: " << config.stage_cache_dir << std::endl;
+  }
+  else
+    std::cout << "warning: cannot create " << stage_cache_path << std::endl;
+}
+
+
+// run all preprocessing stages and write the output files into output_dir
+void run_pipeline(engine::Engine & preprocessor, const std::string & output_dir)
+{
+  // do preprocessing
+  preprocessor.run();
+
+  std::cout << "output directory: " << output_dir << std::endl;
+  // if no frac remove vtk files
+  if (preprocessor.embedded_fractures().empty())
+    for (const std::string efrac_vtk_file : {"efrac.vtk", "efrac.vtu"})
+      if (filesystem::exists(output_dir + efrac_vtk_file))
+      {
+        std::cout << "cleanup old " << efrac_vtk_file << " file" << std::endl;
+        filesystem::remove(output_dir + efrac_vtk_file);
+      }
+  if (preprocessor.sim_data().n_flow_dfm_faces == 0)
+    for (const std::string dfm_vtk_file : {"dfm.vtk", "dfm.vtu"})
+      if (filesystem::exists(output_dir + dfm_vtk_file))
+      {
+        std::cout << "cleanup old " << dfm_vtk_file << " file" << std::endl;
+        filesystem::remove(output_dir + dfm_vtk_file);
+      }
+
+  // OUPUT
+  preprocessor.write_output(output_dir);
+}
+
+
+/* Batch mode: run many configs (realisations) against shared meshes.
+ * Each mesh file is read once. Realisations run n_jobs at a time and write
+ * into <config dir>/<config name>/. They read the shared mesh directly;
+ * only realisations that modify the grid (renumbering, dfm faces) run on
+ * a copy of it. Results of the cached stages (rock properties, reservoir
+ * transmissibilities) are kept in memory for the whole batch: the cached
+ * stages of the first realisation of every mesh run first, and the other
+ * realisations with the same stage inputs reuse them.
+ * Returns the number of failed realisations. */
+std::size_t run_batch(const std::vector<std::string> & config_files, std::size_t n_jobs)
+{
+  struct Realisation
+  {
+    std::string name;
+    SimdataConfig config;
+    std::string output_dir;
+    std::size_t mesh;  // index in meshes
+  };
+
+  std::vector<Realisation> realisations;
+  std::vector<mesh::Mesh> meshes;
+  std::shared_ptr<gprs_data::StageResults> stage_results;
+  std::map<std::string, std::size_t> mesh_indices;  // file -> index in meshes
+  for (const std::string & fname_config : config_files)
+  {
+    const Path path_config(fname_config);
+    if (!filesystem::exists(path_config))
+      throw std::invalid_argument("config file does not exist: " +
+                                  std::string(filesystem::absolute(path_config)));
+
+    Realisation realisation;
+    realisation.name = fname_config;
+    realisation.config = parse_config(fname_config);
+    const Path config_dir_path = filesystem::absolute(path_config).parent_path();
+    setup_stage_cache(config_dir_path, realisation.config);
+    if (!stage_results)
+      stage_results = std::make_shared<gprs_data::StageResults>
+          (realisation.config.stage_cache_max_bytes);
+    realisation.config.shared_stage_results = stage_results;
+    const Path output_path = config_dir_path / path_config.stem();
+    filesystem::create_directories(output_path);
+    realisation.output_dir = std::string(output_path) + "/";
+
+    const std::string fname_gmsh = config_dir_path / realisation.config.mesh_file;
+    auto it = mesh_indices.find(fname_gmsh);
+    if (it == mesh_indices.end())
+    {
+      if (!filesystem::exists(fname_gmsh))
+        throw std::invalid_argument("msh file does not exist: " + fname_gmsh);
+      meshes.emplace_back();
+      read_mesh(fname_gmsh, realisation.config.mesh_cache, meshes.back());
+      if (meshes.back().n_cells() == 0)
+        throw std::invalid_argument("mesh has no cells: " + fname_gmsh);
+      it = mesh_indices.insert({fname_gmsh, meshes.size() - 1}).first;
+    }
+    realisation.mesh = it->second;
+    realisations.push_back(std::move(realisation));
+  }
+
+  // call f with an engine of the realisation
+  const auto with_engine = [&meshes](const Realisation & realisation, const auto & f)
+  {
+    const mesh::Mesh & shared_mesh = meshes[realisation.mesh];
+    if (engine::Engine::modifies_grid(realisation.config))
+    {
+      mesh::Mesh msh = shared_mesh;
+      engine::Engine preprocessor(msh, realisation.config);
+      f(preprocessor);
+    }
+    else
+    {
+      engine::Engine preprocessor(shared_mesh, realisation.config);
+      f(preprocessor);
+    }
+  };
+
+  std::mutex mutex;
+  std::vector<std::string> failed;
+  const auto run = [&](const Realisation & realisation)
+  {
+    try
+    {
+      with_engine(realisation, [&realisation](engine::Engine & preprocessor)
+                  {run_pipeline(preprocessor, realisation.output_dir);});
+    }
+    catch (const std::exception & e)
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      std::cout << "error in " << realisation.name << ": " << e.what() << std::endl;
+      failed.push_back(realisation.name);
+    }
+  };
+
+  // fill the shared stage results: only the cached stages run serially
+  std::vector<bool> mesh_done(meshes.size(), false);
+  for (const auto & realisation : realisations)
+    if (!mesh_done[realisation.mesh])
+    {
+      mesh_done[realisation.mesh] = true;
+      try
+      {
+        with_engine(realisation, [](engine::Engine & preprocessor)
+                    {preprocessor.run(engine::Stage::reservoir_transmissibilities);});
+      }
+      catch (const std::exception &)
+      {
+        // reported when the realisation runs
+      }
+    }
+  std::vector<const Realisation*> queue;
+  for (const auto & realisation : realisations)
+    queue.push_back(&realisation);
+
+  // the rest concurrently
+  if (n_jobs == 0) n_jobs = 1;
+  std::atomic<std::size_t> next(0);
+  const auto worker = [&]
+  {
+    for (std::size_t i = next++; i < queue.size(); i = next++)
+      run(*queue[i]);
+  };
+  std::vector<std::thread> workers;
+  for (std::size_t j = 1; j < std::min(n_jobs, queue.size()); ++j)
+    workers.emplace_back(worker);
+  worker();
+  for (auto & w : workers)
+    w.join();
+
+  std::cout << "batch done: " << realisations.size() - failed.size()
+            << " of " << realisations.size() << " realisations succeeded" << std::endl;
+  for (const auto & name : failed)
+    std::cout << "failed: " << name << std::endl;
+  return failed.size();
+}
+
+
 int main(int argc, char *argv[])
 {
   // process cmd arguments
@@ -21,20 +272,62 @@ int main(int argc, char *argv[])
     std::cout << "please specify a config file."
               << std::endl
               << "Example: "
-              << "msh2gprs config.json"
+              << "msh2gprs config.json [--profile report.json] [--threads N]"
+              << std::endl
+              << "Batch mode (shared mesh, one output directory per config): "
+              << "msh2gprs --batch config1.json config2.json ... [--jobs N]"
               << std::endl
               << "an example config is distributed with this code"
               << std::endl;
     return 0;
   }
-  if (argc > 2)
+
+  // optional json report with stage timings and memory usage
+  std::string fname_profile;
+  std::vector<std::string> config_files;
+  bool batch = false;
+  std::size_t n_jobs = 1;
+  for (int i = 1; i < argc; ++i)
+  {
+    const std::string arg = argv[i];
+    if (arg == "--profile" && i + 1 < argc)
+      fname_profile = argv[++i];
+    else if (arg == "--batch")
+      batch = true;
+    else if (arg == "--jobs" && i + 1 < argc)
+      n_jobs = std::stoul(argv[++i]);
+    else if (arg == "--threads" && i + 1 < argc)  // 0 = all hardware threads
+      parallel::ThreadPool::set_n_threads(std::stoul(argv[++i]));
+    else
+      config_files.push_back(arg);
+  }
+  if (config_files.empty() || (!batch && config_files.size() > 1))
   {
     std::cout << "what the hell did you pass?" << std::endl;
     return 1;
   }
 
+  if (batch)
+  {
+    std::size_t n_failed = 0;
+    try
+    {
+      n_failed = run_batch(config_files, n_jobs);
+    }
+    catch (const std::exception & e)
+    {
+      std::cout << e.what() << std::endl;
+      return 1;
+    }
+    std::cout << std::endl;
+    profiling::Profiler::instance().print_summary(std::cout);
+    if (!fname_profile.empty())
+      profiling::Profiler::instance().write_json(fname_profile);
+    return (n_failed == 0) ? 0 : 1;
+  }
+
   // config file
-  const std::string fname_config = argv[1];
+  const std::string fname_config = config_files[0];
   const Path path_config(fname_config);
   if (!filesystem::exists(path_config))
   {
@@ -43,22 +336,7 @@ int main(int argc, char *argv[])
     return 0;
   }
 
-  std::cout << "parsing " << fname_config << std::endl;
-  const std::size_t str_len = fname_config.size();
-  SimdataConfig config;
-  if (fname_config.substr(str_len - 4, str_len) == "json")
-  {
-    Parsers::JsonParser parser;
-    parser.parse_file(fname_config);
-    config = parser.get_config();
-  }
-  else if (fname_config.substr(str_len - 4, str_len) == "yaml")
-  {
-    std::cout << "warning: yaml parser is still experimental" << std::endl;
-    Parsers::YamlParser parser;
-    parser.parse_file(fname_config);
-    config = parser.get_config();
-  }
+  SimdataConfig config = parse_config(fname_config);
 
   // MESH
   // get path of the config file -- mesh is searched for in relative path
@@ -73,12 +351,10 @@ int main(int argc, char *argv[])
     return 0;
   }
 
-  std::cout << "reading ";
-  std::cout << filesystem::absolute(path_gmsh) << std::endl;
   mesh::Mesh msh;
   try
   {
-    Parsers::GmshReader::read_input(filesystem::absolute(path_gmsh), msh);
+    read_mesh(filesystem::absolute(path_gmsh), config.mesh_cache, msh);
   }
   catch (std::exception & e)
   {
@@ -93,86 +369,18 @@ int main(int argc, char *argv[])
     return 0;
   }
 
-  // do preprocessing
-  gprs_data::SimData preprocessor = gprs_data::SimData(msh, config);
-
-  cout << "Fill 3D rock properties" << endl;
-  preprocessor.defineRockProperties();
-
-  cout << "Make SDA properties" << endl;
-  preprocessor.defineEmbeddedFractureProperties();
-
-  cout << "Create physical facets" << endl;
-  preprocessor.definePhysicalFacets();
-
-  std::cout << "computing reservoir transes" << std::endl;
-  preprocessor.computeReservoirTransmissibilities();
-
-  std::cout << "Handle flow embedded fractures" << std::endl;
-  preprocessor.handleEmbeddedFractures();
-
-  // timur's legacy
-  // cout << "Create simple wells" << endl;
-  // pSimData->createSimpleWells();
-
-  std::cout << "Setup wells" << std::endl;
-  preprocessor.setupWells();
-
-  if (preprocessor.dfm_faces.size() > 0)
-  {
-    cout << "Split FEM mesh on internal surfaces" << endl;
-    preprocessor.splitInternalFaces();
-  }
-
-  std::cout << "compute connections between mech and flow elements" << std::endl;
-  preprocessor.handleConnections();
-
-  // multiscale
-  std::cout << "build multiscale data" << std::endl;
-  preprocessor.build_multiscale_data();
+  setup_stage_cache(config_dir_path, config);
 
   const std::string output_dir = std::string(filesystem::absolute(config_dir_path)) + "/";
-  std::cout << "output directory: " << output_dir << std::endl;
-  // if no frac remove vtk files
-  if (preprocessor.vEfrac.empty())
-  {
-    const std::string efrac_vtk_file = output_dir + "efrac.vtk";
-    if (filesystem::exists(efrac_vtk_file))
-    {
-      std::cout << "cleanup old efrac.vtk file" << std::endl;
-      filesystem::remove(efrac_vtk_file);
-    }
-  }
-  if (preprocessor.n_flow_dfm_faces == 0)
-  {
-    const std::string dfm_vtk_file = output_dir + "dfm.vtk";
-    if (filesystem::exists(dfm_vtk_file))
-    {
-      std::cout << "cleanup old dfm.vtk file" << std::endl;
-      filesystem::remove(dfm_vtk_file);
-    }
-  }
+  engine::Engine preprocessor(msh, config);
+  run_pipeline(preprocessor, output_dir);
 
-  // OUPUT
-  cout << "Write Output data\n";
-  for (auto format : config.output_formats)
-  {
-    switch (format) {
-      case OutputFormat::gprs :
-        {
-          std::cout << "Output gprs format" << std::endl;
-          gprs_data::OutputDataGPRS output_data(preprocessor, msh);
-          output_data.write_output(output_dir);
-          break;
-        }
-        case OutputFormat::vtk :
-          {
-            std::cout << "Output vtk format" << std::endl;
-            gprs_data::OutputDataVTK output_data(preprocessor, msh);
-            output_data.write_output(output_dir);
-            break;
-          }
-    }
+  std::cout << std::endl;
+  profiling::Profiler::instance().print_summary(std::cout);
+  if (!fname_profile.empty())
+  {
+    std::cout << "saving profiling report " << fname_profile << std::endl;
+    profiling::Profiler::instance().write_json(fname_profile);
   }
 
   return 0;
@@ -0,0 +1,112 @@
+#include "CellBucketGrid.hpp"
+
+#include <algorithm>  // std::max, std::min, std::sort
+#include <cmath>      // std::cbrt, std::ceil, std::floor
+
+namespace mesh
+{
+
+CellBucketGrid::CellBucketGrid(const CellGeometryCache & geometry,
+                               const std::size_t cells_per_bucket)
+    :
+    origin(geometry.domain_min())
+{
+  const Point extent = geometry.domain_max() - geometry.domain_min();
+  const double max_extent = std::max({extent[0], extent[1], extent[2], 0.0});
+  if (geometry.size() == 0 || max_extent <= 0)
+  {
+    size = {1, 1, 1};
+    offsets.assign(2, 0);
+    cells.resize(geometry.size());
+    for (std::size_t icell = 0; icell < geometry.size(); ++icell)
+      cells[icell] = icell;
+    offsets[1] = cells.size();
+    return;
+  }
+
+  // cubic buckets; flat domains (e.g. 2D meshes) are one bucket thick
+  const double min_extent = 1e-3 * max_extent;
+  const double volume = std::max(extent[0], min_extent) * std::max(extent[1], min_extent) *
+                        std::max(extent[2], min_extent);
+  const double n_buckets = std::max(1.0, double(geometry.size()) /
+                                    std::max(cells_per_bucket, std::size_t(1)));
+  const double edge = std::cbrt(volume / n_buckets);
+  for (int i = 0; i < 3; ++i)
+  {
+    dims[i] = std::max(std::size_t(1), static_cast<std::size_t>(std::ceil(extent[i] / edge)));
+    size[i] = (extent[i] > 0) ? extent[i] / dims[i] : edge;
+  }
+
+  // two passes: count the cells of every bucket, then fill the rows
+  offsets.assign(dims[0] * dims[1] * dims[2] + 1, 0);
+  for (int pass = 0; pass < 2; ++pass)
+  {
+    for (std::size_t icell = 0; icell < geometry.size(); ++icell)
+    {
+      const auto ri = bucket_range(geometry.bbox_min(icell)[0], geometry.bbox_max(icell)[0], 0);
+      const auto rj = bucket_range(geometry.bbox_min(icell)[1], geometry.bbox_max(icell)[1], 1);
+      const auto rk = bucket_range(geometry.bbox_min(icell)[2], geometry.bbox_max(icell)[2], 2);
+      for (std::size_t k = rk.first; k <= rk.second; ++k)
+        for (std::size_t j = rj.first; j <= rj.second; ++j)
+          for (std::size_t i = ri.first; i <= ri.second; ++i)
+          {
+            const std::size_t b = bucket_index(i, j, k);
+            if (pass == 0)
+              offsets[b + 1]++;
+            else
+              cells[offsets[b]++] = icell;
+          }
+    }
+
+    if (pass == 0)
+    {
+      for (std::size_t b = 1; b < offsets.size(); ++b)
+        offsets[b] += offsets[b - 1];
+      cells.resize(offsets.back());
+    }
+  }
+  // filling advanced offsets[b] to the end of row b: shift back
+  std::copy_backward(offsets.begin(), offsets.end() - 1, offsets.end());
+  offsets[0] = 0;
+}
+
+
+std::pair<std::size_t,std::size_t>
+CellBucketGrid::bucket_range(const double lo, const double hi, const int i) const
+{
+  const auto coordinate = [this, i](const double x)
+  {
+    const double c = std::floor((x - origin[i]) / size[i]);
+    if (c <= 0) return std::size_t(0);
+    return std::min(static_cast<std::size_t>(c), dims[i] - 1);
+  };
+  return {coordinate(lo), coordinate(hi)};
+}
+
+
+std::vector<std::size_t> CellBucketGrid::cells_in_box(const Point & lo, const Point & hi) const
+{
+  std::vector<std::size_t> result;
+  const auto ri = bucket_range(lo[0], hi[0], 0);
+  const auto rj = bucket_range(lo[1], hi[1], 1);
+  const auto rk = bucket_range(lo[2], hi[2], 2);
+  for (std::size_t k = rk.first; k <= rk.second; ++k)
+    for (std::size_t j = rj.first; j <= rj.second; ++j)
+      for (std::size_t i = ri.first; i <= ri.second; ++i)
+      {
+        const std::size_t b = bucket_index(i, j, k);
+        result.insert(result.end(), cells.begin() + offsets[b], cells.begin() + offsets[b + 1]);
+      }
+  // cells that span several buckets are listed in each of them
+  std::sort(result.begin(), result.end());
+  result.erase(std::unique(result.begin(), result.end()), result.end());
+  return result;
+}
+
+
+double CellBucketGrid::bucket_size() const
+{
+  return std::min({size[0], size[1], size[2]});
+}
+
+}  // end namespace mesh
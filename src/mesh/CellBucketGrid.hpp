@@ -0,0 +1,41 @@
+#pragma once
+
+#include "CellGeometryCache.hpp"
+
+#include <array>
+
+namespace mesh
+{
+
+/* Uniform grid of buckets over the domain of a CellGeometryCache.
+ * Every cell is listed in all buckets its bounding box touches,
+ * so the cells near a box are found without a scan over all cells.
+ * Note: the buckets are not updated when the mesh is modified */
+class CellBucketGrid
+{
+ public:
+  // about cells_per_bucket cells in a bucket on average
+  explicit CellBucketGrid(const CellGeometryCache & geometry,
+                          const std::size_t cells_per_bucket = 4);
+  // cells whose bounding boxes may touch the box [lo, hi] (sorted, each once)
+  std::vector<std::size_t> cells_in_box(const Point & lo, const Point & hi) const;
+  // smallest bucket edge
+  double bucket_size() const;
+
+ private:
+  // range of bucket coordinates covered by [lo, hi] along axis i
+  std::pair<std::size_t,std::size_t> bucket_range(const double lo, const double hi,
+                                                  const int i) const;
+  inline std::size_t bucket_index(const std::size_t i, const std::size_t j,
+                                  const std::size_t k) const
+  {return i + dims[0] * (j + dims[1] * k);}
+
+  Point origin;
+  Point size;  // bucket edges
+  std::array<std::size_t,3> dims = {1, 1, 1};
+  // cells of bucket b are cells[offsets[b]:offsets[b+1]]
+  std::vector<std::size_t> offsets;
+  std::vector<std::size_t> cells;
+};
+
+}  // end namespace mesh
@@ -0,0 +1,59 @@
+#include "CellGeometryCache.hpp"
+#include "parallel/parallel_for.hpp"
+
+#include <limits>   // std::numeric_limits
+#include <utility>  // std::pair
+
+namespace mesh
+{
+
+CellGeometryCache::CellGeometryCache(const Mesh & grid, const std::size_t n_threads)
+    :
+    centers(grid.n_cells()),
+    lower(grid.n_cells()),
+    upper(grid.n_cells())
+{
+  const double max = std::numeric_limits<double>::max();
+  const auto & coord = grid.get_vertices();
+
+  parallel::parallel_for(0, grid.n_cells(), [&](const std::size_t icell)
+  {
+    const auto & ivertices = grid.cells[icell];
+    Point c = {0, 0, 0};
+    Point lo = {max, max, max};
+    Point hi = {-max, -max, -max};
+    for (const std::size_t v : ivertices)
+    {
+      const Point & p = coord[v];
+      c += p;
+      for (int i = 0; i < 3; ++i)
+      {
+        lo[i] = std::min(lo[i], p[i]);
+        hi[i] = std::max(hi[i], p[i]);
+      }
+    }
+    c /= static_cast<double>(ivertices.size());
+    centers[icell] = c;
+    lower[icell] = lo;
+    upper[icell] = hi;
+  }, n_threads);
+
+  // whole domain: use all the vertices, not just the cell ones
+  using Box = std::pair<Point, Point>;
+  const Box domain = parallel::parallel_reduce(0, coord.size(),
+      Box({max, max, max}, {-max, -max, -max}),
+      [&coord](const std::size_t v) {return Box(coord[v], coord[v]);},
+      [](Box a, const Box & b)
+      {
+        for (int i = 0; i < 3; ++i)
+        {
+          a.first[i] = std::min(a.first[i], b.first[i]);
+          a.second[i] = std::max(a.second[i], b.second[i]);
+        }
+        return a;
+      });
+  domain_lower = domain.first;
+  domain_upper = domain.second;
+}
+
+}  // end namespace mesh
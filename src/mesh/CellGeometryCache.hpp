@@ -0,0 +1,40 @@
+#pragma once
+
+#include "Mesh.hpp"
+
+namespace mesh
+{
+
+/* Cached cell centroids and axis-aligned bounding boxes.
+ * Computed once (in parallel) so that algorithms that need
+ * cell centers many times do not allocate vertex vectors
+ * and recompute them on every call.
+ * Note: the cache is not updated when the mesh is modified */
+class CellGeometryCache
+{
+ public:
+  // compute centroids and bounding boxes of all cells in grid
+  // n_threads = 0 means use all hardware threads
+  explicit CellGeometryCache(const Mesh & grid, const std::size_t n_threads = 0);
+  // number of cached cells
+  inline std::size_t size() const {return centers.size();}
+  // cell center of mass (same as cell_iterator::center())
+  inline const Point & center(const std::size_t icell) const {return centers[icell];}
+  // lower corner of the cell bounding box
+  inline const Point & bbox_min(const std::size_t icell) const {return lower[icell];}
+  // upper corner of the cell bounding box
+  inline const Point & bbox_max(const std::size_t icell) const {return upper[icell];}
+  // lower corner of the bounding box of the whole grid
+  inline const Point & domain_min() const {return domain_lower;}
+  // upper corner of the bounding box of the whole grid
+  inline const Point & domain_max() const {return domain_upper;}
+  // vector of all cell centers
+  inline const std::vector<Point> & get_centers() const {return centers;}
+
+ private:
+  std::vector<Point> centers;
+  std::vector<Point> lower, upper;
+  Point domain_lower, domain_upper;
+};
+
+}  // end namespace mesh
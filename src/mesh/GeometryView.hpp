@@ -0,0 +1,151 @@
+#pragma once
+
+#include "angem/Point.hpp"
+#include "angem/PolyhedronFactory.hpp"
+
+#include <cmath>   // std::fabs
+#include <limits>  // std::numeric_limits
+#include <vector>
+
+namespace mesh
+{
+
+/* Non-owning geometry of a mesh element.
+ * References the mesh vertex array and the element vertex indices,
+ * so creating a view and computing its center, bounding box or support
+ * point does not allocate (unlike building an angem::Polygon or
+ * angem::Polyhedron). The view is invalidated when the mesh is modified. */
+class ElementGeometry
+{
+ public:
+  ElementGeometry(const std::vector<angem::Point<3,double>> & vertices,
+                  const std::vector<std::size_t>            & indices)
+      : vertices(vertices), indices(indices)
+  {}
+  // number of element vertices
+  std::size_t n_vertices() const {return indices.size();}
+  // coordinates of the i-th element vertex
+  const angem::Point<3,double> & vertex(const std::size_t i) const {return vertices[indices[i]];}
+  // vertex average
+  angem::Point<3,double> center() const
+  {
+    angem::Point<3,double> c = {0, 0, 0};
+    for (const std::size_t v : indices)
+      c += vertices[v];
+    c /= static_cast<double>(indices.size());
+    return c;
+  }
+  // axis-aligned bounding box
+  void bounding_box(angem::Point<3,double> & lower, angem::Point<3,double> & upper) const
+  {
+    const double max = std::numeric_limits<double>::max();
+    lower = {max, max, max};
+    upper = {-max, -max, -max};
+    for (const std::size_t v : indices)
+      for (int i = 0; i < 3; ++i)
+      {
+        lower[i] = std::min(lower[i], vertices[v][i]);
+        upper[i] = std::max(upper[i], vertices[v][i]);
+      }
+  }
+  // vertex farthest in the given direction (support function for collision checks)
+  const angem::Point<3,double> & support(const angem::Point<3,double> & direction) const
+  {
+    std::size_t best = 0;
+    for (std::size_t i = 1; i < indices.size(); ++i)
+      if (vertex(i).dot(direction) > vertex(best).dot(direction))
+        best = i;
+    return vertex(best);
+  }
+
+ protected:
+  const std::vector<angem::Point<3,double>> & vertices;
+  const std::vector<std::size_t>            & indices;
+};
+
+
+/* Face view: vertex indices must be ordered along the face boundary
+ * (Face::ordered_indices) */
+class FaceGeometry : public ElementGeometry
+{
+ public:
+  using ElementGeometry::ElementGeometry;
+  // normal times area (Newell's method, also fine for slightly warped faces)
+  angem::Point<3,double> area_vector() const
+  {
+    const angem::Point<3,double> c = center();
+    angem::Point<3,double> result = {0, 0, 0};
+    for (std::size_t i = 0; i < n_vertices(); ++i)
+      result += (vertex(i) - c).cross(vertex((i + 1) % n_vertices()) - c);
+    result *= 0.5;
+    return result;
+  }
+  double area() const {return area_vector().norm();}
+  // unit normal; orientation follows the vertex order
+  angem::Point<3,double> normal() const
+  {
+    angem::Point<3,double> n = area_vector();
+    n /= n.norm();
+    return n;
+  }
+};
+
+
+/* Cell view. Volume is computed without allocation for linear
+ * tetrahedra, hexahedra, wedges and pyramids (vtk ordering), and
+ * through angem::PolyhedronFactory for other shapes */
+class CellGeometry : public ElementGeometry
+{
+ public:
+  CellGeometry(const std::vector<angem::Point<3,double>> & vertices,
+               const std::vector<std::size_t>            & indices,
+               const int                                   vtk_id)
+      : ElementGeometry(vertices, indices), vtk_id(vtk_id)
+  {}
+  double volume() const
+  {
+    // local faces of standard cells; -1 terminates triangles
+    static const int tetra[4][4] = {{0, 1, 2, -1}, {0, 1, 3, -1}, {1, 2, 3, -1}, {0, 2, 3, -1}};
+    static const int hexahedron[6][4] = {{0, 1, 2, 3}, {4, 5, 6, 7}, {0, 1, 5, 4},
+                                         {1, 2, 6, 5}, {2, 3, 7, 6}, {3, 0, 4, 7}};
+    static const int wedge[5][4] = {{0, 1, 2, -1}, {3, 4, 5, -1}, {0, 1, 4, 3},
+                                    {1, 2, 5, 4}, {2, 0, 3, 5}};
+    static const int pyramid[5][4] = {{0, 1, 2, 3}, {0, 1, 4, -1}, {1, 2, 4, -1},
+                                      {2, 3, 4, -1}, {3, 0, 4, -1}};
+    switch (vtk_id)
+    {
+      case 10: return pyramids_volume(tetra, 4);
+      case 12: return pyramids_volume(hexahedron, 6);
+      case 13: return pyramids_volume(wedge, 5);
+      case 14: return pyramids_volume(pyramid, 5);
+      default:
+        return angem::PolyhedronFactory::create<double>(vertices, indices, vtk_id)->volume();
+    }
+  }
+
+ private:
+  // sum of pyramids with the faces as bases and the cell center as apex
+  // (exact for convex cells with planar faces)
+  double pyramids_volume(const int faces[][4], const int n_faces) const
+  {
+    const angem::Point<3,double> c = center();
+    double result = 0;
+    for (int f = 0; f < n_faces; ++f)
+    {
+      const int n = (faces[f][3] < 0) ? 3 : 4;
+      angem::Point<3,double> face_center = {0, 0, 0};
+      angem::Point<3,double> area = {0, 0, 0};
+      for (int i = 0; i < n; ++i)
+        face_center += vertex(faces[f][i]);
+      face_center /= static_cast<double>(n);
+      for (int i = 0; i < n; ++i)
+        area += (vertex(faces[f][i]) - face_center).cross(vertex(faces[f][(i + 1) % n]) - face_center);
+      result += std::fabs(0.5 * area.dot(face_center - c)) / 3.0;
+    }
+    return result;
+  }
+
+  const int vtk_id;
+};
+
+}  // end namespace mesh
@@ -41,15 +41,17 @@ void Mesh::insert(const Polyhedron & poly,
     auto iter = map_faces.find(hash);
     if (iter != map_faces.end())
     {
-      (iter->second).neighbors.push_back(new_element_index);
+      faces[iter->second].neighbors.push_back(new_element_index);
     }
     else
     {
       Face face_data;
       face_data.neighbors.push_back(new_element_index);
-      face_data.index = map_faces.size();
+      face_data.index = faces.size();
       face_data.old_index = face_data.index;
-      map_faces.insert({ {hash, face_data} });
+      face_data.ordered_indices = face_glob;
+      map_faces.insert({hash, face_data.index});
+      faces.push_back(std::move(face_data));
     }
   }
 }
@@ -73,12 +75,12 @@ void Mesh::insert_cell(const std::vector<std::size_t> & ivertices,
     const auto hash = hash_value(face);
     auto iter = map_faces.find(hash);
     if (iter != map_faces.end())
-      (iter->second).neighbors.push_back(new_element_index);
+      faces[iter->second].neighbors.push_back(new_element_index);
     else
     {
       Face face_data;
       face_data.neighbors.push_back(new_element_index);
-      face_data.index = map_faces.size();
+      face_data.index = faces.size();
       face_data.old_index = face_data.index;
       face_data.ordered_indices = face;
       switch (face.size())
@@ -93,7 +95,8 @@ void Mesh::insert_cell(const std::vector<std::size_t> & ivertices,
           face_data.vtk_id = 7;  //  vtk_polygon
           break;
       }
-      map_faces.insert({ {hash, face_data} });
+      map_faces.insert({hash, face_data.index});
+      faces.push_back(std::move(face_data));
     }
   }
 }
@@ -112,7 +115,7 @@ const std::vector<std::size_t> & Mesh::get_neighbors( const FaceiVertices & face
     throw std::out_of_range("face does not exist");
   }
 
-  return iter->second.neighbors;
+  return faces[iter->second].neighbors;
 }
 
 
@@ -167,15 +170,16 @@ void Mesh::insert_face(const std::vector<std::size_t> & ivertices,
     Face face_data;
     face_data.marker = marker;
     face_data.vtk_id = vtk_id;
-    face_data.index = map_faces.size();
+    face_data.index = faces.size();
     face_data.old_index = face_data.index;
     face_data.ordered_indices = ivertices;
-    map_faces.insert({hash, face_data});
+    map_faces.insert({hash, face_data.index});
+    faces.push_back(std::move(face_data));
   }
   else
   {
-    it->second.marker = marker;
-    it->second.vtk_id = vtk_id;
+    faces[it->second].marker = marker;
+    faces[it->second].vtk_id = vtk_id;
   }
 }
 
@@ -296,7 +300,7 @@ SurfaceMesh<double> Mesh::split_faces()
   std::unordered_map<std::size_t, hash_type> map_2d_3d;
   for (const auto & hash : marked_for_split)
   {
-    face_iterator face = create_face_iterator(map_faces.find(hash));
+    face_iterator face = create_face_iterator(map_faces.find(hash)->second);
     Polygon poly(face.vertices());
     const std::size_t ielement = mesh_faces.insert(poly);
     map_2d_3d.insert({ielement, hash});
@@ -363,7 +367,10 @@ SurfaceMesh<double> Mesh::split_faces()
 
   // store it since new faces are added first and then old faces are deleted
   // which may cause wrong indexing
-  std::size_t num_faces = map_faces.size();
+  std::size_t num_faces = faces.size();
+  // new faces are kept aside until the old faces are deleted,
+  // since they can take over the indices of the deleted faces
+  std::unordered_map<hash_type, Face> new_faces;
   for (const auto it_cell : map_old_new_cells)
   {
     const std::size_t icell = it_cell.first;
@@ -403,20 +410,23 @@ SurfaceMesh<double> Mesh::split_faces()
 
       if (new_hash != old_hash) // face changed
       {
+        auto it_new_face = new_faces.find(new_hash);
         auto it_face = map_faces.find(new_hash);
-        auto it_face_old = map_faces.find(old_hash);
+        const Face & old_face = faces[map_faces.find(old_hash)->second];
 
-        if (it_face == map_faces.end())
+        if (it_new_face != new_faces.end())
+          it_new_face->second.neighbors.push_back(icell);
+        else if (it_face == map_faces.end())
         {
           Face new_face;
           new_face.neighbors.push_back(icell);
-          new_face.marker = it_face_old->second.marker;
+          new_face.marker = old_face.marker;
           new_face.ordered_indices = new_poly_faces[i];
 
-          new_face.index = it_face_old->second.index;
-          if (old_ind_touched.insert(it_face_old->second.index).second) // if not inserted yet
+          new_face.index = old_face.index;
+          if (old_ind_touched.insert(old_face.index).second) // if not inserted yet
           {
-            new_face.index = it_face_old->second.index;
+            new_face.index = old_face.index;
             if (faces_to_not_delete.find( old_hash ) != faces_to_not_delete.end())
               new_face.index = num_faces++;
           }
@@ -425,12 +435,12 @@ SurfaceMesh<double> Mesh::split_faces()
             new_face.index = num_faces++;
           }
 
-          new_face.old_index = it_face_old->second.old_index;
-          new_face.vtk_id = it_face_old->second.vtk_id;
-          map_faces.insert({new_hash, new_face});
+          new_face.old_index = old_face.old_index;
+          new_face.vtk_id = old_face.vtk_id;
+          new_faces.insert({new_hash, std::move(new_face)});
         }
         else
-          it_face->second.neighbors.push_back(icell);
+          faces[it_face->second].neighbors.push_back(icell);
 
         // mark old faces for delete
         faces_to_delete.insert(old_hash);
@@ -442,16 +452,36 @@ SurfaceMesh<double> Mesh::split_faces()
   }
 
   // remove marked old faces from map
+  std::vector<bool> vacant(faces.size(), false);
   for (auto & hash : faces_to_delete)
     if (faces_to_not_delete.find(hash) == faces_to_not_delete.end())
     {
       auto face_it = map_faces.find(hash);
       if (face_it != map_faces.end())
       {
+        vacant[face_it->second] = true;
         map_faces.erase(face_it);
       }
     }
 
+  // put new faces into the slots of the deleted ones or append them
+  if (num_faces > faces.size())
+  {
+    faces.resize(num_faces);
+    vacant.resize(num_faces, true);
+  }
+  for (auto & it : new_faces)
+  {
+    const std::size_t index = it.second.index;
+    if (!vacant[index])
+      throw std::runtime_error("face index " + std::to_string(index) + " is taken after split");
+    vacant[index] = false;
+    map_faces.insert({it.first, index});
+    faces[index] = std::move(it.second);
+  }
+  if (std::find(vacant.begin(), vacant.end(), true) != vacant.end())
+    throw std::runtime_error("face indices are not contiguous after split");
+
   //  clear marked elements vector
   marked_for_split.clear();      
   return mesh_faces;
@@ -500,9 +530,7 @@ Mesh::group_cells_based_on_split_faces(const std::unordered_set<std::size_t> & a
         bool neighbor_by_marked_face = false;
         for (const auto & face : vertex_faces)
         {
-          const auto it = map_faces.find(face.hash());
-
-          if (it->second.neighbors == ordered_neighbors)
+          if (face.neighbors() == ordered_neighbors)
           {
             neighbor_by_marked_face = true;
             break;
@@ -539,9 +567,10 @@ Mesh::group_cells_based_on_split_faces(const std::unordered_set<std::size_t> & a
 
 std::vector<face_iterator> Mesh::get_ordered_faces()
 {
-  std::vector<face_iterator> ordered_faces(this->n_faces(), this->begin_faces());
+  std::vector<face_iterator> ordered_faces;
+  ordered_faces.reserve(n_faces());
   for (auto face=begin_faces(); face!=end_faces(); ++face)
-    ordered_faces[face.index()] = face;
+    ordered_faces.push_back(face);
   return ordered_faces;
 }
 
@@ -554,7 +583,7 @@ void Mesh::add_vertex_to_split(const std::size_t
   auto & faces = vertices_to_split[vertex];
   for (const auto & neighbor : edge_neighbors)
   {
-    auto it = create_face_iterator(map_faces.find(map_2d_3d.find(neighbor)->second));
+    auto it = create_face_iterator(map_faces.find(map_2d_3d.find(neighbor)->second)->second);
     if (find(faces.begin(), faces.end(), it) == faces.end())
       faces.push_back(std::move(it));
   }
@@ -29,9 +29,9 @@ using FaceiVertices = std::vector<std::size_t>;
 /* This class implements a structure for unstructure grid storage
  * It features constant lookup and insertion times
  * for faces, cells, and their neighbors.
- * Due to this feature though, the order of faces is not guaranteed
- * so that unordered_map[hash]->value should be used to store
- * data related to faces
+ * Face records are stored in a dense array in the order of face indices
+ * (faces[i].index == i), and map_faces only maps face hashes to indices,
+ * so face traversal is a contiguous scan in index order.
  */
 class Mesh
 {
@@ -59,7 +59,7 @@ class Mesh
   // Helper function to create cell iterators.
   // Still thinking whether it should be a public method
   cell_iterator create_cell_iterator(const std::size_t icell)
-  {return cell_iterator(icell, vertices, cells, map_faces,
+  {return cell_iterator(icell, vertices, cells, faces, map_faces,
                         shape_ids, cell_markers);}
   // create cell iterator for the first cell
   cell_iterator begin_cells(){return create_cell_iterator(0);}
@@ -68,7 +68,7 @@ class Mesh
   // CONST_ITERATORS
   // Helper function to create cell const_iterators.
   const_cell_iterator create_const_cell_iterator(const std::size_t icell) const
-  {return const_cell_iterator(icell, vertices, cells, map_faces,
+  {return const_cell_iterator(icell, vertices, cells, faces, map_faces,
                               shape_ids, cell_markers);}
   // create cell iterator for the first cell
   const_cell_iterator begin_cells() const {return create_const_cell_iterator(0);}
@@ -77,23 +77,20 @@ class Mesh
 
   // face iterators
   // A helper funciton to create face iterators
- private:
-  face_iterator create_face_iterator(const FaceMap::iterator & it)
-  {return face_iterator(it, vertices);}
- public:
-  // create a face iterator
-  face_iterator begin_faces(){return create_face_iterator(map_faces.begin());}
+  face_iterator create_face_iterator(const std::size_t iface)
+  {return face_iterator(faces.begin() + iface, vertices);}
+  // create a face iterator (faces are traversed in index order)
+  face_iterator begin_faces(){return create_face_iterator(0);}
   // create a end iterator for faces
-  face_iterator end_faces()  {return create_face_iterator(map_faces.end());}
+  face_iterator end_faces()  {return create_face_iterator(faces.size());}
 
- private:
-  const_face_iterator create_const_face_iterator(FaceMap::const_iterator & it) const
-  {return const_face_iterator(it, vertices);}
- public:
-  // create a face const_iterator
-  const_face_iterator begin_faces() const {return const_face_iterator(map_faces.cbegin(), vertices);}
+  // A helper funciton to create face const_iterators
+  const_face_iterator create_const_face_iterator(const std::size_t iface) const
+  {return const_face_iterator(faces.cbegin() + iface, vertices);}
+  // create a face const_iterator (faces are traversed in index order)
+  const_face_iterator begin_faces() const {return create_const_face_iterator(0);}
   // create a end const_iterator for faces
-  const_face_iterator end_faces()  const {return const_face_iterator(map_faces.cend(), vertices);}
+  const_face_iterator end_faces()  const {return create_const_face_iterator(faces.size());}
 
   // GETTERS
   // get vector of all the grid vertex node coordinates
@@ -128,11 +125,15 @@ class Mesh
   // get number of vertices
   inline std::size_t n_vertices() const {return vertices.size();}
   // get number of faces
-  inline std::size_t n_faces() const {return map_faces.size();}
+  inline std::size_t n_faces() const {return faces.size();}
   // get cell center coordinates
   Point get_center(const std::size_t icell) const;
+  // non-owning cell geometry view (no allocation)
+  CellGeometry get_cell_geometry(const std::size_t icell) const
+  {return CellGeometry(vertices.points, cells[icell], shape_ids[icell]);}
   std::unique_ptr<Polyhedron> get_polyhedron(const std::size_t icell) const;
-  // get vector of faces ordered by index (super expernsive -- linear O(n_faces))
+  // get vector of faces ordered by index
+  // (faces are stored in index order, so this is a plain scan)
   std::vector<face_iterator> get_ordered_faces();
 
   // MANIPULATION
@@ -151,7 +152,8 @@ class Mesh
   // ATTRIBUTES
   angem::PointSet<3,double>             vertices;      // vector of vertex coordinates
   std::vector<std::vector<std::size_t>> cells;         // vertex indices
-  std::unordered_map<hash_type, Face>   map_faces;     // map face -> neighbor elements
+  std::vector<Face>                     faces;         // face data ordered by face index
+  FaceMap                               map_faces;     // map face hash -> face index
   std::vector<int>                      shape_ids;     // vector of cell vtk indices
   std::vector<int>                      cell_markers;  // vector of cell markers
 
@@ -9,6 +9,9 @@
 #include <const_edge_iterator.hpp>
 #include <surface_element_iterator.hpp>
 
+#include <algorithm>  // std::remove
+#include <limits>     // std::numeric_limits
+
 
 
 namespace mesh
@@ -43,6 +46,16 @@ class SurfaceMesh // : PolyGroup<Scalar>
   // complexity linear to number of faces (edges)
   // does not remove vertices when no connected neighbors
   std::size_t merge_element(const std::size_t element);
+  // merge jelement into its neighbor ielement through the common edge.
+  // complexity linear to the number of edges of the two elements:
+  // jelement is left empty and no elements are renumbered,
+  // so call remove_empty_elements after a series of merges
+  void absorb_element(const std::size_t ielement,
+                      const std::size_t jelement,
+                      const Edge      & edge);
+  // delete elements left empty by absorb_element and renumber the rest
+  // complexity linear to number of elements and edges
+  void remove_empty_elements();
   Scalar minimum_edge_size() const;
 
   // ITERATORS
@@ -102,6 +115,11 @@ class SurfaceMesh // : PolyGroup<Scalar>
   void merge_elements(const std::size_t ielement,
                       const std::size_t jelement,
                       const Edge      & edge);
+  // vertex indices of the polygon obtained by joining two elements
+  // through their common edge
+  std::vector<std::size_t> join_elements(const std::size_t ielement,
+                                         const std::size_t jelement,
+                                         const Edge      & edge) const;
   // delete and replace neighbors with the new element -- useful for merging
   void delete_replace_connections(const std::size_t deleted_element,
                                   const std::size_t replacement_element);
@@ -322,6 +340,76 @@ template <typename Scalar>
 void SurfaceMesh<Scalar>::merge_elements(const std::size_t ielement,
                                          const std::size_t jelement,
                                          const Edge      & edge)
+{
+  polygons[ielement] = join_elements(ielement, jelement, edge);
+  delete_replace_connections(jelement, ielement);
+}
+
+
+template <typename Scalar>
+void SurfaceMesh<Scalar>::absorb_element(const std::size_t ielement,
+                                         const std::size_t jelement,
+                                         const Edge      & edge)
+{
+  assert(ielement != jelement);
+  std::vector<std::size_t> new_element = join_elements(ielement, jelement, edge);
+
+  // detach both elements from their old edges
+  for (const std::size_t element : {ielement, jelement})
+    for (const Edge & iedge : get_edges(element))
+    {
+      auto iter = map_edges.find(hash_value(iedge.first, iedge.second));
+      if (iter == map_edges.end())
+        continue;
+      auto & neighbors = iter->second;
+      neighbors.erase(std::remove(neighbors.begin(), neighbors.end(), element),
+                      neighbors.end());
+      if (neighbors.empty())
+        map_edges.erase(iter);
+    }
+
+  polygons[ielement] = std::move(new_element);
+  polygons[jelement].clear();
+
+  // attach the joined element (it might have new edges if joint
+  // vertices were removed)
+  for (const Edge & iedge : get_edges(ielement))
+    map_edges[hash_value(iedge.first, iedge.second)].push_back(ielement);
+}
+
+
+template <typename Scalar>
+void SurfaceMesh<Scalar>::remove_empty_elements()
+{
+  const std::size_t deleted = std::numeric_limits<std::size_t>::max();
+  std::vector<std::size_t> new_index(polygons.size(), deleted);
+  std::size_t n_elements = 0;
+  for (std::size_t i=0; i<polygons.size(); ++i)
+    if (!polygons[i].empty())
+    {
+      new_index[i] = n_elements;
+      if (n_elements != i)
+        polygons[n_elements] = std::move(polygons[i]);
+      n_elements++;
+    }
+  polygons.resize(n_elements);
+
+  for (auto & edge_neighbors : map_edges)
+  {
+    auto & neighbors = edge_neighbors.second;
+    for (std::size_t & ielement : neighbors)
+      ielement = new_index[ielement];
+    neighbors.erase(std::remove(neighbors.begin(), neighbors.end(), deleted),
+                    neighbors.end());
+  }
+}
+
+
+template <typename Scalar>
+std::vector<std::size_t>
+SurfaceMesh<Scalar>::join_elements(const std::size_t ielement,
+                                   const std::size_t jelement,
+                                   const Edge      & edge) const
 {
   // connect edges in a ordered fashion and delete jelement
   // the resulting polygon might be non-convex
@@ -349,19 +437,25 @@ void SurfaceMesh<Scalar>::merge_elements(const std::size_t ielement,
     throw NotImplemented("can this even happen?");
 
   // remove joint point if lies on a flat edge
-  for (std::size_t i=0; i<new_element.size(); ++i)
-    if (new_element[i] == edge.first or new_element[i] == edge.second)
+  for (std::size_t i=0; i<new_element.size();)
+  {
+    const std::size_t n = new_element.size();
+    if (n > 3 and (new_element[i] == edge.first or new_element[i] == edge.second))
     {
-      angem::Point<3,Scalar> v1 = vertices[new_element[i+1]] - vertices[new_element[i]];
-      angem::Point<3,Scalar> v2 = vertices[new_element[i]] - vertices[new_element[i-1]];
+      const std::size_t next = new_element[(i + 1) % n];
+      const std::size_t prev = new_element[(i + n - 1) % n];
+      angem::Point<3,Scalar> v1 = vertices[next] - vertices[new_element[i]];
+      angem::Point<3,Scalar> v2 = vertices[new_element[i]] - vertices[prev];
       if ( (v1.cross(v2)).norm() < 1e-10 )
       {
         new_element.erase(new_element.begin() + i);
+        continue;
       }
     }
+    i++;
+  }
 
-  polygons[ielement] = new_element;
-  delete_replace_connections(jelement, ielement);
+  return new_element;
 }
 
 
@@ -0,0 +1,41 @@
+#include "VertexCells.hpp"
+
+#include <algorithm>  // std::copy_backward, std::sort, std::unique
+
+namespace mesh
+{
+
+VertexCells::VertexCells(const Mesh & grid)
+    :
+    offsets(grid.n_vertices() + 1, 0)
+{
+  for (const auto & cell_vertices : grid.cells)
+    for (const std::size_t v : cell_vertices)
+      offsets[v + 1]++;
+  for (std::size_t v = 1; v < offsets.size(); ++v)
+    offsets[v] += offsets[v - 1];
+
+  cells.resize(offsets.back());
+  for (std::size_t icell = 0; icell < grid.n_cells(); ++icell)
+    for (const std::size_t v : grid.cells[icell])
+      cells[offsets[v]++] = icell;
+  // filling advanced offsets[v] to the end of row v: shift back
+  std::copy_backward(offsets.begin(), offsets.end() - 1, offsets.end());
+  offsets[0] = 0;
+}
+
+
+std::vector<std::size_t> VertexCells::vertex_neighbors(const Mesh & grid,
+                                                       const std::size_t icell) const
+{
+  std::vector<std::size_t> result;
+  for (const std::size_t v : grid.cells[icell])
+    for (auto it = begin(v); it != end(v); ++it)
+      if (*it != icell)
+        result.push_back(*it);
+  std::sort(result.begin(), result.end());
+  result.erase(std::unique(result.begin(), result.end()), result.end());
+  return result;
+}
+
+}  // end namespace mesh
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "Mesh.hpp"
+
+namespace mesh
+{
+
+/* Cells that contain every vertex, in compressed rows.
+ * Neighbor lists of cells only cover shared faces; this map also gives
+ * the cells that touch a cell at an edge or a vertex.
+ * Note: the map is not updated when the mesh is modified */
+class VertexCells
+{
+ public:
+  explicit VertexCells(const Mesh & grid);
+  // cells that contain vertex v
+  inline const std::size_t * begin(const std::size_t v) const {return cells.data() + offsets[v];}
+  inline const std::size_t * end(const std::size_t v) const {return cells.data() + offsets[v + 1];}
+  // cells that share at least one vertex with icell (icell excluded, sorted)
+  std::vector<std::size_t> vertex_neighbors(const Mesh & grid, const std::size_t icell) const;
+
+ private:
+  // cells of vertex v are cells[offsets[v]:offsets[v+1]]
+  std::vector<std::size_t> offsets;
+  std::vector<std::size_t> cells;
+};
+
+}  // end namespace mesh
@@ -9,7 +9,8 @@ cell_iterator::
 cell_iterator(const std::size_t                       icell,
               angem::PointSet<3,double>             & vertices,
               std::vector<std::vector<std::size_t>> & cells,
-              std::unordered_map<hash_type, Face>   & map_faces,
+              std::vector<Face>                     & faces,
+              FaceMap                               & map_faces,
               std::vector<int>                      & shape_ids,
               std::vector<int>                      & cell_markers)
 
@@ -17,6 +18,7 @@ cell_iterator(const std::size_t                       icell,
     icell(icell),
     mesh_vertices(vertices),
     cells(cells),
+    mesh_faces(faces),
     map_faces(map_faces),
     shape_ids(shape_ids),
     cell_markers(cell_markers)
@@ -90,7 +92,7 @@ std::vector<face_iterator> cell_iterator::faces() const
     auto it_face = map_faces.find(hash);
     if (it_face == map_faces.end())
       throw std::out_of_range("face does not exist");
-    face_iterator face(it_face, mesh_vertices);
+    face_iterator face(mesh_faces.begin() + it_face->second, mesh_vertices);
     faces.push_back(face);
   }
   return faces;
@@ -121,12 +123,7 @@ std::vector<std::size_t> cell_iterator::neighbor_indices() const
 
 double cell_iterator::volume() const
 {
-  const auto poly =
-      angem::PolyhedronFactory::create<double>(mesh_vertices.points,
-                                               cells[icell],
-                                               shape_ids[icell]);
-
-  return poly->volume();
+  return geometry().volume();
 }
 
 
@@ -138,7 +135,7 @@ cell_iterator cell_iterator::neighbor_by_face(const face_iterator & face) const
   for (std::size_t cell_index : face.neighbors())
     if (cell_index != icell)
       return cell_iterator(cell_index, mesh_vertices, cells,
-                           map_faces, shape_ids, cell_markers);
+                           mesh_faces, map_faces, shape_ids, cell_markers);
 
   throw std::invalid_argument("cannot be here");
 }
@@ -7,6 +7,7 @@
 #include <vector>
 #include <unordered_map>
 #include <mesh_methods.hpp>
+#include "GeometryView.hpp"
 
 #include <memory>  // unique_ptr
 
@@ -21,7 +22,8 @@ class cell_iterator
   cell_iterator(const std::size_t                       icell,
                 angem::PointSet<3,double>             & vertices,
                 std::vector<std::vector<std::size_t>> & cells,
-                std::unordered_map<hash_type, Face>   & map_faces,
+                std::vector<Face>                     & faces,
+                FaceMap                               & map_faces,
                 std::vector<int>                      & shape_ids,
                 std::vector<int>                      & cell_markers);
   // assignment operator
@@ -40,6 +42,9 @@ class cell_iterator
   Point center() const;
   double volume() const;
   std::unique_ptr<Polyhedron<double>> polyhedron() const;
+  // non-owning view for center, bounding box, volume, etc. without allocation
+  inline CellGeometry geometry() const
+  {return CellGeometry(mesh_vertices.points, cells[icell], shape_ids[icell]);}
   std::vector<face_iterator> faces() const;
 
   // other
@@ -54,7 +59,8 @@ class cell_iterator
   std::size_t icell;
   angem::PointSet<3,double>             & mesh_vertices;
   std::vector<std::vector<std::size_t>> & cells;
-  std::unordered_map<hash_type, Face>   & map_faces;
+  std::vector<Face>                     & mesh_faces;
+  FaceMap                               & map_faces;
   std::vector<int> & shape_ids;
   std::vector<int> & cell_markers;
 };
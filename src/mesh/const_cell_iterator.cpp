@@ -9,7 +9,8 @@ const_cell_iterator::
 const_cell_iterator(const std::size_t                             icell,
                     const angem::PointSet<3,double>             & vertices,
                     const std::vector<std::vector<std::size_t>> & cells,
-                    const std::unordered_map<hash_type, Face>   & map_faces,
+                    const std::vector<Face>                     & faces,
+                    const FaceMap                               & map_faces,
                     const std::vector<int>                      & shape_ids,
                     const std::vector<int>                      & cell_markers)
 
@@ -17,6 +18,7 @@ const_cell_iterator(const std::size_t                             icell,
     icell(icell),
     mesh_vertices(vertices),
     cells(cells),
+    mesh_faces(faces),
     map_faces(map_faces),
     shape_ids(shape_ids),
     cell_markers(cell_markers)
@@ -90,7 +92,7 @@ std::vector<const_face_iterator> const_cell_iterator::faces() const
     auto it_face = map_faces.find(hash);
     if (it_face == map_faces.end())
       throw std::out_of_range("face does not exist");
-    const_face_iterator face(it_face, mesh_vertices);
+    const_face_iterator face(mesh_faces.begin() + it_face->second, mesh_vertices);
     faces.push_back(face);
   }
   return faces;
@@ -121,12 +123,7 @@ std::vector<std::size_t> const_cell_iterator::neighbor_indices() const
 
 double const_cell_iterator::volume() const
 {
-  const auto poly =
-      angem::PolyhedronFactory::create<double>(mesh_vertices.points,
-                                               cells[icell],
-                                               shape_ids[icell]);
-
-  return poly->volume();
+  return geometry().volume();
 }
 
 
@@ -138,7 +135,7 @@ const_cell_iterator const_cell_iterator::neighbor_by_face(const const_face_itera
   for (std::size_t cell_index : face.neighbors())
     if (cell_index != icell)
       return const_cell_iterator(cell_index, mesh_vertices, cells,
-                           map_faces, shape_ids, cell_markers);
+                           mesh_faces, map_faces, shape_ids, cell_markers);
 
   throw std::invalid_argument("cannot be here");
 }
@@ -7,6 +7,7 @@
 #include <vector>
 #include <unordered_map>
 #include <mesh_methods.hpp>
+#include "GeometryView.hpp"
 
 #include <memory>  // unique_ptr
 
@@ -21,7 +22,8 @@ class const_cell_iterator
   const_cell_iterator(const std::size_t                             icell,
                       const angem::PointSet<3,double>             & vertices,
                       const std::vector<std::vector<std::size_t>> & cells,
-                      const std::unordered_map<hash_type, Face>   & map_faces,
+                      const std::vector<Face>                     & faces,
+                      const FaceMap                               & map_faces,
                       const std::vector<int>                      & shape_ids,
                       const std::vector<int>                      & cell_markers);
   // assignment operator
@@ -41,6 +43,9 @@ class const_cell_iterator
   Point center() const;
   double volume() const;
   std::unique_ptr<Polyhedron<double>> polyhedron() const;
+  // non-owning view for center, bounding box, volume, etc. without allocation
+  inline CellGeometry geometry() const
+  {return CellGeometry(mesh_vertices.points, cells[icell], shape_ids[icell]);}
   std::vector<const_face_iterator> faces() const;
 
   // other
@@ -55,7 +60,8 @@ class const_cell_iterator
   std::size_t icell;
   const angem::PointSet<3,double>             & mesh_vertices;
   const std::vector<std::vector<std::size_t>> & cells;
-  const std::unordered_map<hash_type, Face>   & map_faces;
+  const std::vector<Face>                     & mesh_faces;
+  const FaceMap                               & map_faces;
   const std::vector<int> & shape_ids;
   const std::vector<int> & cell_markers;
 };
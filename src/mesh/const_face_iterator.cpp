@@ -5,7 +5,7 @@ namespace mesh
 {
 
 const_face_iterator::
-const_face_iterator(FaceMap::const_iterator   it,
+const_face_iterator(std::vector<Face>::const_iterator it,
                     const angem::PointSet<3,double> & vertices)
     :
     face_it(it),
@@ -54,7 +54,7 @@ const_face_iterator & const_face_iterator::operator++()
 
 int const_face_iterator::marker() const
 {
-  return face_it->second.marker;
+  return face_it->marker;
 }
 
 
@@ -68,7 +68,7 @@ std::vector<Point> const_face_iterator::vertices() const
 
 std::vector<std::size_t> const_face_iterator::vertex_indices() const
 {
-  return face_it->second.ordered_indices;
+  return face_it->ordered_indices;
 }
 
 
@@ -87,7 +87,7 @@ angem::Polygon<double> const_face_iterator::polygon() const
 
 angem::Point<3,double> const_face_iterator::center() const
 {
-  const auto verts = vertex_indices();
+  const auto & verts = face_it->ordered_indices;
   angem::Point<3,double> c = {0, 0, 0};
   for (const size_t vert : verts)
     c += (*p_mesh_vertices)[vert];
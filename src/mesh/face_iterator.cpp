@@ -1,11 +1,13 @@
 #include <face_iterator.hpp>
 #include <mesh_methods.hpp>
 
+#include <algorithm>  // std::sort
+
 namespace mesh
 {
 
 face_iterator::
-face_iterator(const FaceMap::iterator            & it,
+face_iterator(const std::vector<Face>::iterator   & it,
               angem::PointSet<3,double>          & vertices)
     :
     face_it(it),
@@ -54,20 +56,22 @@ face_iterator & face_iterator::operator++()
 
 int face_iterator::marker() const
 {
-  return face_it->second.marker;
+  return face_it->marker;
 }
 
 
 std::vector<Point> face_iterator::vertices() const
 {
-  std::vector<std::size_t> ivertices(invert_hash(face_it->first));
+  // sorted, same as invert_hash(hash())
+  std::vector<std::size_t> ivertices(face_it->ordered_indices);
+  std::sort(ivertices.begin(), ivertices.end());
   return get_vertex_coordinates(p_mesh_vertices, ivertices);
 }
 
 
 std::vector<std::size_t> face_iterator::vertex_indices() const
 {
-  return face_it->second.ordered_indices;
+  return face_it->ordered_indices;
 }
 
 
@@ -86,7 +90,7 @@ angem::Polygon<double> face_iterator::polygon() const
 
 angem::Point<3,double> face_iterator::center() const
 {
-  const auto verts = vertex_indices();
+  const auto & verts = face_it->ordered_indices;
   angem::Point<3,double> c = {0, 0, 0};
   for (const size_t vert : verts)
     c += (*p_mesh_vertices)[vert];
@@ -5,19 +5,19 @@
 #include <angem/PointSet.hpp>
 #include <Face.hpp>
 #include <mesh_methods.hpp>
+#include "GeometryView.hpp"
 #include <unordered_map>
 #include <vector>
 
 namespace mesh
 {
 using Point = angem::Point<3,double>;
-using FaceMap = std::unordered_map<hash_type, Face>;
 
 class face_iterator
 {
  public:
   // Default constructor
-  face_iterator(const FaceMap::iterator            & it,
+  face_iterator(const std::vector<Face>::iterator   & it,
                 angem::PointSet<3,double>          & vertices);
   // Copy constructor
   face_iterator(const face_iterator & other);
@@ -40,23 +40,26 @@ class face_iterator
   // get face marker, (-1) if not defined
   int marker() const;
   // get hash value of the face
-  inline hash_type hash() const {return face_it->first;}
+  inline hash_type hash() const {return hash_value(face_it->ordered_indices);}
   // get face index
-  std::size_t index() const {return face_it->second.index;}
+  std::size_t index() const {return face_it->index;}
   // get an index of the parent (master) face that existed before the split
   // same as index() if the face has not been split
-  std::size_t master_index() const {return face_it->second.old_index;}
+  std::size_t master_index() const {return face_it->old_index;}
   // get vtk id of the face
-  int vtk_id() const {return face_it->second.vtk_id;}
+  int vtk_id() const {return face_it->vtk_id;}
   // get vector of neighbor cell indices
   inline
-  const std::vector<std::size_t> & neighbors() const {return face_it->second.neighbors;}
+  const std::vector<std::size_t> & neighbors() const {return face_it->neighbors;}
   // get vector of face vertex coordinates
   std::vector<Point> vertices() const;
   // get vector of face vertex indices
   std::vector<std::size_t> vertex_indices() const;
   // get angem::Polygon from vertices
   angem::Polygon<double> polygon() const;
+  // non-owning view for center, area, normal, etc. without allocation
+  inline FaceGeometry geometry() const
+  {return FaceGeometry(p_mesh_vertices->points, face_it->ordered_indices);}
   // incrementing
   // increment operator
   face_iterator & operator++();
@@ -64,7 +67,7 @@ class face_iterator
   face_iterator & operator--();
 
  private:
-  FaceMap::iterator           face_it;        // iterator in the face container
+  std::vector<Face>::iterator face_it;        // iterator in the face container
   angem::PointSet<3,double> * p_mesh_vertices;  // reference to the vertices container
 };
 
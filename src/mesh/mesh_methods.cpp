@@ -1,4 +1,5 @@
 #include <mesh_methods.hpp>
+#include "GeometryView.hpp"
 #include <angem/utils.hpp>
 #include <algorithm>  // std::sort
 #include <cmath>      // std::pow
@@ -26,7 +27,7 @@ std::size_t estimate_max_vertices(const int n_polygon_vertices)
 Point get_element_center(const angem::PointSet<3,double> & vertices,
                          const std::vector<std::size_t>  & ivertices)
 {
-  return angem::compute_center_mass(get_vertex_coordinates(vertices, ivertices));
+  return ElementGeometry(vertices.points, ivertices).center();
 }
 
 
@@ -25,7 +25,8 @@ using hash_type = boost::multiprecision::uint256_t;
 using hash_type = uint256_t;
 #endif
 
-using FaceMap = std::unordered_map<hash_type, Face>;
+// face hash -> face index
+using FaceMap = std::unordered_map<hash_type, std::size_t>;
 
 
 extern const std::size_t MAX_HASHED_VERTICES;
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "ThreadPool.hpp"
+
+#include <vector>
+
+namespace parallel
+{
+
+/* Scratch storage with one instance per thread of the global pool.
+ * Inside parallel_for / parallel_reduce local() returns the instance of
+ * the executing thread, so tasks can reuse buffers (vectors, arenas)
+ * without locking and without allocating on every call.
+ * Create it outside of the parallel region. */
+template<typename T>
+class PerThread
+{
+ public:
+  explicit PerThread(const T & prototype = T())
+      : items(ThreadPool::instance().size(), prototype)
+  {}
+  // instance of the calling thread
+  T & local() {return items[ThreadPool::thread_index()];}
+  // all instances (e.g. to merge thread results after the parallel region)
+  std::vector<T> & all() {return items;}
+
+ private:
+  std::vector<T> items;
+};
+
+}  // end namespace parallel
@@ -0,0 +1,204 @@
+#include "ThreadPool.hpp"
+
+namespace parallel
+{
+
+namespace
+{
+// pool whose task the current thread is executing (nullptr outside of pools)
+thread_local ThreadPool * current_pool = nullptr;
+thread_local std::size_t current_index = 0;
+
+std::mutex global_mutex;
+std::unique_ptr<ThreadPool> global_pool;
+std::size_t global_n_threads = 0;
+}
+
+
+ThreadPool::ThreadPool(std::size_t n_threads)
+{
+  if (n_threads == 0)
+    n_threads = std::thread::hardware_concurrency();
+  if (n_threads == 0)
+    n_threads = 1;
+
+  for (std::size_t i = 0; i < n_threads; ++i)
+    blocks.push_back(std::make_unique<Block>());
+  workers.reserve(n_threads - 1);
+  for (std::size_t i = 1; i < n_threads; ++i)
+    workers.emplace_back([this, i] {work(i);});
+}
+
+
+ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stop = true;
+  }
+  wake.notify_all();
+  for (auto & worker : workers)
+    worker.join();
+}
+
+
+void ThreadPool::run(const std::size_t n_tasks, const std::function<void(std::size_t)> & task)
+{
+  if (n_tasks == 0) return;
+
+  // nested call or the pool is busy: run serially
+  std::unique_lock<std::mutex> run_lock(run_mutex, std::defer_lock);
+  if (workers.empty() || n_tasks == 1 || current_pool == this || !run_lock.try_lock())
+  {
+    for (std::size_t i = 0; i < n_tasks; ++i)
+      task(i);
+    return;
+  }
+
+  // contiguous blocks of tasks, one per thread
+  const std::size_t n_threads = size();
+  for (std::size_t t = 0; t < n_threads; ++t)
+  {
+    std::lock_guard<std::mutex> lock(blocks[t]->mutex);
+    blocks[t]->begin = n_tasks * t / n_threads;
+    blocks[t]->end = n_tasks * (t + 1) / n_threads;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    current_task = &task;
+    error = nullptr;
+    n_busy = workers.size();
+    generation++;
+  }
+  wake.notify_all();
+
+  // calling thread works as thread 0
+  ThreadPool * const saved_pool = current_pool;
+  const std::size_t saved_index = current_index;
+  current_pool = this;
+  current_index = 0;
+  execute(0);
+  current_pool = saved_pool;
+  current_index = saved_index;
+
+  std::unique_lock<std::mutex> lock(mutex);
+  finished.wait(lock, [this] {return n_busy == 0;});
+  current_task = nullptr;
+  if (error)
+    std::rethrow_exception(error);
+}
+
+
+void ThreadPool::work(const std::size_t index)
+{
+  current_pool = this;
+  current_index = index;
+  std::size_t seen_generation = 0;
+  while (true)
+  {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      wake.wait(lock, [this, seen_generation] {return stop || generation != seen_generation;});
+      if (stop) return;
+      seen_generation = generation;
+    }
+
+    execute(index);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (--n_busy == 0)
+      finished.notify_all();
+  }
+}
+
+
+void ThreadPool::execute(const std::size_t index)
+{
+  std::size_t itask;
+  while (next_task(index, itask))
+    try
+    {
+      (*current_task)(itask);
+    }
+    catch (...)
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (!error)
+        error = std::current_exception();
+    }
+}
+
+
+bool ThreadPool::next_task(const std::size_t index, std::size_t & itask)
+{
+  Block & own = *blocks[index];
+  {
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (own.begin < own.end)
+    {
+      itask = own.begin++;
+      return true;
+    }
+  }
+
+  // steal the back half of the largest block
+  while (true)
+  {
+    std::size_t victim = index, largest = 0;
+    for (std::size_t t = 0; t < blocks.size(); ++t)
+      if (t != index)
+      {
+        std::lock_guard<std::mutex> lock(blocks[t]->mutex);
+        if (blocks[t]->end - blocks[t]->begin > largest)
+        {
+          largest = blocks[t]->end - blocks[t]->begin;
+          victim = t;
+        }
+      }
+    if (largest == 0)
+      return false;
+
+    std::size_t first, last;
+    {
+      std::lock_guard<std::mutex> lock(blocks[victim]->mutex);
+      const std::size_t remaining = blocks[victim]->end - blocks[victim]->begin;
+      if (remaining == 0) continue;  // emptied in the meantime
+      last = blocks[victim]->end;
+      first = last - (remaining + 1) / 2;
+      blocks[victim]->end = first;
+    }
+
+    // own block is empty, and nobody else adds to it
+    std::lock_guard<std::mutex> lock(own.mutex);
+    own.begin = first + 1;
+    own.end = last;
+    itask = first;
+    return true;
+  }
+}
+
+
+ThreadPool & ThreadPool::instance()
+{
+  std::lock_guard<std::mutex> lock(global_mutex);
+  if (!global_pool)
+    global_pool = std::make_unique<ThreadPool>(global_n_threads);
+  return *global_pool;
+}
+
+
+void ThreadPool::set_n_threads(const std::size_t n_threads)
+{
+  std::lock_guard<std::mutex> lock(global_mutex);
+  global_n_threads = n_threads;
+  global_pool.reset();
+}
+
+
+std::size_t ThreadPool::thread_index()
+{
+  return current_index;
+}
+
+}  // end namespace parallel
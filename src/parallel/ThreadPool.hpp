@@ -0,0 +1,76 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace parallel
+{
+
+/* Work-stealing thread pool shared by all stages.
+ * run(n, task) executes task(0..n-1) on the pool threads and the
+ * calling thread. Every thread starts with a contiguous block of task
+ * indices, takes tasks from the front of its block and, when it runs
+ * out, steals the back half of the largest remaining block.
+ * The pool does not nest: run() called from inside a task, or while
+ * another thread is using the pool, executes the tasks serially on the
+ * calling thread. Results must therefore not depend on which thread
+ * executes a task (see parallel_reduce for ordered reductions). */
+class ThreadPool
+{
+ public:
+  // pool with n_threads threads (including the calling thread); 0 = hardware threads
+  explicit ThreadPool(const std::size_t n_threads = 0);
+  // joins the worker threads
+  ~ThreadPool();
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool & operator=(const ThreadPool &) = delete;
+  // number of threads that execute tasks (workers + calling thread)
+  std::size_t size() const {return workers.size() + 1;}
+  // execute task(i) for i in [0, n_tasks); returns when all tasks are done.
+  // rethrows the first exception thrown by a task
+  void run(const std::size_t n_tasks, const std::function<void(std::size_t)> & task);
+
+  // global pool used by parallel_for and parallel_reduce
+  static ThreadPool & instance();
+  // number of threads of the global pool (0 = hardware threads);
+  // recreates the pool if it already exists, so call it at startup (--threads)
+  static void set_n_threads(const std::size_t n_threads);
+  // index of the current thread in the pool that runs it: [0, size()).
+  // threads outside of a pool (including the caller of run()) get 0
+  static std::size_t thread_index();
+
+ private:
+  // block of task indices [begin, end) owned by a thread
+  struct Block
+  {
+    std::mutex mutex;
+    std::size_t begin = 0, end = 0;
+  };
+
+  // worker thread loop
+  void work(const std::size_t index);
+  // execute tasks of the current run() on thread index until none are left
+  void execute(const std::size_t index);
+  // take a task from own block or steal from others; false if no tasks left
+  bool next_task(const std::size_t index, std::size_t & itask);
+
+  std::vector<std::thread> workers;
+  std::vector<std::unique_ptr<Block>> blocks;  // one per thread
+  std::mutex run_mutex;                        // one run() at a time
+  std::mutex mutex;                            // guards the fields below
+  std::condition_variable wake, finished;
+  const std::function<void(std::size_t)> * current_task = nullptr;
+  std::size_t generation = 0;                  // incremented by every run()
+  std::size_t n_busy = 0;                      // workers inside the current run()
+  std::exception_ptr error;
+  bool stop = false;
+};
+
+}  // end namespace parallel
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "ThreadPool.hpp"
+
+#include <algorithm>  // std::min, std::max
+#include <vector>
+
+namespace parallel
+{
+
+// number of threads of the global pool (hardware threads unless set with --threads)
+inline std::size_t default_n_threads()
+{
+  return ThreadPool::instance().size();
+}
+
+/* Call f(i) for every i in [begin, end).
+ * The range is split into contiguous chunks (a few per thread) that are
+ * executed by the global thread pool.
+ * f must be safe to call concurrently for different i.
+ * n_threads = 1 or ranges shorter than min_chunk are processed serially */
+template<typename Func>
+void parallel_for(const std::size_t begin, const std::size_t end, Func && f,
+                  std::size_t n_threads = 0, const std::size_t min_chunk = 1024)
+{
+  if (end <= begin) return;
+  const std::size_t n = end - begin;
+  ThreadPool & pool = ThreadPool::instance();
+  if (n_threads == 0 || n_threads > pool.size()) n_threads = pool.size();
+  // a few chunks per thread so that work stealing can balance the load
+  const std::size_t chunk = std::max(min_chunk, (n + 4 * n_threads - 1) / (4 * n_threads));
+  const std::size_t n_chunks = (n + chunk - 1) / chunk;
+  if (n_threads <= 1 || n_chunks <= 1)
+  {
+    for (std::size_t i = begin; i < end; ++i)
+      f(i);
+    return;
+  }
+
+  pool.run(n_chunks, [&f, begin, end, chunk](const std::size_t ichunk)
+  {
+    const std::size_t first = begin + ichunk * chunk;
+    const std::size_t last = std::min(end, first + chunk);
+    for (std::size_t i = first; i < last; ++i)
+      f(i);
+  });
+}
+
+/* Reduce map(i) for i in [begin, end) with combine(a, b)
+ * (identity is the neutral element of combine).
+ * The range is cut into chunks of a fixed size, independent of the number
+ * of threads; partial results of the chunks are computed in parallel and
+ * combined in chunk order, so the result (e.g. a floating point sum) is
+ * the same for any number of threads */
+template<typename T, typename Map, typename Combine>
+T parallel_reduce(const std::size_t begin, const std::size_t end, const T & identity,
+                  Map && map, Combine && combine, const std::size_t chunk = 4096)
+{
+  if (end <= begin) return identity;
+  const std::size_t n_chunks = (end - begin + chunk - 1) / chunk;
+  std::vector<T> partial(n_chunks, identity);
+  ThreadPool::instance().run(n_chunks, [&](const std::size_t ichunk)
+  {
+    const std::size_t first = begin + ichunk * chunk;
+    const std::size_t last = std::min(end, first + chunk);
+    T value = identity;
+    for (std::size_t i = first; i < last; ++i)
+      value = combine(value, map(i));
+    partial[ichunk] = std::move(value);
+  });
+
+  T result = identity;
+  for (const T & value : partial)
+    result = combine(result, value);
+  return result;
+}
+
+}  // end namespace parallel
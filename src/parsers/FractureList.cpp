@@ -0,0 +1,131 @@
+#include "FractureList.hpp"
+#include <angem/Rectangle.hpp>
+
+#include <array>
+#include <cctype>     // std::isspace
+#include <charconv>   // std::from_chars
+#include <experimental/filesystem>
+#include <fstream>
+#include <stdexcept>  // std::runtime_error
+
+namespace Parsers
+{
+
+namespace
+{
+using Record = std::array<double, fracture_list_columns>;
+
+
+void add_fracture(const Record & record, std::vector<EmbeddedFractureConfig> & fractures)
+{
+  const angem::Point<3,double> center = {record[0], record[1], record[2]};
+  fractures.emplace_back();
+  auto & conf = fractures.back();
+  conf.body = std::make_shared<angem::Rectangle<double>>
+      (center, record[3], record[4], record[5], record[6]);
+  conf.aperture = record[7];
+  conf.conductivity = record[8];
+}
+
+
+inline bool is_separator(const char c)
+{
+  return c == ',' || std::isspace(static_cast<unsigned char>(c));
+}
+
+
+void read_text_list(const std::string & contents, const std::string & file_name,
+                    std::vector<EmbeddedFractureConfig> & fractures)
+{
+  const char * pos = contents.data();
+  const char * const end = contents.data() + contents.size();
+  std::size_t line = 0;
+  while (pos < end)
+  {
+    const char * line_end = pos;
+    while (line_end < end && *line_end != '\n')
+      line_end++;
+    line++;
+
+    Record record;
+    std::size_t n_values = 0;
+    while (true)
+    {
+      while (pos < line_end && is_separator(*pos))
+        pos++;
+      if (pos == line_end || (*pos == '#' && n_values == 0))
+        break;
+      const char * token_end = pos;
+      while (token_end < line_end && !is_separator(*token_end))
+        token_end++;
+
+      double value;
+      const auto result = std::from_chars(pos, token_end, value);
+      if (result.ec != std::errc() || result.ptr != token_end ||
+          n_values == fracture_list_columns)
+        throw std::runtime_error("invalid entry in line " + std::to_string(line) +
+                                 " of fracture list " + file_name);
+      record[n_values++] = value;
+      pos = token_end;
+    }
+
+    if (n_values == fracture_list_columns)
+      add_fracture(record, fractures);
+    else if (n_values != 0)
+      throw std::runtime_error("line " + std::to_string(line) + " of fracture list " +
+                               file_name + " should have " +
+                               std::to_string(fracture_list_columns) + " values");
+    pos = line_end + 1;
+  }
+}
+
+
+void read_binary_list(const std::string & contents, const std::string & file_name,
+                      std::vector<EmbeddedFractureConfig> & fractures)
+{
+  if (contents.size() % sizeof(Record) != 0)
+    throw std::runtime_error("size of fracture list " + file_name +
+                             " is not a multiple of the record size");
+  const std::size_t n = contents.size() / sizeof(Record);
+  fractures.reserve(fractures.size() + n);
+  Record record;
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    contents.copy(reinterpret_cast<char*>(record.data()), sizeof(Record), i * sizeof(Record));
+    add_fracture(record, fractures);
+  }
+}
+}  // end anonymous namespace
+
+
+void read_fracture_list(const std::string & file_name, const PropertyFileFormat format,
+                        std::vector<EmbeddedFractureConfig> & fractures)
+{
+  std::ifstream in(file_name, std::ios::binary | std::ios::ate);
+  if (!in)
+    throw std::runtime_error("cannot open fracture list " + file_name);
+
+  // lists are small compared to the mesh: read at once
+  std::string contents(static_cast<std::size_t>(in.tellg()), '\0');
+  in.seekg(0);
+  in.read(&contents[0], contents.size());
+  if (!in)
+    throw std::runtime_error("cannot read fracture list " + file_name);
+
+  if (format == PropertyFileFormat::binary)
+    read_binary_list(contents, file_name, fractures);
+  else
+    read_text_list(contents, file_name, fractures);
+}
+
+
+std::string config_file_path(const std::string & config_file, const std::string & file_name)
+{
+  namespace filesystem = std::experimental::filesystem;
+  const filesystem::path path(file_name);
+  if (path.is_absolute())
+    return file_name;
+  return filesystem::absolute(filesystem::path(config_file)).parent_path() / path;
+}
+
+}  // end namespace Parsers
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <SimdataConfig.hpp>
+
+#include <string>
+#include <vector>
+
+namespace Parsers
+{
+
+// values per fracture in a fracture list:
+// center x, y, z, length, height, dip, strike, aperture, conductivity
+constexpr std::size_t fracture_list_columns = 9;
+
+/* Read rectangular embedded fractures from a compact side file and append
+ * them to fractures. Attributes that are not in the file (remeshing, mechanics)
+ * get the default values of EmbeddedFractureConfig.
+ * Text files: one fracture per line, values separated by commas or whitespace;
+ * empty lines and lines starting with '#' are skipped.
+ * Binary files: records of 64-bit floats in native byte order.
+ * Throws std::runtime_error if the file cannot be read or is malformed. */
+void read_fracture_list(const std::string & file_name, const PropertyFileFormat format,
+                        std::vector<EmbeddedFractureConfig> & fractures);
+
+// absolute path of a file named in config_file:
+// relative names are relative to the directory of the config, not to the working directory
+std::string config_file_path(const std::string & config_file, const std::string & file_name);
+
+}  // end namespace Parsers
@@ -1,9 +1,10 @@
 #include <JsonParser.hpp>
+#include "JsonSaxHandler.hpp"
 
 #include <string>
 #include <fstream>  // std::ifstream
 #include <iostream>  // debug
-#include <angem/Rectangle.hpp>
+#include <stdexcept>  // std::invalid_argument
 
 
 namespace Parsers
@@ -36,32 +37,56 @@ SimdataConfig & JsonParser::get_config()
 void
 JsonParser::parse(const std::string & fname)
 {
-  // read a JSON file
   std::ifstream input(fname);
-  nlohmann::json jparser;
-  input >> jparser;
+  if (!input)
+    throw std::invalid_argument("cannot open " + fname);
+
+  // large sections are read from the events; the rest is passed to section()
+  JsonSaxHandler handler(config, fname,
+                         [this](const std::string & key, nlohmann::json & value)
+                         {section(key, value);});
+  nlohmann::json::sax_parse(input, &handler);
+}
 
-  // iterate sections
-  for (nlohmann::json::iterator section_it = jparser.begin();
-       section_it != jparser.end(); ++section_it)
+
+void
+JsonParser::section(const std::string & key, nlohmann::json & value)
+{
+  // the section methods iterate over the entries of a key-value pair
+  nlohmann::json jparser;
+  jparser[key] = std::move(value);
+  const nlohmann::json::iterator section_it = jparser.begin();
+
+  if (key == "Domain Flow Properties")
+    domain_props(section_it, 0);
+  else if (key == "Domain Mechanics Properties")
+    domain_props(section_it, 1);
+  else if (key == "Discrete Fractures")
+    discrete_fracs(section_it);
+  else if (key == "Property Files")
+    property_files(section_it);
+  else if (key == "Mesh file")
+    config.mesh_file = (*section_it).get<std::string>();
+  else if (key == "VTK pieces")
+    config.n_vtk_pieces = (*section_it).get<std::size_t>();
+  else if (key == "Mesh cache")
+    config.mesh_cache = (*section_it).get<bool>();
+  else if (key == "Stage cache")
+    config.stage_cache = (*section_it).get<bool>();
+  else if (key == "Stage cache size")  // GB
+    config.stage_cache_max_bytes = static_cast<std::size_t>((*section_it).get<double>() * (1 << 30));
+  else if (key == "Stream connections")
+    config.stream_connections = (*section_it).get<bool>();
+  else if (key == "Renumbering")
+    config.renumbering = renumbering_method((*section_it).get<std::string>());
+  else if (key == "Output formats")
   {
-    std::cout << "Entering section " << section_it.key() << '\n';
-
-    if (section_it.key() == "Domain Flow Properties")
-      domain_props(section_it, 0);
-    else if (section_it.key() == "Domain Mechanics Properties")
-      domain_props(section_it, 1);
-    else if (section_it.key() == "Embedded Fractures")
-      embedded_fracs(section_it);
-    else if (section_it.key() == "Discrete Fractures")
-      discrete_fracs(section_it);
-    else if (section_it.key() == "Boundary conditions")
-      boundary_conditions(section_it);
-    else if (section_it.key() == "Mesh file")
-      config.mesh_file = (*section_it).get<std::string>();
-    else
-      std::cout << "Skipping section " << section_it.key() << std::endl;
-  }  // end section loop
+    config.output_formats.clear();
+    for (const auto & name : (*section_it).get<std::vector<std::string>>())
+      config.output_formats.push_back(output_format(name));
+  }
+  else
+    std::cout << "Skipping section " << key << std::endl;
 }
 
 
@@ -163,260 +188,73 @@ JsonParser::domain_props(const nlohmann::json::iterator & section_it,
 }
 
 
-std::pair<std::string,std::string>
-JsonParser::get_pair(const nlohmann::json::iterator & pair_it)
-{
-  return std::make_pair(pair_it.key(), (*pair_it).get<std::string>());
-}
-
-
 void
-JsonParser::embedded_fracs(const nlohmann::json::iterator & section_it)
+JsonParser::property_files(const nlohmann::json::iterator & section_it)
 {
-  nlohmann::json::iterator
-      frac_it = (*section_it).begin(),
-      frac_end = (*section_it).end();
-
-  for (;frac_it != frac_end; ++frac_it)
+  for (auto prop_it = (*section_it).begin(); prop_it != (*section_it).end(); ++prop_it)
   {
-    if (frac_it.key() == comment)
-      continue;
-    else if (frac_it.key() == "file")
-    {
-      config.efrac_file = (*frac_it).get<std::string>();
+    if (prop_it.key() == comment)
       continue;
-    }
-    else
-    {
-      config.fractures.emplace_back();
-      embedded_fracture((*frac_it).begin(), (*frac_it).end(),
-                        config.fractures.back());
-    }
-  }
-
-}
-
 
-void
-JsonParser::boundary_conditions(const nlohmann::json::iterator & it)
-{
-  nlohmann::json::iterator
-      bc_it = (*it).begin(),
-      bc_end = (*it).end();
-
-  for (;bc_it != bc_end; ++bc_it)
-  {
-    std::cout << "parsing " << bc_it.key() << std::endl;
+    PropertyFileConfig conf;
+    conf.name = prop_it.key();
+    std::cout << "\treading property " << conf.name << std::endl;
+    int var_type = 0;
 
-    if (bc_it.key() == comment)
-      continue;
-    else if (bc_it.key() == "file")
-    {
-      config.bcond_file = (*bc_it).get<std::string>();
-      continue;
-    }
-    else if (bc_it.key() == "Faces")
-    {
-      boundary_conditions_faces((*bc_it).begin(), (*bc_it).end());
-      continue;
-    }
-    else if (bc_it.key() == "Dirichlet nodes")
-    {
-      boundary_conditions_nodes((*bc_it).begin(), (*bc_it).end());
-      continue;
-    }
-    else
+    for (auto it = (*prop_it).begin(); it != (*prop_it).end(); ++it)
     {
-      std::cout << "skipping " << bc_it.key() << std::endl;
-    }
-
-  }
-}
-
-
-void
-JsonParser::boundary_conditions_faces(nlohmann::json::iterator it,
-                                      const nlohmann::json::iterator & end)
-{
-  for (; it != end; ++it)
-  {
-    std::cout << "parsing entry " << it.key() << std::endl;
-    if (it.key() == comment)
-      continue;
-
-    config.bc_faces.emplace_back();
-    auto & conf = config.bc_faces.back();
-    conf.label = std::atoi(it.key().c_str());
-    if (conf.label < 0)
-      throw std::invalid_argument("boundary labels should be positive");
-
-    boundary_conditions_face((*it).begin(), (*it).end(), conf);
-  }
-}
-
-
-void
-JsonParser::boundary_conditions_face(nlohmann::json::iterator         it,
-                                     const nlohmann::json::iterator & end,
-                                     BCConfig & conf)
-{
-  for (; it != end; ++it)
-  {
-    const auto key = it.key();
-    if (key == comment)
-      continue;
-    else if (key == "type")
-      conf.type = (*it).get<int>();
-    else if (key == "value")
-    {
-      const std::vector<std::string> str_values =
-          (*it).get<std::vector<std::string>>();
-      for (std::size_t i=0; i<3; ++i)
+      if (it.key() == comment)
+        continue;
+      else if (it.key() == "file")
+        conf.file = (*it).get<std::string>();
+      else if (it.key() == "format")
+        conf.format = property_file_format((*it).get<std::string>());
+      else if (it.key() == "type")  // flow or mechanics property
+        var_type = ((*it).get<std::string>() == "mechanics") ? 1 : 0;
+      else if (it.key() == "grid" || it.key() == "origin" || it.key() == "spacing")
       {
-        if (str_values[i] == "nan")
-          conf.value[i] = config.nan;
-        else
-          conf.value[i] = std::atof(str_values[i].c_str());
+        const std::vector<double> values = (*it).get<std::vector<double>>();
+        if (values.size() != 3)
+        {
+          std::cout << "\t\tinvalid entry " << it.key() << std::endl;
+          abort();
+        }
+        for (int d=0; d<3; ++d)
+          if (it.key() == "grid")
+            conf.dimensions[d] = static_cast<std::size_t>(values[d]);
+          else if (it.key() == "origin")
+            conf.origin[d] = values[d];
+          else
+            conf.spacing[d] = values[d];
       }
+      else
+        std::cout << "\t\tunknown key: " << it.key() << " skipping" << std::endl;
     }
-    else
-      std::cout << "attribute " << key << " unknown: skipping" << std::endl;
-  }
-}
-
-
-void
-JsonParser::boundary_conditions_nodes(nlohmann::json::iterator         it,
-                                      const nlohmann::json::iterator & end)
-{
-  for (; it != end; ++it)
-  {
-    std::cout << "parsing entry "<< it.key() << std::endl;
 
-    if (it.key() == comment)
-      continue;
-    else if (it.key() == "search tolerance")
+    if (conf.file.empty())
     {
-      config.node_search_tolerance = (*it).get<double>();
-      continue;
+      std::cout << "property " << conf.name << " has no file" << std::endl;
+      abort();
     }
 
-    config.bc_nodes.emplace_back();
-    auto & conf = config.bc_nodes.back();
-    boundary_conditions_node((*it).begin(), (*it).end(), conf);
-  }
-}
-
-
-void
-JsonParser::boundary_conditions_node(nlohmann::json::iterator it,
-                                     const nlohmann::json::iterator & end,
-                                     BCNodeConfig & conf)
-{
-  for (; it != end; ++it)
-  {
-    if (it.key() == comment)
-      continue;
-    else if (it.key() == "coord")
-    {
-      const std::vector<double> v_coord =
-          (*it).get<std::vector<double>>();
-      conf.coord = v_coord;
-    }
-    else if (it.key() == "value")
+    // register the property like a domain variable
+    if (find(conf.name, config.all_vars) == config.all_vars.size())
     {
-      const std::vector<std::string> str_values =
-          (*it).get<std::vector<std::string>>();
-      for (std::size_t i=0; i<3; ++i)
-      {
-        if (str_values[i] == "nan")
-          conf.value[i] = config.nan;
-        else
-          conf.value[i] = std::atof(str_values[i].c_str());
-      }
+      config.all_vars.push_back(conf.name);
+      if (find(conf.name, config.special_keywords) < config.special_keywords.size())
+        config.expression_type.push_back(-1);
+      else
+        config.expression_type.push_back(var_type);
     }
-    else
-      std::cout << "attribute " << it.key() << " unknown: skipping" << std::endl;
+    config.property_files.push_back(conf);
   }
 }
 
-void JsonParser::embedded_fracture(nlohmann::json::iterator it,
-                               const nlohmann::json::iterator & end,
-                               EmbeddedFractureConfig & conf)
-{
-  // default parameters
-  std::string shape = "Rectangle";
-  double height = 1;  // for rectangles and ellipses
-  double length = 1;  // for rectangles and ellipses
-  double dip = 0;
-  double strike = 0;
-  double cohesion = 0;
-  angem::Point<3,double> center = {0, 0, 0};
-  double friction_angle = conf.friction_angle;
-  double dilation_angle = conf.dilation_angle;
-  double aperture = conf.aperture;
-  double conductivity = conf.conductivity;
-  std::size_t n1 = conf.n1;
-  std::size_t n2 = conf.n2;
 
-  for (; it != end; ++it)
-  {
-    const auto key = it.key();
-    std::cout << "\tparsing entry " << key << std::endl;
-    if (key == comment)
-      continue;
-    else if (key == "type")
-    {
-      shape = (*it).get<std::string>();
-      assert (shape == "Rectangle");
-    }
-    else if (key == "height")
-      height = (*it).get<double>();
-    else if (key == "length")
-      length = (*it).get<double>();
-    else if (key == "strike")
-      strike = (*it).get<double>();
-    else if (key == "dip")
-      dip = (*it).get<double>();
-    else if (key == "cohesion")
-      cohesion = (*it).get<double>();
-    else if (key == "friction angle")
-      friction_angle = (*it).get<double>();
-    else if (key == "dilation angle")
-      dilation_angle = (*it).get<double>();
-    else if (key == "aperture")
-      aperture = (*it).get<double>();
-    else if (key == "conductivity")
-      conductivity = (*it).get<double>();
-    else if (key == "remesh")
-    {
-      std::vector<std::size_t> remesh_pars = (*it).get<std::vector<std::size_t>>();
-      if (remesh_pars.size() != 2)
-        std::cout << "wrong entry in remesh. Aborting" << std::endl << std::flush;
-
-      n1 = remesh_pars[0];
-      n2 = remesh_pars[1];
-
-      if ((n1 > 0 and n2 == 0)  or (n2 > 0 and n1 == 0))
-        std::cout << "wrong entry in remesh. Aborting" << std::endl << std::flush;
-    }
-    else if (key == "center")
-      center = (*it).get<std::vector<double>>();
-    else
-      std::cout << "attribute " << key
-                << " unknown: skipping" << std::endl;
-  }
-
-  std::cout << "Making embedded fracture" << std::endl;
-  conf.body = std::make_shared<angem::Rectangle<double>>
-      (center, length, height, dip, strike);
-
-  conf.cohesion = cohesion;
-  conf.friction_angle = friction_angle;
-  conf.dilation_angle = dilation_angle;
-  conf.aperture = aperture;
-  conf.conductivity = conductivity;
-  conf.n1 = n1; conf.n2 = n2;
+std::pair<std::string,std::string>
+JsonParser::get_pair(const nlohmann::json::iterator & pair_it)
+{
+  return std::make_pair(pair_it.key(), (*pair_it).get<std::string>());
 }
 
 
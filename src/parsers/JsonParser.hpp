@@ -16,25 +16,13 @@ class JsonParser
   SimdataConfig & get_config();
  private:
   void parse(const std::string & fname);
+  // section that is not streamed by JsonSaxHandler
+  void section(const std::string & key, nlohmann::json & value);
   // var type can be 0 or 1: flow domain or geomechanics domain
   void domain_props(const nlohmann::json::iterator & section_it,
                          const int                        var_type);
-  void embedded_fracs(const nlohmann::json::iterator & section_it);
-  void boundary_conditions(const nlohmann::json::iterator & section_it);
-  void boundary_conditions_faces(nlohmann::json::iterator it,
-                                 const nlohmann::json::iterator & end);
-  void boundary_conditions_nodes(nlohmann::json::iterator it,
-                                 const nlohmann::json::iterator & end);
-  void boundary_conditions_face(nlohmann::json::iterator it,
-                                const nlohmann::json::iterator & end,
-                                BCConfig & conf);
-  void boundary_conditions_node(nlohmann::json::iterator it,
-                                const nlohmann::json::iterator & end,
-                                BCNodeConfig & conf);
-  void embedded_fracture(nlohmann::json::iterator it,
-                         const nlohmann::json::iterator & end,
-                         EmbeddedFractureConfig & conf);
   void discrete_fracs(const nlohmann::json::iterator & section_it);
+  void property_files(const nlohmann::json::iterator & section_it);
   void discrete_fracture(nlohmann::json::iterator it,
                          const nlohmann::json::iterator & end,
                          DiscreteFractureConfig & conf);
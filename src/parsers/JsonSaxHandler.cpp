@@ -0,0 +1,513 @@
+#include "JsonSaxHandler.hpp"
+#include "FractureList.hpp"
+#include <angem/Rectangle.hpp>
+
+#include <cstdlib>    // std::atof, std::atoi
+#include <iostream>
+#include <limits>     // std::numeric_limits
+#include <stdexcept>  // std::invalid_argument
+
+namespace Parsers
+{
+
+double JsonSaxHandler::Value::number() const
+{
+  if (numbers.size() != 1)
+    throw std::invalid_argument("expected a single value");
+  return numbers[0];
+}
+
+
+const std::string & JsonSaxHandler::Value::text() const
+{
+  if (texts.size() != 1 || texts[0].empty())
+    throw std::invalid_argument("expected a string");
+  return texts[0];
+}
+
+
+double JsonSaxHandler::Value::bc_component(const std::size_t i) const
+{
+  if (numbers.size() != 3)
+    throw std::invalid_argument("boundary condition values should have 3 components");
+  return (texts[i] == "nan") ? SimdataConfig::nan : numbers[i];
+}
+
+
+JsonSaxHandler::JsonSaxHandler(SimdataConfig & config, const std::string & config_file,
+                               const SectionHandler & section_handler)
+    :
+    config(config),
+    config_file(config_file),
+    section_handler(section_handler)
+{}
+
+
+template <typename Event>
+bool JsonSaxHandler::tree_event(const Event & event, const int depth_change)
+{
+  event(*tree_parser);
+  tree_depth += depth_change;
+  if (tree_depth == 0)  // section value is complete
+  {
+    section_handler(path[0], tree);
+    tree_parser.reset();
+    tree = nullptr;
+    section = Section::none;
+  }
+  return true;
+}
+
+
+bool JsonSaxHandler::null()
+{
+  if (section == Section::tree)
+    return tree_event([](auto & parser) {parser.null();}, 0);
+  scalar(std::numeric_limits<double>::quiet_NaN(), nullptr);
+  return true;
+}
+
+
+bool JsonSaxHandler::boolean(bool val)
+{
+  if (section == Section::tree)
+    return tree_event([val](auto & parser) {parser.boolean(val);}, 0);
+  scalar(val ? 1 : 0, nullptr);
+  return true;
+}
+
+
+bool JsonSaxHandler::number_integer(number_integer_t val)
+{
+  if (section == Section::tree)
+    return tree_event([val](auto & parser) {parser.number_integer(val);}, 0);
+  scalar(static_cast<double>(val), nullptr);
+  return true;
+}
+
+
+bool JsonSaxHandler::number_unsigned(number_unsigned_t val)
+{
+  if (section == Section::tree)
+    return tree_event([val](auto & parser) {parser.number_unsigned(val);}, 0);
+  scalar(static_cast<double>(val), nullptr);
+  return true;
+}
+
+
+bool JsonSaxHandler::number_float(number_float_t val, const string_t & s)
+{
+  if (section == Section::tree)
+    return tree_event([val, &s](auto & parser) {parser.number_float(val, s);}, 0);
+  scalar(val, nullptr);
+  return true;
+}
+
+
+bool JsonSaxHandler::string(string_t & val)
+{
+  if (section == Section::tree)
+    return tree_event([&val](auto & parser) {parser.string(val);}, 0);
+  scalar(std::atof(val.c_str()), &val);
+  return true;
+}
+
+
+bool JsonSaxHandler::start_object(std::size_t elements)
+{
+  if (section == Section::tree)
+    return tree_event([elements](auto & parser) {parser.start_object(elements);}, 1);
+  if (skip_depth > 0)
+    skip_depth++;
+  else if (in_array)  // arrays of objects are not attributes: skip the array
+  {
+    std::cout << "\tattribute " << path.back() << " unknown: skipping" << std::endl;
+    in_array = false;
+    skip_depth = 2;
+  }
+  else if (path.size() <= 1)  // root or section object
+  {
+    path.emplace_back();
+    n_entries = 0;
+  }
+  else if (begin_entry())
+    path.emplace_back();
+  else
+  {
+    std::cout << "\tentry " << path.back() << " unknown: skipping" << std::endl;
+    skip_depth = 1;
+  }
+  return true;
+}
+
+
+bool JsonSaxHandler::key(string_t & val)
+{
+  if (section == Section::tree)
+    return tree_event([&val](auto & parser) {parser.key(val);}, 0);
+  if (skip_depth > 0)
+    return true;
+  if (path.empty())
+    throw std::invalid_argument("config should be a JSON object");
+  path.back() = val;
+  if (path.size() == 1)
+    begin_section(val);
+  return true;
+}
+
+
+bool JsonSaxHandler::end_object()
+{
+  if (section == Section::tree)
+    return tree_event([](auto & parser) {parser.end_object();}, -1);
+  if (skip_depth > 0)
+  {
+    skip_depth--;
+    return true;
+  }
+  path.pop_back();
+  if (path.size() == 1)
+    end_section();
+  else if (path.size() > 1)
+    end_entry();
+  return true;
+}
+
+
+bool JsonSaxHandler::start_array(std::size_t elements)
+{
+  if (section == Section::tree)
+    return tree_event([elements](auto & parser) {parser.start_array(elements);}, 1);
+  if (skip_depth > 0)
+    skip_depth++;
+  else if (path.size() <= 1)
+    throw std::invalid_argument("section " + section_name() + " should be an object");
+  else if (in_array)  // nested arrays are not attributes: skip the outer array
+  {
+    std::cout << "\tattribute " << path.back() << " unknown: skipping" << std::endl;
+    in_array = false;
+    skip_depth = 2;
+  }
+  else
+  {
+    in_array = true;
+    current.numbers.clear();
+    current.texts.clear();
+  }
+  return true;
+}
+
+
+bool JsonSaxHandler::end_array()
+{
+  if (section == Section::tree)
+    return tree_event([](auto & parser) {parser.end_array();}, -1);
+  if (skip_depth > 0)
+    skip_depth--;
+  else
+  {
+    in_array = false;
+    attribute(current);
+  }
+  return true;
+}
+
+
+bool JsonSaxHandler::parse_error(std::size_t /* position */, const std::string & /* last_token */,
+                                 const nlohmann::detail::exception & ex)
+{
+  throw std::invalid_argument(ex.what());
+}
+
+
+void JsonSaxHandler::scalar(const double number, const std::string * text)
+{
+  if (skip_depth > 0)
+    return;
+  if (path.size() <= 1)
+    throw std::invalid_argument("section " + section_name() + " should be an object");
+
+  if (!in_array)
+  {
+    current.numbers.clear();
+    current.texts.clear();
+  }
+  current.numbers.push_back(number);
+  current.texts.push_back(text ? *text : std::string());
+  if (!in_array)
+    attribute(current);
+}
+
+
+void JsonSaxHandler::begin_section(const std::string & name)
+{
+  std::cout << "Entering section " << name << std::endl;
+  if (name == "Embedded Fractures")
+    section = Section::embedded_fractures;
+  else if (name == "Wells")
+    section = Section::wells;
+  else if (name == "Boundary conditions")
+    section = Section::boundary_conditions;
+  else
+  {
+    section = Section::tree;
+    tree_parser = std::make_unique<nlohmann::detail::json_sax_dom_parser<nlohmann::json>>(tree);
+    tree_depth = 0;
+  }
+}
+
+
+void JsonSaxHandler::end_section()
+{
+  if (section == Section::embedded_fractures)
+  {
+    if (!list_file.empty())
+    {
+      const std::size_t n_before = config.fractures.size();
+      read_fracture_list(list_file, list_format, config.fractures);
+      n_entries += config.fractures.size() - n_before;
+      list_file.clear();
+    }
+    std::cout << "\tread " << n_entries << " embedded fractures" << std::endl;
+  }
+  else if (section == Section::wells)
+    std::cout << "\tread " << n_entries << " wells" << std::endl;
+  else if (section == Section::boundary_conditions)
+    std::cout << "\tread " << n_entries << " boundary conditions" << std::endl;
+  section = Section::none;
+}
+
+
+bool JsonSaxHandler::begin_entry()
+{
+  const std::size_t level = path.size();
+  const std::string & key = path.back();
+  if (section == Section::embedded_fractures && level == 2)
+  {
+    fracture = FractureEntry();
+    return true;
+  }
+  else if (section == Section::wells && level == 2)
+  {
+    well = WellConfig();
+    well.name = key;
+    return true;
+  }
+  else if (section == Section::boundary_conditions)
+  {
+    if (level == 2)
+      return key == "Faces" || key == "Dirichlet nodes";
+    else if (level == 3 && path[1] == "Faces")
+    {
+      bc_face = BCConfig();
+      bc_face.label = std::atoi(key.c_str());
+      if (bc_face.label < 0)
+        throw std::invalid_argument("boundary labels should be positive");
+      return true;
+    }
+    else if (level == 3)
+    {
+      bc_node = BCNodeConfig();
+      return true;
+    }
+  }
+  return false;
+}
+
+
+void JsonSaxHandler::end_entry()
+{
+  const std::size_t level = path.size();
+  if (section == Section::embedded_fractures && level == 2)
+  {
+    fracture.conf.body = std::make_shared<angem::Rectangle<double>>
+        (fracture.center, fracture.length, fracture.height, fracture.dip, fracture.strike);
+    config.fractures.push_back(std::move(fracture.conf));
+    n_entries++;
+  }
+  else if (section == Section::wells && level == 2)
+  {
+    finish_well();
+    n_entries++;
+  }
+  else if (section == Section::boundary_conditions && level == 3)
+  {
+    if (path[1] == "Faces")
+      config.bc_faces.push_back(bc_face);
+    else
+      config.bc_nodes.push_back(bc_node);
+    n_entries++;
+  }
+}
+
+
+void JsonSaxHandler::attribute(const Value & value)
+{
+  const std::size_t level = path.size();
+  const std::string & key = path.back();
+  if (key == comment)
+    return;
+
+  try
+  {
+    if (section == Section::embedded_fractures && level == 2)
+    {
+      if (key == "file")
+        config.efrac_file = value.text();
+      else if (key == "list file")
+        list_file = config_file_path(config_file, value.text());
+      else if (key == "list format")
+        list_format = property_file_format(value.text());
+      else if (key == "method" && value.text() == "simple")
+        config.edfm_method = EDFMMethod::simple;
+      else if (key == "method" && value.text() == "projection")
+        config.edfm_method = EDFMMethod::projection;
+      else if (key == "method")
+        throw std::invalid_argument("unknown method " + value.text());
+      else
+        std::cout << "\tattribute " << key << " unknown: skipping" << std::endl;
+    }
+    else if (section == Section::embedded_fractures && level == 3)
+      fracture_attribute(key, value);
+    else if (section == Section::wells && level == 2)
+    {
+      if (key == "file")
+        config.wells_file = value.text();
+      else
+        std::cout << "\tattribute " << key << " unknown: skipping" << std::endl;
+    }
+    else if (section == Section::wells && level == 3)
+      well_attribute(key, value);
+    else if (section == Section::boundary_conditions && level == 2 && key == "file")
+      config.bcond_file = value.text();
+    else if (section == Section::boundary_conditions && level == 3 &&
+             path[1] == "Dirichlet nodes" && key == "search tolerance")
+      config.node_search_tolerance = value.number();
+    else if (section == Section::boundary_conditions && level == 4 && path[1] == "Faces" &&
+             (key == "type" || key == "value"))
+    {
+      if (key == "type")
+        bc_face.type = static_cast<int>(value.number());
+      else
+        for (std::size_t i=0; i<3; ++i)
+          bc_face.value[i] = value.bc_component(i);
+    }
+    else if (section == Section::boundary_conditions && level == 4 &&
+             (key == "coord" || key == "value"))
+    {
+      for (std::size_t i=0; i<3; ++i)
+        if (key == "coord")
+          bc_node.coord[i] = value.bc_component(i);
+        else
+          bc_node.value[i] = value.bc_component(i);
+    }
+    else
+      std::cout << "\tattribute " << key << " unknown: skipping" << std::endl;
+  }
+  catch (const std::invalid_argument & e)
+  {
+    const std::string entry = (level > 2) ? path[1] + ", " : std::string();
+    throw std::invalid_argument("section " + section_name() + ", " + entry +
+                                key + ": " + e.what());
+  }
+}
+
+
+void JsonSaxHandler::fracture_attribute(const std::string & key, const Value & value)
+{
+  auto & conf = fracture.conf;
+  if (key == "type")
+  {
+    if (value.text() != "Rectangle")
+      throw std::invalid_argument("only rectangular fractures are supported");
+  }
+  else if (key == "height")
+    fracture.height = value.number();
+  else if (key == "length")
+    fracture.length = value.number();
+  else if (key == "strike")
+    fracture.strike = value.number();
+  else if (key == "dip")
+    fracture.dip = value.number();
+  else if (key == "center")
+  {
+    if (value.numbers.size() != 3)
+      throw std::invalid_argument("center should have 3 coordinates");
+    for (int d=0; d<3; ++d)
+      fracture.center[d] = value.numbers[d];
+  }
+  else if (key == "cohesion")
+    conf.cohesion = value.number();
+  else if (key == "friction angle")
+    conf.friction_angle = value.number();
+  else if (key == "dilation angle")
+    conf.dilation_angle = value.number();
+  else if (key == "aperture")
+    conf.aperture = value.number();
+  else if (key == "conductivity")
+    conf.conductivity = value.number();
+  else if (key == "remesh")
+  {
+    if (value.numbers.size() != 2)
+      throw std::invalid_argument("remesh should have 2 values");
+    conf.n1 = static_cast<std::size_t>(value.numbers[0]);
+    conf.n2 = static_cast<std::size_t>(value.numbers[1]);
+    if ((conf.n1 > 0 && conf.n2 == 0) || (conf.n2 > 0 && conf.n1 == 0))
+      throw std::invalid_argument("remesh values should be both zero or both positive");
+  }
+  else
+    std::cout << "\tattribute " << key << " unknown: skipping" << std::endl;
+}
+
+
+void JsonSaxHandler::well_attribute(const std::string & key, const Value & value)
+{
+  if (key == "name")
+    well.name = value.text();
+  else if (key == "radius")
+    well.radius = value.number();
+  else if (key == "skin")
+    well.skin = value.number();
+  else if (key == "nodes")  // flat list x1, y1, z1, x2, ...
+  {
+    if (value.numbers.empty() || value.numbers.size() % 3 != 0)
+      throw std::invalid_argument("nodes should have 3 coordinates per node");
+    well.coordinates.resize(value.numbers.size() / 3);
+    for (std::size_t i=0; i<well.coordinates.size(); ++i)
+      for (int d=0; d<3; ++d)
+        well.coordinates[i][d] = value.numbers[3*i+d];
+  }
+  else if (key == "perforations")
+  {
+    well.perforated.clear();
+    for (const double flag : value.numbers)
+      well.perforated.push_back(flag != 0);
+  }
+  else
+    std::cout << "\tattribute " << key << " unknown: skipping" << std::endl;
+}
+
+
+void JsonSaxHandler::finish_well()
+{
+  if (well.coordinates.empty())
+    throw std::invalid_argument("well " + well.name + " has no nodes");
+
+  if (well.coordinates.size() > 1)
+  {
+    if (well.perforated.empty())
+      well.perforated.resize(well.coordinates.size(), true);
+    else if (well.perforated.size() != well.coordinates.size() - 1)
+      throw std::invalid_argument("well " + well.name +
+                                  " should have one perforation flag per segment");
+  }
+  config.wells.push_back(std::move(well));
+}
+
+
+std::string JsonSaxHandler::section_name() const
+{
+  return path.empty() ? std::string() : path[0];
+}
+
+}  // end namespace Parsers
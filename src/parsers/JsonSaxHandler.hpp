@@ -0,0 +1,121 @@
+#pragma once
+
+#include <json.hpp>
+#include <SimdataConfig.hpp>
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Parsers
+{
+
+/* Event handler for nlohmann::json::sax_parse that reads a JSON config without
+ * building the document tree of the large sections.
+ * "Embedded Fractures", "Wells" and "Boundary conditions" are read as the events
+ * arrive: every fracture, well and boundary condition goes into the config as soon
+ * as its object ends, so configs with thousands of entries need no memory beyond
+ * the config itself and no key lookups in a tree.
+ * Every other top-level section is small: its tree is built from the same events
+ * and passed to section_handler once the section ends.
+ * Errors in the streamed sections throw std::invalid_argument. */
+class JsonSaxHandler : public nlohmann::json_sax<nlohmann::json>
+{
+ public:
+  // receives (section key, section tree) of the sections that are not streamed
+  using SectionHandler = std::function<void(const std::string &, nlohmann::json &)>;
+
+  // config_file is the path of the parsed file (side files are relative to it)
+  JsonSaxHandler(SimdataConfig & config, const std::string & config_file,
+                 const SectionHandler & section_handler);
+
+  // SAX events
+  bool null() override;
+  bool boolean(bool val) override;
+  bool number_integer(number_integer_t val) override;
+  bool number_unsigned(number_unsigned_t val) override;
+  bool number_float(number_float_t val, const string_t & s) override;
+  bool string(string_t & val) override;
+  bool start_object(std::size_t elements) override;
+  bool key(string_t & val) override;
+  bool end_object() override;
+  bool start_array(std::size_t elements) override;
+  bool end_array() override;
+  bool parse_error(std::size_t position, const std::string & last_token,
+                   const nlohmann::detail::exception & ex) override;
+
+ private:
+  enum class Section {none, tree, embedded_fractures, wells, boundary_conditions};
+
+  // scalar or flat array value of an attribute
+  // strings are kept as text, numbers and booleans as numbers
+  struct Value
+  {
+    std::vector<double> numbers;
+    std::vector<std::string> texts;  // empty for numbers
+    double number() const;
+    const std::string & text() const;
+    // component i of a boundary condition value ("nan" = not set)
+    double bc_component(const std::size_t i) const;
+  };
+
+  // fracture attributes before the fracture body is made
+  struct FractureEntry
+  {
+    EmbeddedFractureConfig conf;
+    double height = 1;
+    double length = 1;
+    double dip = 0;
+    double strike = 0;
+    angem::Point<3,double> center = {0, 0, 0};
+  };
+
+  // forward event to the tree of the current section and pass the tree on when it ends
+  template <typename Event>
+  bool tree_event(const Event & event, const int depth_change);
+  // scalar value or element of the current array
+  void scalar(const double number, const std::string * text);
+  // attribute value at the current path
+  void attribute(const Value & value);
+  // object opens at the current path; returns false if it is not an entry
+  bool begin_entry();
+  // entry object at the current path has ended
+  void end_entry();
+  void begin_section(const std::string & name);
+  void end_section();
+  // attributes of the entries
+  void fracture_attribute(const std::string & key, const Value & value);
+  void well_attribute(const std::string & key, const Value & value);
+  void finish_well();
+  // name of the current section for messages
+  std::string section_name() const;
+
+  SimdataConfig & config;
+  const std::string config_file;
+  SectionHandler section_handler;
+  Section section = Section::none;
+  // key of the current entry in each open object (path[0] is the section)
+  std::vector<std::string> path;
+  // >0 while inside an ignored value (levels of open objects and arrays)
+  std::size_t skip_depth = 0;
+  // value of the current attribute
+  bool in_array = false;
+  Value current;
+  // tree of a section that is not streamed
+  nlohmann::json tree;
+  std::unique_ptr<nlohmann::detail::json_sax_dom_parser<nlohmann::json>> tree_parser;
+  int tree_depth = 0;
+  // entries being read
+  FractureEntry fracture;
+  WellConfig well;
+  BCConfig bc_face;
+  BCNodeConfig bc_node;
+  // fracture list side file (absolute path)
+  std::string list_file;
+  PropertyFileFormat list_format = PropertyFileFormat::text;
+  std::size_t n_entries = 0;  // entries read in the current section
+  const std::string comment = "_comment_";
+};
+
+}  // end namespace Parsers
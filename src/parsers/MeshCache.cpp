@@ -0,0 +1,388 @@
+#include "MeshCache.hpp"
+
+#include <cstdio>     // std::rename, std::remove
+#include <cstring>    // std::memcpy
+#include <fstream>
+#include <iostream>
+#include <stdexcept>  // std::runtime_error
+#include <vector>
+
+#ifdef __unix__
+#include <fcntl.h>     // open
+#include <sys/mman.h>  // mmap
+#include <sys/stat.h>  // fstat
+#include <unistd.h>    // close
+#endif
+
+namespace Parsers
+{
+
+namespace
+{
+
+static_assert(sizeof(std::size_t) == sizeof(std::uint64_t),
+              "mesh cache assumes 64-bit size_t");
+
+const std::uint64_t cache_magic = 0x48534d5347324d4dULL;  // "MM2GSMSH"
+const std::uint64_t cache_version = 1;
+const std::uint64_t byte_order_mark = 0x0102030405060708ULL;
+
+struct CacheHeader
+{
+  std::uint64_t magic = cache_magic;
+  std::uint64_t version = cache_version;
+  std::uint64_t byte_order = byte_order_mark;
+  std::uint64_t mesh_hash = 0;
+  std::uint64_t n_vertices = 0;
+  std::uint64_t n_cells = 0;
+  std::uint64_t n_cell_entries = 0;      // total number of cell vertices
+  std::uint64_t n_faces = 0;
+  std::uint64_t n_face_entries = 0;      // total number of face vertices
+  std::uint64_t n_neighbor_entries = 0;  // total number of face neighbors
+};
+
+// size of the file described by header
+std::uint64_t expected_size(const CacheHeader & h)
+{
+  return sizeof(CacheHeader)
+      + 3 * h.n_vertices * sizeof(double)
+      + (h.n_cells + 1 + h.n_cell_entries) * sizeof(std::uint64_t)
+      + 2 * h.n_cells * sizeof(std::int32_t)
+      + 2 * h.n_faces * sizeof(std::uint64_t)       // index, old_index
+      + 2 * h.n_faces * sizeof(std::int32_t)        // marker, vtk_id
+      + (h.n_faces + 1 + h.n_face_entries) * sizeof(std::uint64_t)
+      + (h.n_faces + 1 + h.n_neighbor_entries) * sizeof(std::uint64_t);
+}
+
+
+// read-only view of a whole file (memory-mapped when possible)
+class MappedFile
+{
+ public:
+  explicit MappedFile(const std::string & fname)
+  {
+#ifdef __unix__
+    const int fd = ::open(fname.c_str(), O_RDONLY);
+    if (fd < 0) return;
+    struct stat st;
+    if (::fstat(fd, &st) == 0 && st.st_size > 0)
+    {
+      void * ptr = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (ptr != MAP_FAILED)
+      {
+        ptr_data = static_cast<const char*>(ptr);
+        n_bytes = st.st_size;
+      }
+    }
+    ::close(fd);
+#else
+    std::ifstream in(fname.c_str(), std::ios::binary | std::ios::ate);
+    if (!in) return;
+    buffer.resize(in.tellg());
+    in.seekg(0);
+    in.read(buffer.data(), buffer.size());
+    if (!in) return;
+    ptr_data = buffer.data();
+    n_bytes = buffer.size();
+#endif
+  }
+
+  ~MappedFile()
+  {
+#ifdef __unix__
+    if (ptr_data)
+      ::munmap(const_cast<char*>(ptr_data), n_bytes);
+#endif
+  }
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile & operator=(const MappedFile &) = delete;
+
+  const char * data() const {return ptr_data;}
+  std::size_t size() const {return n_bytes;}
+
+ private:
+  const char * ptr_data = nullptr;
+  std::size_t n_bytes = 0;
+#ifndef __unix__
+  std::vector<char> buffer;
+#endif
+};
+
+
+// sequential reader over a memory block
+struct Cursor
+{
+  const char * pos;
+
+  template <typename T>
+  void read(T * dst, const std::size_t n)
+  {
+    std::memcpy(dst, pos, n * sizeof(T));
+    pos += n * sizeof(T);
+  }
+
+  template <typename T>
+  T read()
+  {
+    T value;
+    read(&value, 1);
+    return value;
+  }
+};
+
+
+template <typename T>
+void write(const T * src, const std::size_t n, std::ofstream & out)
+{
+  out.write(reinterpret_cast<const char*>(src), n * sizeof(T));
+}
+
+// write vectors as offsets + flat entries
+void write_jagged(const std::vector<const std::vector<std::size_t>*> & arrays,
+                  std::ofstream & out)
+{
+  std::vector<std::uint64_t> offsets(arrays.size() + 1, 0);
+  for (std::size_t i = 0; i < arrays.size(); ++i)
+    offsets[i + 1] = offsets[i] + arrays[i]->size();
+  write(offsets.data(), offsets.size(), out);
+  for (const auto * array : arrays)
+    write(array->data(), array->size(), out);
+}
+
+// read n vectors written with write_jagged
+// returns false if the offsets do not add up to n_entries values
+// or if a value is not below max_value
+template <typename Setter>
+bool read_jagged(const std::size_t n, const std::uint64_t n_entries,
+                 const std::uint64_t max_value, Cursor & cursor, Setter && set)
+{
+  std::vector<std::uint64_t> offsets(n + 1);
+  cursor.read(offsets.data(), n + 1);
+  if (offsets[0] != 0 || offsets[n] != n_entries)
+    return false;
+  for (std::size_t i = 0; i < n; ++i)
+    if (offsets[i + 1] < offsets[i])
+      return false;
+
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    std::vector<std::size_t> values(offsets[i + 1] - offsets[i]);
+    cursor.read(values.data(), values.size());
+    for (const std::size_t value : values)
+      if (value >= max_value)
+        return false;
+    set(i, std::move(values));
+  }
+  return true;
+}
+
+}  // end anonymous namespace
+
+
+std::uint64_t MeshCache::file_hash(const std::string & fname)
+{
+  std::ifstream in(fname.c_str(), std::ios::binary);
+  if (!in)
+    throw std::runtime_error("cannot read file " + fname);
+
+  // FNV-1a over 64-bit words
+  const std::uint64_t prime = 0x100000001b3ULL;
+  std::uint64_t hash = 0xcbf29ce484222325ULL;
+  std::uint64_t length = 0;
+  std::vector<char> buffer(1 << 20);
+  while (in)
+  {
+    in.read(buffer.data(), buffer.size());
+    const std::size_t n = in.gcount();
+    length += n;
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+      std::uint64_t word;
+      std::memcpy(&word, buffer.data() + i, 8);
+      hash = (hash ^ word) * prime;
+    }
+    for (; i < n; ++i)
+      hash = (hash ^ static_cast<unsigned char>(buffer[i])) * prime;
+  }
+  return (hash ^ length) * prime;
+}
+
+
+bool MeshCache::load(const std::string & cache_file,
+                     const std::uint64_t mesh_hash,
+                     mesh::Mesh        & grid)
+{
+  if (!grid.empty() || grid.n_vertices() > 0)
+    throw std::invalid_argument("mesh cache can only be loaded into an empty grid");
+
+  const MappedFile file(cache_file);
+  if (!file.data() || file.size() < sizeof(CacheHeader))
+    return false;
+
+  Cursor cursor{file.data()};
+  const CacheHeader header = cursor.read<CacheHeader>();
+  if (header.magic != cache_magic || header.version != cache_version ||
+      header.byte_order != byte_order_mark || header.mesh_hash != mesh_hash ||
+      expected_size(header) != file.size())
+    return false;
+
+  // corrupt tables: drop what has been read so that the mesh file is parsed
+  const auto corrupted = [&cache_file, &grid]
+  {
+    std::cout << "warning: corrupted mesh cache " << cache_file << std::endl;
+    grid = mesh::Mesh();
+    return false;
+  };
+
+  // vertices
+  grid.vertices.points.reserve(header.n_vertices);
+  for (std::size_t i = 0; i < header.n_vertices; ++i)
+  {
+    angem::Point<3,double> vertex;
+    for (int d = 0; d < 3; ++d)
+      vertex[d] = cursor.read<double>();
+    grid.vertices.insert(vertex);
+  }
+
+  // cells
+  grid.cells.resize(header.n_cells);
+  if (!read_jagged(header.n_cells, header.n_cell_entries, header.n_vertices, cursor,
+                   [&grid](const std::size_t i, std::vector<std::size_t> && v)
+                   {
+                     grid.cells[i] = std::move(v);
+                   }))
+    return corrupted();
+  grid.shape_ids.resize(header.n_cells);
+  cursor.read(grid.shape_ids.data(), header.n_cells);
+  grid.cell_markers.resize(header.n_cells);
+  cursor.read(grid.cell_markers.data(), header.n_cells);
+
+  // faces
+  std::vector<mesh::Face> faces(header.n_faces);
+  std::vector<std::uint64_t> indices(2 * header.n_faces);
+  cursor.read(indices.data(), indices.size());
+  std::vector<std::int32_t> tags(2 * header.n_faces);
+  cursor.read(tags.data(), tags.size());
+  for (std::size_t i = 0; i < header.n_faces; ++i)
+  {
+    faces[i].index = indices[2*i];
+    faces[i].old_index = indices[2*i + 1];
+    faces[i].marker = tags[2*i];
+    faces[i].vtk_id = tags[2*i + 1];
+  }
+  if (!read_jagged(header.n_faces, header.n_face_entries, header.n_vertices, cursor,
+                   [&faces](const std::size_t i, std::vector<std::size_t> && v)
+                   {
+                     faces[i].ordered_indices = std::move(v);
+                   }))
+    return corrupted();
+  if (!read_jagged(header.n_faces, header.n_neighbor_entries, header.n_cells, cursor,
+                   [&faces](const std::size_t i, std::vector<std::size_t> && v)
+                   {
+                     faces[i].neighbors = std::move(v);
+                   }))
+    return corrupted();
+
+  // face indices must be a permutation of 0..n_faces-1
+  std::vector<bool> index_used(header.n_faces, false);
+  for (const auto & face : faces)
+  {
+    if (face.index >= header.n_faces || index_used[face.index])
+      return corrupted();
+    index_used[face.index] = true;
+  }
+
+  // older caches store faces in hash order
+  grid.map_faces.reserve(header.n_faces);
+  grid.faces.resize(header.n_faces);
+  for (auto & face : faces)
+  {
+    const auto hash = mesh::hash_value(face.ordered_indices);
+    grid.map_faces.insert({hash, face.index});
+    grid.faces[face.index] = std::move(face);
+  }
+  return true;
+}
+
+
+void MeshCache::save(const std::string & cache_file,
+                     const std::uint64_t mesh_hash,
+                     const mesh::Mesh  & grid)
+{
+  CacheHeader header;
+  header.mesh_hash = mesh_hash;
+  header.n_vertices = grid.n_vertices();
+  header.n_cells = grid.n_cells();
+  for (const auto & cell : grid.cells)
+    header.n_cell_entries += cell.size();
+  header.n_faces = grid.n_faces();
+
+  std::vector<const mesh::Face*> faces;
+  faces.reserve(grid.n_faces());
+  for (const auto & face : grid.faces)
+  {
+    faces.push_back(&face);
+    header.n_face_entries += face.ordered_indices.size();
+    header.n_neighbor_entries += face.neighbors.size();
+  }
+
+  // write into a temporary file so that an interrupted run
+  // does not leave a broken cache behind
+  const std::string tmp_file = cache_file + ".tmp";
+  {
+    std::ofstream out(tmp_file.c_str(), std::ios::binary);
+    if (!out)
+      throw std::runtime_error("cannot open file " + tmp_file);
+
+    write(&header, 1, out);
+
+    const auto & vertices = grid.get_vertices();
+    for (const auto & vertex : vertices)
+      for (int d = 0; d < 3; ++d)
+        write(&vertex[d], 1, out);
+
+    std::vector<const std::vector<std::size_t>*> arrays;
+    arrays.reserve(grid.n_cells());
+    for (const auto & cell : grid.cells)
+      arrays.push_back(&cell);
+    write_jagged(arrays, out);
+    write(grid.shape_ids.data(), grid.shape_ids.size(), out);
+    write(grid.cell_markers.data(), grid.cell_markers.size(), out);
+
+    std::vector<std::uint64_t> indices;
+    std::vector<std::int32_t> tags;
+    indices.reserve(2 * faces.size());
+    tags.reserve(2 * faces.size());
+    for (const mesh::Face * face : faces)
+    {
+      indices.push_back(face->index);
+      indices.push_back(face->old_index);
+      tags.push_back(face->marker);
+      tags.push_back(face->vtk_id);
+    }
+    write(indices.data(), indices.size(), out);
+    write(tags.data(), tags.size(), out);
+
+    arrays.clear();
+    for (const mesh::Face * face : faces)
+      arrays.push_back(&face->ordered_indices);
+    write_jagged(arrays, out);
+    arrays.clear();
+    for (const mesh::Face * face : faces)
+      arrays.push_back(&face->neighbors);
+    write_jagged(arrays, out);
+
+    if (!out)
+      throw std::runtime_error("failed writing " + tmp_file);
+  }
+
+  if (std::rename(tmp_file.c_str(), cache_file.c_str()) != 0)
+  {
+    std::remove(tmp_file.c_str());
+    throw std::runtime_error("cannot write " + cache_file);
+  }
+}
+
+}  // end namespace Parsers
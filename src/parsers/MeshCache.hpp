@@ -0,0 +1,38 @@
+#pragma once
+
+#include <mesh/Mesh.hpp>
+
+#include <cstdint>  // uint64_t
+#include <string>
+
+namespace Parsers
+{
+
+/* Binary snapshot of a parsed mesh (vertices, cells, shape ids,
+ * markers and the face table) for fast restarts.
+ * The snapshot stores the content hash of the mesh file it was
+ * made from; it is only loaded if the hash matches, so editing the
+ * mesh file invalidates it. Snapshots are memory-mapped on load.
+ * The format is versioned and native-endian (not portable
+ * between machines with different byte order). */
+class MeshCache
+{
+ public:
+  // content hash of a file; throws std::runtime_error if cannot read
+  static std::uint64_t file_hash(const std::string & fname);
+  // load mesh from cache_file into an empty grid
+  // returns false (and leaves grid untouched) if the cache is missing,
+  // corrupt, of a different version, or made from a different mesh file
+  static bool load(const std::string & cache_file,
+                   const std::uint64_t mesh_hash,
+                   mesh::Mesh        & grid);
+  // save grid into cache_file; throws std::runtime_error on failure
+  static void save(const std::string & cache_file,
+                   const std::uint64_t mesh_hash,
+                   const mesh::Mesh  & grid);
+
+ private:
+  MeshCache();
+};
+
+}  // end namespace Parsers
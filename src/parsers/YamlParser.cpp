@@ -1,4 +1,5 @@
 #include <YamlParser.hpp>
+#include "FractureList.hpp"
 #include "yaml-cpp/node/parse.h"  // loadfile
 #include <angem/Rectangle.hpp>
 
@@ -12,6 +13,7 @@ YamlParser::YamlParser()
 
 void YamlParser::parse_file(const std::string & fname)
 {
+  config_file = fname;
   YAML::Node main_node = YAML::LoadFile(fname);
 
   for(YAML::const_iterator it=main_node.begin();it != main_node.end();++it)
@@ -35,6 +37,26 @@ void YamlParser::parse_file(const std::string & fname)
       section_wells(it->second);
     else if (key == "Multiscale")
       section_multiscale(it->second);
+    else if (key == "Property Files")
+      section_property_files(it->second);
+    else if (key == "VTK pieces")
+      config.n_vtk_pieces = it->second.as<std::size_t>();
+    else if (key == "Mesh cache")
+      config.mesh_cache = it->second.as<bool>();
+    else if (key == "Stage cache")
+      config.stage_cache = it->second.as<bool>();
+    else if (key == "Stage cache size")  // GB
+      config.stage_cache_max_bytes = static_cast<std::size_t>(it->second.as<double>() * (1 << 30));
+    else if (key == "Stream connections")
+      config.stream_connections = it->second.as<bool>();
+    else if (key == "Renumbering")
+      config.renumbering = renumbering_method(it->second.as<std::string>());
+    else if (key == "Output formats")
+    {
+      config.output_formats.clear();
+      for (const auto & name : it->second.as<std::vector<std::string>>())
+        config.output_formats.push_back(output_format(name));
+    }
     else
       std::cout << "Unknown key: " << key << " skipping" << std::endl;
   }
@@ -44,6 +66,8 @@ void YamlParser::parse_file(const std::string & fname)
 
 void YamlParser::embedded_fracs(const YAML::Node & node)
 {
+  std::string list_file;
+  PropertyFileFormat list_format = PropertyFileFormat::text;
   for (auto it = node.begin(); it!=node.end(); ++it)
   {
     const std::string key = it->first.as<std::string>();
@@ -66,9 +90,16 @@ void YamlParser::embedded_fracs(const YAML::Node & node)
       config.fractures.emplace_back();
       embedded_fracture(it->second, config.fractures.back());
     }
+    else if (key == "list file")
+      list_file = config_file_path(config_file, it->second.as<std::string>());
+    else if (key == "list format")
+      list_format = property_file_format(it->second.as<std::string>());
     else
       std::cout << "\t\tattribute " << key << " unknown: skipping" << std::endl;
   }
+
+  if (!list_file.empty())
+    read_fracture_list(list_file, list_format, config.fractures);
 }
 
 
@@ -475,6 +506,8 @@ void YamlParser::read_well(const YAML::Node & node,
       well.name = it->second.as<std::string>();
     else if (key == "radius")
       well.radius = it->second.as<double>();
+    else if (key == "skin")
+      well.skin = it->second.as<double>();
     else if (key == "nodes")
     {
       const std::string line = it->second.as<std::string>();
@@ -522,6 +555,65 @@ void YamlParser::read_well(const YAML::Node & node,
 }
 
 
+void YamlParser::section_property_files(const YAML::Node & node)
+{
+  for (auto it = node.begin(); it!=node.end(); ++it)
+  {
+    PropertyFileConfig conf;
+    conf.name = it->first.as<std::string>();
+    std::cout << "\treading property " << conf.name << std::endl;
+    int var_type = 0;
+
+    for (auto entry = it->second.begin(); entry != it->second.end(); ++entry)
+    {
+      const std::string key = entry->first.as<std::string>();
+      if (key == "file")
+        conf.file = entry->second.as<std::string>();
+      else if (key == "format")
+        conf.format = property_file_format(entry->second.as<std::string>());
+      else if (key == "type")  // flow or mechanics property
+        var_type = (entry->second.as<std::string>() == "mechanics") ? 1 : 0;
+      else if (key == "grid" || key == "origin" || key == "spacing")
+      {
+        std::istringstream iss(entry->second.as<std::string>());
+        std::array<double,3> values;
+        if (!(iss >> values[0] >> values[1] >> values[2]))
+        {
+          std::cout << "\t\tinvalid entry " << key << std::endl;
+          abort();
+        }
+        for (int d=0; d<3; ++d)
+          if (key == "grid")
+            conf.dimensions[d] = static_cast<std::size_t>(values[d]);
+          else if (key == "origin")
+            conf.origin[d] = values[d];
+          else
+            conf.spacing[d] = values[d];
+      }
+      else
+        std::cout << "\t\tunknown key: " << key << " skipping" << std::endl;
+    }
+
+    if (conf.file.empty())
+    {
+      std::cout << "property " << conf.name << " has no file" << std::endl;
+      abort();
+    }
+
+    // register the property like a domain variable
+    if (find(conf.name, config.all_vars) == config.all_vars.size())
+    {
+      config.all_vars.push_back(conf.name);
+      if (find(conf.name, config.special_keywords) < config.special_keywords.size())
+        config.expression_type.push_back(-1);
+      else
+        config.expression_type.push_back(var_type);
+    }
+    config.property_files.push_back(conf);
+  }
+}
+
+
 void YamlParser::section_multiscale(const YAML::Node & node)
 {
   for (auto it = node.begin(); it!=node.end(); ++it)
@@ -543,6 +635,11 @@ void YamlParser::section_multiscale(const YAML::Node & node)
       config.n_multiscale_blocks = it->second.as<std::array<size_t,3>>();
       config.partitioning_method = PartitioningMethod::geometric;
     }
+    else if (key == "morton")
+    {
+      config.n_multiscale_blocks[0] = it->second.as<std::size_t>();
+      config.partitioning_method = PartitioningMethod::morton;
+    }
     else if (key == "elimination level")
     {
       config.elimination_level = it->second.as<std::size_t>();
@@ -25,6 +25,7 @@ class YamlParser
   void boundary_conditions(const YAML::Node & node);
   void section_wells(const YAML::Node & node);
   void section_multiscale(const YAML::Node & node);
+  void section_property_files(const YAML::Node & node);
   // subsections
   void boundary_conditions_faces(const YAML::Node & node);
   void boundary_conditions_nodes(const YAML::Node & node);
@@ -64,6 +65,7 @@ class YamlParser
 
   // ATTRIBUTES
   SimdataConfig config;
+  std::string config_file;  // path of the parsed file
 };
 
 }
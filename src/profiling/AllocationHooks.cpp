@@ -0,0 +1,37 @@
+#include "Profiler.hpp"
+
+#include <cstdlib>  // std::malloc, std::free
+#include <new>      // std::bad_alloc, std::get_new_handler
+
+// Global allocation functions that feed the profiler counters
+// (array and nothrow versions forward to these).
+// Replacing operator new affects the whole process, so this file is not part
+// of any library: executables add it with -DMSH2GPRS_TRACK_ALLOCATIONS=ON.
+
+void * operator new(std::size_t size)
+{
+  if (size == 0) size = 1;
+  void * ptr;
+  while ((ptr = std::malloc(size)) == nullptr)
+  {
+    std::new_handler handler = std::get_new_handler();
+    if (!handler) throw std::bad_alloc();
+    handler();
+  }
+  profiling::detail::record_allocation(ptr, size);
+  return ptr;
+}
+
+
+void operator delete(void * ptr) noexcept
+{
+  if (!ptr) return;
+  profiling::detail::record_deallocation(ptr);
+  std::free(ptr);
+}
+
+
+void operator delete(void * ptr, std::size_t) noexcept
+{
+  operator delete(ptr);
+}
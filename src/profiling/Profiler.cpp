@@ -0,0 +1,301 @@
+#include "Profiler.hpp"
+
+#include <algorithm>  // std::max
+#include <atomic>
+#include <fstream>
+#include <iomanip>    // std::setw
+#include <stdexcept>  // std::runtime_error
+
+#ifdef __linux__
+#include <sys/resource.h>  // getrusage
+#include <unistd.h>        // sysconf
+#endif
+
+#ifdef __GLIBC__
+#include <malloc.h>  // malloc_usable_size
+#endif
+
+namespace profiling
+{
+
+namespace
+{
+
+// global allocation counters, updated by the operator new / delete
+// replacements in AllocationHooks.cpp (if they are linked)
+std::atomic<std::size_t> total_allocations{0};
+std::atomic<std::size_t> total_allocated_bytes{0};
+std::atomic<std::size_t> live_heap_bytes{0};
+std::atomic<std::size_t> live_heap_peak{0};
+
+// escape a string for json
+std::string json_string(const std::string & str)
+{
+  std::string result = "\"";
+  for (const char c : str)
+  {
+    if (c == '"' || c == '\\') result += '\\';
+    result += c;
+  }
+  return result + "\"";
+}
+
+constexpr double megabyte = 1024.0 * 1024.0;
+
+}  // end anonymous namespace
+
+
+Profiler & Profiler::instance()
+{
+  static Profiler profiler;
+  return profiler;
+}
+
+
+Profiler::Profiler()
+    :
+    start(clock::now())
+{}
+
+
+double Profiler::elapsed() const
+{
+  return std::chrono::duration<double>(clock::now() - start).count();
+}
+
+
+std::size_t Profiler::begin(const std::string & name)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  auto & stack = open_stages[std::this_thread::get_id()];
+  const std::size_t parent = stack.empty() ? StageRecord::none : stack.back().id;
+
+  // reuse the record if the stage has been run before
+  std::size_t id = stages.size();
+  for (std::size_t i = 0; i < stages.size(); ++i)
+    if (stages[i].parent == parent && stages[i].name == name)
+    {
+      id = i;
+      break;
+    }
+  if (id == stages.size())
+  {
+    StageRecord stage;
+    stage.name = name;
+    stage.depth = stack.size();
+    stage.parent = parent;
+    stages.push_back(stage);
+  }
+
+  // start a new heap peak for this stage; the parent peak is restored in end()
+  const std::size_t parent_heap_peak = live_heap_peak.load(std::memory_order_relaxed);
+  live_heap_peak.store(live_heap(), std::memory_order_relaxed);
+  stack.push_back({id, clock::now(), n_allocations(), allocated_bytes(), parent_heap_peak});
+  return id;
+}
+
+
+void Profiler::end(const std::size_t id)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  // stages must be closed in reverse order
+  const auto it = open_stages.find(std::this_thread::get_id());
+  if (it == open_stages.end() || it->second.empty() || it->second.back().id != id) return;
+
+  auto & stack = it->second;
+  const OpenStage & open = stack.back();
+  StageRecord & stage = stages[id];
+  stage.n_calls++;
+  stage.seconds += std::chrono::duration<double>(clock::now() - open.start).count();
+  stage.rss_end = current_rss();
+  stage.peak_rss = peak_rss();
+  stage.n_allocations += n_allocations() - open.n_allocations;
+  stage.allocated_bytes += allocated_bytes() - open.allocated_bytes;
+  const std::size_t heap_peak = live_heap_peak.load(std::memory_order_relaxed);
+  stage.heap_peak = std::max(stage.heap_peak, heap_peak);
+
+  live_heap_peak.store(std::max(open.parent_heap_peak, heap_peak), std::memory_order_relaxed);
+  stack.pop_back();
+  if (stack.empty())
+    open_stages.erase(it);
+}
+
+
+void Profiler::print_summary(std::ostream & out) const
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  const auto flags = out.flags();
+  const auto precision = out.precision();
+
+  out << std::left << std::setw(44) << "stage"
+      << std::right
+      << std::setw(8) << "calls"
+      << std::setw(10) << "time [s]"
+      << std::setw(16) << "heap peak [MB]"
+      << std::setw(16) << "allocated [MB]"
+      << std::setw(12) << "allocs"
+      << std::setw(12) << "RSS [MB]"
+      << std::endl;
+  out << std::string(118, '-') << std::endl;
+  out << std::fixed;
+  // print children right after their parents
+  std::vector<std::size_t> order;
+  order.reserve(stages.size());
+  std::vector<std::size_t> to_visit;
+  for (std::size_t i = stages.size(); i-- > 0;)
+    if (stages[i].parent == StageRecord::none)
+      to_visit.push_back(i);
+  while (!to_visit.empty())
+  {
+    const std::size_t i = to_visit.back();
+    to_visit.pop_back();
+    order.push_back(i);
+    for (std::size_t j = stages.size(); j-- > i + 1;)
+      if (stages[j].parent == i)
+        to_visit.push_back(j);
+  }
+
+  for (const std::size_t i : order)
+  {
+    const StageRecord & stage = stages[i];
+    if (stage.n_calls == 0) continue;
+    const std::string name = std::string(2 * stage.depth, ' ') + stage.name;
+    out << std::left << std::setw(44) << name.substr(0, 43)
+        << std::right
+        << std::setw(8) << stage.n_calls
+        << std::setw(10) << std::setprecision(3) << stage.seconds
+        << std::setw(16) << std::setprecision(1) << stage.heap_peak / megabyte
+        << std::setw(16) << stage.allocated_bytes / megabyte
+        << std::setw(12) << stage.n_allocations
+        << std::setw(12) << stage.rss_end / megabyte
+        << std::endl;
+  }
+  out << std::string(118, '-') << std::endl;
+  out << std::left << std::setw(44) << "total"
+      << std::right
+      << std::setw(8) << ""
+      << std::setw(10) << std::setprecision(3) << elapsed()
+      << std::setw(16) << ""
+      << std::setw(16) << std::setprecision(1) << allocated_bytes() / megabyte
+      << std::setw(12) << n_allocations()
+      << std::setw(12) << peak_rss() / megabyte
+      << "  (peak)" << std::endl;
+
+  out.flags(flags);
+  out.precision(precision);
+}
+
+
+void Profiler::write_json(const std::string & fname) const
+{
+  std::ofstream out(fname.c_str());
+  if (!out)
+    throw std::runtime_error("cannot open file " + fname);
+
+  std::lock_guard<std::mutex> lock(mutex);
+  out << std::setprecision(9);
+  out << "{\n";
+  out << "  \"total_seconds\": " << elapsed() << ",\n";
+  out << "  \"peak_rss_bytes\": " << peak_rss() << ",\n";
+  out << "  \"allocations\": " << n_allocations() << ",\n";
+  out << "  \"allocated_bytes\": " << allocated_bytes() << ",\n";
+  out << "  \"stages\": [";
+  bool first = true;
+  for (std::size_t i = 0; i < stages.size(); ++i)
+  {
+    const StageRecord & stage = stages[i];
+    if (stage.n_calls == 0) continue;
+    out << (first ? "\n" : ",\n");
+    first = false;
+    out << "    {"
+        << "\"name\": " << json_string(stage.name) << ", "
+        << "\"id\": " << i << ", "
+        << "\"parent\": ";
+    if (stage.parent == StageRecord::none) out << "null";
+    else out << stage.parent;
+    out << ", "
+        << "\"depth\": " << stage.depth << ", "
+        << "\"calls\": " << stage.n_calls << ", "
+        << "\"seconds\": " << stage.seconds << ", "
+        << "\"rss_end_bytes\": " << stage.rss_end << ", "
+        << "\"peak_rss_bytes\": " << stage.peak_rss << ", "
+        << "\"heap_peak_bytes\": " << stage.heap_peak << ", "
+        << "\"allocations\": " << stage.n_allocations << ", "
+        << "\"allocated_bytes\": " << stage.allocated_bytes
+        << "}";
+  }
+  out << "\n  ]\n}\n";
+}
+
+
+std::size_t Profiler::current_rss()
+{
+#ifdef __linux__
+  std::ifstream statm("/proc/self/statm");
+  std::size_t total_pages = 0, resident_pages = 0;
+  if (statm >> total_pages >> resident_pages)
+    return resident_pages * static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+#endif
+  return 0;
+}
+
+
+std::size_t Profiler::peak_rss()
+{
+#ifdef __linux__
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) == 0)
+    return static_cast<std::size_t>(usage.ru_maxrss) * 1024;  // kilobytes on linux
+#endif
+  return 0;
+}
+
+
+std::size_t Profiler::n_allocations()
+{
+  return total_allocations.load(std::memory_order_relaxed);
+}
+
+
+std::size_t Profiler::allocated_bytes()
+{
+  return total_allocated_bytes.load(std::memory_order_relaxed);
+}
+
+
+std::size_t Profiler::live_heap()
+{
+  return live_heap_bytes.load(std::memory_order_relaxed);
+}
+
+
+namespace detail
+{
+
+void record_allocation(void * ptr, const std::size_t size)
+{
+  total_allocations.fetch_add(1, std::memory_order_relaxed);
+  total_allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+#ifdef __GLIBC__
+  const std::size_t usable = malloc_usable_size(ptr);
+  const std::size_t live = live_heap_bytes.fetch_add(usable, std::memory_order_relaxed) + usable;
+  std::size_t peak = live_heap_peak.load(std::memory_order_relaxed);
+  while (live > peak &&
+         !live_heap_peak.compare_exchange_weak(peak, live, std::memory_order_relaxed));
+#else
+  (void) ptr;
+#endif
+}
+
+void record_deallocation(void * ptr)
+{
+#ifdef __GLIBC__
+  live_heap_bytes.fetch_sub(malloc_usable_size(ptr), std::memory_order_relaxed);
+#else
+  (void) ptr;
+#endif
+}
+
+}  // end namespace detail
+
+}  // end namespace profiling
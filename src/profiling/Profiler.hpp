@@ -0,0 +1,117 @@
+#pragma once
+
+#include <chrono>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace profiling
+{
+
+// accumulated timing and memory usage of one (sub)stage of the pipeline
+struct StageRecord
+{
+  std::string name;
+  std::size_t depth = 0;           // nesting level (0 = top-level stage)
+  std::size_t parent = none;       // index of the parent stage
+  std::size_t n_calls = 0;         // how many times the stage was run
+  double seconds = 0;              // wall time (all calls)
+  std::size_t rss_end = 0;         // resident set size after the last call [bytes]
+  std::size_t peak_rss = 0;        // process peak resident set size after the last call [bytes]
+  std::size_t heap_peak = 0;       // live heap peak during the stage [bytes]
+  std::size_t n_allocations = 0;   // number of operator new calls (all calls)
+  std::size_t allocated_bytes = 0; // bytes requested from operator new (all calls)
+  static constexpr std::size_t none = static_cast<std::size_t>(-1);
+};
+
+/* Collects per-stage wall time and memory counters.
+ * Stages are opened and closed with ScopedTimer and may be nested.
+ * Repeated runs of a stage with the same name and parent
+ * (e.g. in a loop) are accumulated into a single record.
+ * Allocation counters come from the global operator new/delete
+ * replacements in AllocationHooks.cpp, which only executables built with
+ * MSH2GPRS_TRACK_ALLOCATIONS link (live heap is only tracked with glibc);
+ * otherwise the allocation and heap counters stay zero.
+ * Each thread has its own stack of open stages, so stages may be
+ * timed from several threads at once; in that case heap peaks
+ * include allocations made by the other threads. */
+class Profiler
+{
+ public:
+  // the global profiler
+  static Profiler & instance();
+  // open a stage, returns its id
+  std::size_t begin(const std::string & name);
+  // close a stage opened with begin
+  void end(const std::size_t id);
+  // all recorded stages in the order they were first opened
+  const std::vector<StageRecord> & get_stages() const {return stages;}
+  // print a table with all stages
+  void print_summary(std::ostream & out) const;
+  // save all stages to a json file; throws std::runtime_error on failure
+  void write_json(const std::string & fname) const;
+
+  // current resident set size [bytes] (0 if not available)
+  static std::size_t current_rss();
+  // process peak resident set size [bytes] (0 if not available)
+  static std::size_t peak_rss();
+  // total number of operator new calls
+  static std::size_t n_allocations();
+  // total number of bytes requested from operator new
+  static std::size_t allocated_bytes();
+  // currently allocated heap bytes (0 if not available)
+  static std::size_t live_heap();
+
+ private:
+  Profiler();
+  // seconds since the profiler was created
+  double elapsed() const;
+
+  using clock = std::chrono::steady_clock;
+  // counters at the start of an open stage
+  struct OpenStage
+  {
+    std::size_t id;
+    clock::time_point start;
+    std::size_t n_allocations;
+    std::size_t allocated_bytes;
+    std::size_t parent_heap_peak;  // restored when the stage is closed
+  };
+
+  const clock::time_point start;
+  std::vector<StageRecord> stages;
+  std::unordered_map<std::thread::id, std::vector<OpenStage>> open_stages;
+  mutable std::mutex mutex;
+};
+
+
+/* Times the enclosing scope as a profiler stage:
+ *   {
+ *     const profiling::ScopedTimer timer("compute transes");
+ *     ...
+ *   } */
+class ScopedTimer
+{
+ public:
+  explicit ScopedTimer(const std::string & name)
+      : id(Profiler::instance().begin(name))
+  {}
+  ~ScopedTimer() {Profiler::instance().end(id);}
+  ScopedTimer(const ScopedTimer &) = delete;
+  ScopedTimer & operator=(const ScopedTimer &) = delete;
+
+ private:
+  const std::size_t id;
+};
+
+namespace detail
+{
+// counter updates called by the operator new / delete replacements
+void record_allocation(void * ptr, const std::size_t size);
+void record_deallocation(void * ptr);
+}  // end namespace detail
+
+}  // end namespace profiling